@@ -95,6 +95,7 @@ export type World = {
 	createEntity : (World) -> Entity,
 	createEntityEx : (World, any) -> Entity,
 	findEntityByName : (World, Entity, string) -> Entity,
+	query : (World, ...string) -> {Entity},
 	animation: animation_module,
 	audio: audio_module,
 	core: core_module,
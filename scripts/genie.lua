@@ -113,10 +113,28 @@ newoption {
 	description = "Build test projects."
 }
 
+newoption {
+	trigger = "with-bench",
+	description = "Build headless benchmark runner."
+}
+
+newoption {
+	trigger = "with-server",
+	description = "Build headless dedicated server."
+}
+
+newoption {
+	trigger = "with-pack-builder",
+	description = "Build command line tool creating paks."
+}
+
 -- process _OPTIONS
 build_studio = not _OPTIONS["no-studio"]
 build_app = _OPTIONS["with-app"] or false
 build_tests = _OPTIONS["with-tests"] or false
+build_bench = _OPTIONS["with-bench"] or false
+build_server = _OPTIONS["with-server"] or false
+build_pack_builder = _OPTIONS["with-pack-builder"] or false
 local embed_resources = _OPTIONS["embed-resources"]
 local working_dir = _OPTIONS["working-dir"]
 local debug_args = _OPTIONS["debug-args"]
@@ -251,6 +269,21 @@ function plugin(plugin_name)
 				links {plugin_name}
 		end
 
+		if build_bench then
+			exe_project "bench"
+				links {plugin_name}
+		end
+
+		if build_server then
+			exe_project "server"
+				links {plugin_name}
+		end
+
+		if build_pack_builder then
+			exe_project "pack_builder"
+				links {plugin_name}
+		end
+
 		if build_app then
 			exe_project "app"
 				links {plugin_name}
@@ -714,6 +747,54 @@ if build_app then
 		end
 end
 
+-- headless command line tools, they link the engine but do not create a window
+function console_tool_project(name, source)
+	exe_project(name)
+		kind "ConsoleApp"
+		defaultConfigurations()
+		includedirs { "../src" }
+		files { source, "../src/app/console_tool.h" }
+		debugdir "../data"
+
+		if split_projects then
+			links { "core", "engine" }
+		else
+			links { "engine_merged" }
+		end
+
+		if not dynamic_plugins then
+			linkLib "freetype"
+			if use_basisu then linkLib "basisu" end
+			if hasPlugin "physics" then linkPhysX() end
+			if hasPlugin "lua" then linkLib "Luau" end
+		end
+
+		configuration { "windows" }
+			links { "psapi", "dxguid", "winmm" }
+			libdirs { "../external/pix/bin/x64" }
+
+		configuration { "linux" }
+			links { "dl", "rt" }
+			-- renderer is not used, but it's linked in with the rest of the engine
+			if hasPlugin "renderer" then
+				links { "GL", "X11", "Xi" }
+			end
+
+		configuration {}
+end
+
+if build_bench then
+	console_tool_project("bench", "../src/app/bench.cpp")
+end
+
+if build_server then
+	console_tool_project("server", "../src/app/server.cpp")
+end
+
+if build_pack_builder then
+	console_tool_project("pack_builder", "../src/app/pack_builder.cpp")
+end
+
 if build_studio then
 	lib_project "editor"
 		libType()
@@ -1069,7 +1150,7 @@ io.write "#elif defined LUMIX_PLUGINS_STRINGS\n"
 io.write "#else\n"
 	if not dynamic_plugins then
 		for _, plugin in ipairs(plugin_creators) do
-			io.write "{\n"
+			io.write("if (!isExcluded(\"" .. plugin .. "\")) {\n")
 			io.write("\tISystem* p = createPlugin_" .. plugin .. "(engine);\n")
 			io.write "\tif (p) engine.getSystemManager().addSystem(p, nullptr);\n"
 			io.write "}\n"
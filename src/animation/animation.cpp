@@ -395,6 +395,24 @@ void Animation::onBeforeReady() {
 }
 
 bool Animation::load(Span<const u8> mem) {
+	return loadAsync(mem) && finishAsyncLoad();
+}
+
+// skeleton is loaded on main thread
+bool Animation::finishAsyncLoad() {
+	if (!m_skeleton_path.isEmpty()) {
+		m_skeleton = m_resource_manager.getOwner().load<Model>(m_skeleton_path);
+		if (m_skeleton) addDependency(*m_skeleton);
+	}
+
+	if (!m_skeleton) {
+		logError(getPath(), ": missing skeleton.");
+		return false;
+	}
+	return true;
+}
+
+bool Animation::loadAsync(Span<const u8> mem) {
 	m_translations.clear();
 	m_const_translations.clear();
 	m_rotations.clear();
@@ -419,14 +437,7 @@ bool Animation::load(Span<const u8> mem) {
 	}
 
 	if (header.version > Version::SKELETON) {
-		Path path(file.readString());
-		m_skeleton = m_resource_manager.getOwner().load<Model>(path);
-		if (m_skeleton) addDependency(*m_skeleton);
-	}
-
-	if (!m_skeleton) {
-		logError(getPath(), ": missing skeleton.");
-		return false;
+		m_skeleton_path = file.readString();
 	}
 
 	file.read(m_fps);
@@ -502,6 +513,7 @@ void Animation::unload()
 	m_const_translations.clear();
 	m_mem.clear();
 	m_frame_count = 0;
+	m_skeleton_path = Path();
 	if (m_skeleton) {
 		removeDependency(*m_skeleton);
 		m_skeleton->decRefCount();
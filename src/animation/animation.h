@@ -124,6 +124,9 @@ struct Animation final : Resource {
 
 	Animation(const Path& path, ResourceManager& resource_manager, IAllocator& allocator);
 	ResourceType getType() const override { return TYPE; }
+	u64 getCPUMemorySize() const override {
+		return m_mem.byte_size() + m_translations.byte_size() + m_const_translations.byte_size() + m_rotations.byte_size() + m_const_rotations.byte_size();
+	}
 	void getRelativePose(const SampleContext& ctx);
 	Time getLength() const { return Time::fromSeconds(m_frame_count / m_fps); }
 
@@ -144,6 +147,9 @@ struct Animation final : Resource {
 private:
 	void unload() override;
 	bool load(Span<const u8> mem) override;
+	bool isLoadAsync() const override { return true; }
+	bool loadAsync(Span<const u8> mem) override;
+	bool finishAsyncLoad() override;
 	void onBeforeReady() override;
 
 	TagAllocator m_allocator;
@@ -171,6 +177,7 @@ private:
 	u32 m_frame_count = 0;
 	float m_fps = 30;
 	Model* m_skeleton = nullptr;
+	Path m_skeleton_path;
 	u32 m_max_accessed_bone_index = 0;
 
 	friend struct AnimationSampler;
@@ -102,6 +102,17 @@ struct AnimationModuleImpl final : AnimationModule {
 
 	const char* getName() const override { return "animation"; }
 
+	bool getUpdateAccess(ModuleUpdateAccess& access) const override {
+		access.read_transforms = true;
+		// property animators
+		access.write_transforms = true;
+		// property animators can animate any property of any component
+		access.write_components = ~u64(0);
+		// poses of animables
+		access.modules[0] = "renderer";
+		return true;
+	}
+
 	~AnimationModuleImpl() {
 		for (PropertyAnimator& anim : m_property_animators) {
 			unloadResource(anim.animation);
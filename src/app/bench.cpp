@@ -0,0 +1,532 @@
+// Headless frame-time benchmark
+// creates engine without window, loads a world (or generates one), runs `Engine::update` with fixed time step
+// and writes per-module timings collected from profiler and update waves of modules as JSON
+// usage: bench [-world path.unv] [-frames 1000] [-warmup 60] [-dt 0.0166] [-entities 10000] [-components a,b] [-move] [-deferred] [-query] [-delta] [-fixed 0.0166] [-output report.json]
+// -deferred enables `World::setDeferredTransforms`
+// -query compares iterating entities with all `-components` using `EntityQuery` vs. getFirstEntity/getNextEntity + hasComponent
+// -fixed enables fixed simulation steps, see `Engine::setFixedTimeStep`
+// -delta encodes world changes every frame with `WorldDeltaEncoder` and applies them to a second world, which is compared to the first one at the end
+// without renderer plugin (genie --no-renderer --no-gui) it can run on machines without GPU
+
+#include "core/array.h"
+#include "core/command_line_parser.h"
+#include "core/crt.h"
+#include "core/hash_map.h"
+#include "core/log.h"
+#include "core/math.h"
+#include "core/os.h"
+#include "core/path.h"
+#include "core/profiler.h"
+#include "core/sort.h"
+#include "core/stream.h"
+#include "core/string.h"
+#include "engine/component_uid.h"
+#include "engine/engine.h"
+#include "engine/file_system.h"
+#include "engine/plugin.h"
+#include "engine/reflection.h"
+#include "engine/world.h"
+#include "engine/world_delta.h"
+#include "console_tool.h"
+
+using namespace Lumix;
+
+// profiler blocks which are reported in form "parent/child", see `EngineImpl::update`
+static const char* REPORTED_PARENTS[] = { "update parallel", "update modules", "late update modules", "bench" };
+
+struct Bench : ConsoleTool {
+	struct Scope {
+		Scope(IAllocator& allocator) : values(allocator) {}
+
+		StaticString<128> name;
+		Array<float> values; // ms, one value per frame
+		float current = 0;
+	};
+
+	struct BlockInfo {
+		const char* name;
+		i32 parent;
+	};
+
+	Bench()
+		: m_scopes(m_allocator)
+		, m_blocks(m_allocator)
+		, m_profiler_data(m_allocator)
+		, m_frame_times(m_allocator)
+		, m_delta(m_allocator)
+		, m_delta_sizes(m_allocator)
+	{}
+
+	void parseCommandLine() {
+		char cmd_line[4096];
+		os::getCommandLine(Span(cmd_line));
+		CommandLineParser parser(cmd_line);
+		char tmp[MAX_PATH];
+		while (parser.next()) {
+			auto readValue = [&]() -> bool {
+				if (!parser.next()) return false;
+				parser.getCurrent(tmp, lengthOf(tmp));
+				return true;
+			};
+
+			if (parser.currentEquals("-world")) { if (readValue()) m_world_path = tmp; }
+			else if (parser.currentEquals("-output")) { if (readValue()) m_output_path = tmp; }
+			else if (parser.currentEquals("-components")) { if (readValue()) copyString(m_components, tmp); }
+			else if (parser.currentEquals("-frames")) { if (readValue()) fromCString(tmp, m_frames); }
+			else if (parser.currentEquals("-warmup")) { if (readValue()) fromCString(tmp, m_warmup_frames); }
+			else if (parser.currentEquals("-entities")) { if (readValue()) fromCString(tmp, m_entities_count); }
+			else if (parser.currentEquals("-dt")) { if (readValue()) fromCString(tmp, m_time_delta); }
+			else if (parser.currentEquals("-move")) m_move_entities = true;
+			else if (parser.currentEquals("-query")) m_query_entities = true;
+			else if (parser.currentEquals("-deferred")) m_deferred_transforms = true;
+			else if (parser.currentEquals("-delta")) m_replicate = true;
+			else if (parser.currentEquals("-fixed")) { if (readValue()) fromCString(tmp, m_fixed_time_step); }
+		}
+	}
+
+	void waitForResources() {
+		FileSystem& fs = m_engine->getFileSystem();
+		while (fs.hasWork()) {
+			os::sleep(1);
+			fs.processCallbacks();
+		}
+		fs.processCallbacks();
+	}
+
+	bool loadWorld() {
+		FileSystem& fs = m_engine->getFileSystem();
+		OutputMemoryStream data(m_allocator);
+		if (!fs.getContentSync(m_world_path, data)) {
+			logError("Failed to read ", m_world_path);
+			return false;
+		}
+
+		InputMemoryStream blob(data);
+		EntityMap entity_map(m_allocator);
+		WorldVersion version;
+		if (!m_world->deserialize(blob, entity_map, version)) {
+			logError("Failed to deserialize ", m_world_path);
+			return false;
+		}
+		return true;
+	}
+
+	void parseComponentTypes() {
+		StringView components = m_components;
+		while (!components.empty() && m_types_count < lengthOf(m_types)) {
+			const char* comma = find(components, ',');
+			StringView name(components.begin, comma ? comma : components.end);
+			const ComponentType type = reflection::getComponentType(name);
+			if (type == INVALID_COMPONENT_TYPE || !m_world->getModule(type)) {
+				logError("Unknown component ", name);
+			}
+			else {
+				m_types[m_types_count] = type;
+				++m_types_count;
+			}
+			components.begin = comma ? comma + 1 : components.end;
+		}
+	}
+
+	// entities are in small hierarchies (one root + 7 children), so transform propagation is exercised too
+	void generateWorld() {
+		const u32 side = maximum(u32(sqrtf((float)m_entities_count)), 1u);
+		Array<EntityRef> entities(m_allocator);
+		entities.resize(m_entities_count);
+		m_world->createEntities(entities);
+		for (u32 j = 0; j < m_types_count; ++j) m_world->createComponents(m_types[j], entities);
+
+		EntityPtr root = INVALID_ENTITY;
+		for (u32 i = 0; i < m_entities_count; ++i) {
+			const EntityRef e = entities[i];
+			m_world->setPosition(e, DVec3(double(i % side) * 2, 0, double(i / side) * 2));
+			if (i % 8 == 0) {
+				root = e;
+			}
+			else {
+				m_world->setParent(root, e);
+			}
+		}
+	}
+
+	void moveEntities(u32 frame) {
+		PROFILE_BLOCK("bench");
+		PROFILE_BLOCK("move entities");
+		const float angle = frame * m_time_delta;
+		const Quat rot(Vec3(0, 1, 0), angle);
+		for (EntityPtr e = m_world->getFirstEntity(); e.isValid(); e = m_world->getNextEntity(*e)) {
+			if (m_world->getParent(*e).isValid()) continue;
+			m_world->setRotation(*e, rot);
+		}
+	}
+
+	// both variants do the same work, so the difference is only in how matching entities are found
+	void iterateEntities(EntityQuery& query) {
+		PROFILE_BLOCK("bench");
+		DVec3 sum_naive(0);
+		{
+			PROFILE_BLOCK("entity iteration");
+			for (EntityPtr e = m_world->getFirstEntity(); e.isValid(); e = m_world->getNextEntity(*e)) {
+				bool matches = true;
+				for (u32 i = 0; i < m_types_count && matches; ++i) matches = m_world->hasComponent(*e, m_types[i]);
+				if (matches) sum_naive += m_world->getPosition(*e);
+			}
+		}
+		DVec3 sum_query(0);
+		{
+			PROFILE_BLOCK("query iteration");
+			query.forEach([&](EntityRef e){ sum_query += m_world->getPosition(e); });
+		}
+		if (sum_naive.x != sum_query.x || sum_naive.z != sum_query.z) logError("Query and entity iteration do not match");
+	}
+
+	// same as server sending changes to a client
+	void replicateWorld() {
+		PROFILE_BLOCK("bench");
+		m_delta.clear();
+		{
+			PROFILE_BLOCK("delta encode");
+			m_delta_encoder->encode(*m_world, m_delta);
+		}
+		{
+			PROFILE_BLOCK("delta decode");
+			InputMemoryStream blob(m_delta);
+			if (!applyWorldDelta(*m_replica, blob)) logError("Failed to apply world delta");
+		}
+		m_delta_sizes.push(float(m_delta.size()));
+	}
+
+	bool equalComponents(EntityRef e) {
+		const Span<const ComponentType> types = m_world->getComponents(e);
+		if (types.length() != m_replica->getComponents(e).length()) return false;
+
+		OutputMemoryStream props(m_allocator);
+		OutputMemoryStream replica_props(m_allocator);
+		for (ComponentType type : types) {
+			if (!m_replica->hasComponent(e, type)) return false;
+			props.clear();
+			replica_props.clear();
+			writeComponentProperties(ComponentUID(e, type, m_world->getModule(type)), props);
+			writeComponentProperties(ComponentUID(e, type, m_replica->getModule(type)), replica_props);
+			if (props.size() != replica_props.size()) return false;
+			if (memcmp(props.data(), replica_props.data(), props.size()) != 0) return false;
+		}
+		return true;
+	}
+
+	void verifyReplica() {
+		u32 mismatches = 0;
+		for (EntityPtr e = m_world->getFirstEntity(); e.isValid(); e = m_world->getNextEntity(*e)) {
+			if (!m_replica->hasEntity(*e)) {
+				++mismatches;
+				continue;
+			}
+			const DVec3 diff = m_world->getPosition(*e) - m_replica->getPosition(*e);
+			if (maximum(fabs(diff.x), fabs(diff.y), fabs(diff.z)) > 1 / 1024.0) ++mismatches;
+			if (!equalComponents(*e)) ++mismatches;
+		}
+		if (mismatches > 0) logError("Replicated world differs in ", mismatches, " entities");
+	}
+
+	Scope& getScope(const char* parent, const char* name) {
+		StaticString<128> tmp(parent ? parent : "", parent ? "/" : "", name);
+		for (Scope& scope : m_scopes) {
+			if (scope.name == tmp.data) return scope;
+		}
+		Scope& scope = m_scopes.emplace(m_allocator);
+		scope.name = tmp.data;
+		return scope;
+	}
+
+	static bool isReportedParent(const char* name) {
+		for (const char* p : REPORTED_PARENTS) {
+			if (equalStrings(p, name)) return true;
+		}
+		return false;
+	}
+
+	template <typename F>
+	void forEachContext(const F& f) {
+		InputMemoryStream blob(m_profiler_data);
+		blob.read<u32>(); // version
+		const u32 counters_count = blob.read<u32>();
+		blob.skip(counters_count * sizeof(profiler::Counter));
+		const u32 contexts_count = blob.read<u32>() + 1; // + global context
+		for (u32 i = 0; i < contexts_count; ++i) {
+			blob.readString();
+			blob.read<u32>(); // thread id
+			blob.read<u8>(); // show in profiler
+			const u32 size = blob.read<u32>();
+			const u8* events = (const u8*)blob.skip(size);
+			f(Span(events, size));
+		}
+	}
+
+	// returns id of block opened by the event, -1 if event does not open a block
+	static i32 getOpenedBlock(const profiler::EventHeader& header, const u8* data) {
+		switch (header.type) {
+			case profiler::EventType::BEGIN_BLOCK: {
+				profiler::BlockRecord r;
+				memcpy(&r, data, sizeof(r));
+				return r.id;
+			}
+			case profiler::EventType::BEGIN_JOB: {
+				profiler::JobRecord r;
+				memcpy(&r, data, sizeof(r));
+				return r.id;
+			}
+			case profiler::EventType::CONTINUE_BLOCK: {
+				i32 id;
+				memcpy(&id, data, sizeof(id));
+				return id;
+			}
+			default: return -1;
+		}
+	}
+
+	// block names are pointers to string literals, they are valid since we are in the same process
+	// first pass maps block ids to names and parents, second pass sums durations inside the frame
+	// blocks interrupted by fiber switches are continued with the same id, possibly on other thread
+	void collectFrameTimings(u64 frame_begin, u64 frame_end) {
+		m_profiler_data.clear();
+		profiler::serialize(m_profiler_data);
+
+		i32 stack[64];
+		u64 stack_times[64];
+		u32 stack_size = 0;
+		forEachContext([&](Span<const u8> events) {
+			stack_size = 0;
+			for (u32 pos = 0; pos < events.length();) {
+				profiler::EventHeader header;
+				memcpy(&header, &events[pos], sizeof(header));
+				const u8* data = &events[pos] + sizeof(header);
+				pos += header.size;
+				if (header.time < frame_begin || header.time > frame_end) continue;
+
+				if (header.type == profiler::EventType::END_BLOCK) {
+					if (stack_size > 0) --stack_size;
+					continue;
+				}
+
+				const i32 id = getOpenedBlock(header, data);
+				if (id < 0) continue;
+				if (header.type == profiler::EventType::BEGIN_BLOCK) {
+					profiler::BlockRecord r;
+					memcpy(&r, data, sizeof(r));
+					const i32 parent = stack_size > 0 && stack_size <= lengthOf(stack) ? stack[stack_size - 1] : -1;
+					m_blocks.insert(id, { r.name, parent });
+				}
+				else if (header.type == profiler::EventType::BEGIN_JOB) {
+					m_blocks.insert(id, { "job", -1 });
+				}
+				if (stack_size < lengthOf(stack)) stack[stack_size] = id;
+				++stack_size;
+			}
+		});
+
+		const double to_ms = 1000.0 / profiler::frequency();
+		forEachContext([&](Span<const u8> events) {
+			stack_size = 0;
+			for (u32 pos = 0; pos < events.length();) {
+				profiler::EventHeader header;
+				memcpy(&header, &events[pos], sizeof(header));
+				const u8* data = &events[pos] + sizeof(header);
+				pos += header.size;
+				if (header.time < frame_begin || header.time > frame_end) continue;
+
+				if (header.type != profiler::EventType::END_BLOCK) {
+					const i32 id = getOpenedBlock(header, data);
+					if (id < 0) continue;
+					if (stack_size < lengthOf(stack)) {
+						stack[stack_size] = id;
+						stack_times[stack_size] = header.time;
+					}
+					++stack_size;
+					continue;
+				}
+
+				if (stack_size == 0) continue;
+				--stack_size;
+				if (stack_size >= lengthOf(stack)) continue;
+				auto iter = m_blocks.find(stack[stack_size]);
+				if (!iter.isValid()) continue;
+
+				const BlockInfo& block = iter.value();
+				const float duration = float((header.time - stack_times[stack_size]) * to_ms);
+				if (isReportedParent(block.name)) {
+					getScope(nullptr, block.name).current += duration;
+				}
+				auto parent = m_blocks.find(block.parent);
+				if (parent.isValid() && isReportedParent(parent.value().name)) {
+					getScope(parent.value().name, block.name).current += duration;
+				}
+			}
+		});
+
+		m_blocks.clear();
+		for (Scope& scope : m_scopes) {
+			while (scope.values.size() < m_frame_times.size()) scope.values.push(0);
+			scope.values.push(scope.current);
+			scope.current = 0;
+		}
+	}
+
+	static void writeStats(OutputMemoryStream& out, const char* name, Array<float>& values) {
+		float mean = 0;
+		for (float v : values) mean += v;
+		mean /= maximum(values.size(), 1);
+		sort(values.begin(), values.end(), [](float a, float b) { return a < b; });
+		auto percentile = [&](float p) { return values.empty() ? 0 : values[u32((values.size() - 1) * p + 0.5f)]; };
+		out << "\t\t\"" << name << "\": { \"mean\": " << mean
+			<< ", \"p50\": " << percentile(0.5f)
+			<< ", \"p99\": " << percentile(0.99f)
+			<< ", \"max\": " << (values.empty() ? 0.f : values.back())
+			<< " }";
+	}
+
+	void writeReport(u32 entities_count) {
+		OutputMemoryStream out(m_allocator);
+		out << "{\n";
+		out << "\t\"world\": \"" << (m_world_path.isEmpty() ? "<generated>" : m_world_path.c_str()) << "\",\n";
+		out << "\t\"frames\": " << m_frames << ",\n";
+		out << "\t\"time_delta\": " << m_time_delta << ",\n";
+		out << "\t\"entities\": " << entities_count << ",\n";
+		out << "\t\"unit\": \"ms\",\n";
+		if (m_replicate) {
+			writeStats(out, "delta_bytes", m_delta_sizes);
+			out << ",\n";
+		}
+		// modules in the same wave are updated concurrently
+		out << "\t\"update_waves\": {";
+		const char* separator = "\n";
+		for (UniquePtr<IModule>& module : m_world->getModules()) {
+			out << separator << "\t\t\"" << module->getName() << "\": " << m_engine->getUpdateWave(*m_world, *module.get());
+			separator = ",\n";
+		}
+		out << "\n\t},\n";
+		out << "\t\"scopes\": {\n";
+		writeStats(out, "frame", m_frame_times);
+		for (Scope& scope : m_scopes) {
+			while (scope.values.size() < m_frame_times.size()) scope.values.push(0);
+			out << ",\n";
+			writeStats(out, scope.name, scope.values);
+		}
+		out << "\n\t}\n}\n";
+
+		if (m_output_path.isEmpty()) {
+			fwrite(out.data(), out.size(), 1, stdout);
+			return;
+		}
+
+		os::OutputFile file;
+		if (!file.open(m_output_path.c_str())) {
+			logError("Failed to create ", m_output_path);
+			return;
+		}
+		if (!file.write(out.data(), out.size())) logError("Failed to write ", m_output_path);
+		file.close();
+	}
+
+	int run() {
+		parseCommandLine();
+
+		Engine::InitArgs init_data;
+		if (os::fileExists("main.pak")) {
+			init_data.file_system = FileSystem::createPacked("main.pak", m_allocator);
+		}
+		init_data.log_path = "engine/lumix_bench.log";
+		m_engine = Engine::create(static_cast<Engine::InitArgs&&>(init_data), m_allocator);
+		m_engine->init();
+		m_engine->setFixedTimeDelta(m_time_delta);
+		m_engine->setFixedTimeStep(m_fixed_time_step, 4);
+		m_world = &m_engine->createWorld();
+
+		parseComponentTypes();
+		if (!m_world_path.isEmpty()) {
+			if (!loadWorld()) {
+				m_engine->destroyWorld(*m_world);
+				return 1;
+			}
+		}
+		else {
+			generateWorld();
+		}
+		waitForResources();
+
+		u32 entities_count = 0;
+		for (EntityPtr e = m_world->getFirstEntity(); e.isValid(); e = m_world->getNextEntity(*e)) ++entities_count;
+		logInfo("Benchmarking ", entities_count, " entities, ", m_frames, " frames");
+
+		m_world->setDeferredTransforms(m_deferred_transforms);
+		if (m_replicate) {
+			m_replica = &m_engine->createWorld();
+			m_delta_encoder = UniquePtr<WorldDeltaEncoder>::create(m_allocator, m_allocator);
+		}
+		EntityQuery query(*m_world, Span(m_types, m_types_count));
+		m_engine->startGame(*m_world);
+		for (u32 i = 0; i < m_warmup_frames; ++i) {
+			if (m_move_entities) moveEntities(i);
+			if (m_query_entities) iterateEntities(query);
+			m_engine->update(*m_world);
+			if (m_replicate) replicateWorld();
+			profiler::frame();
+		}
+
+		m_frame_times.reserve(m_frames);
+		for (u32 i = 0; i < m_frames; ++i) {
+			const u64 frame_begin = os::Timer::getRawTimestamp();
+			if (m_move_entities) moveEntities(m_warmup_frames + i);
+			if (m_query_entities) iterateEntities(query);
+			m_engine->update(*m_world);
+			if (m_replicate) replicateWorld();
+			const u64 frame_end = os::Timer::getRawTimestamp();
+			profiler::frame();
+			collectFrameTimings(frame_begin, frame_end);
+			m_frame_times.push(float((frame_end - frame_begin) * 1000.0 / os::Timer::getFrequency()));
+		}
+		m_engine->stopGame(*m_world);
+		if (m_replicate) verifyReplica();
+
+		writeReport(entities_count);
+		if (m_replica) {
+			m_delta_encoder.reset();
+			m_engine->destroyWorld(*m_replica);
+			m_replica = nullptr;
+		}
+		m_engine->destroyWorld(*m_world);
+		m_world = nullptr;
+		m_engine.reset();
+		return 0;
+	}
+
+	UniquePtr<Engine> m_engine;
+	World* m_world = nullptr;
+	World* m_replica = nullptr;
+	UniquePtr<WorldDeltaEncoder> m_delta_encoder;
+
+	Path m_world_path;
+	Path m_output_path;
+	char m_components[256] = "";
+	u32 m_frames = 1000;
+	u32 m_warmup_frames = 60;
+	u32 m_entities_count = 10'000;
+	float m_time_delta = 1 / 60.f;
+	float m_fixed_time_step = 0;
+	bool m_move_entities = false;
+	bool m_query_entities = false;
+	bool m_deferred_transforms = false;
+	bool m_replicate = false;
+	ComponentType m_types[ComponentType::MAX_TYPES_COUNT];
+	u32 m_types_count = 0;
+
+	Array<Scope> m_scopes;
+	HashMap<i32, BlockInfo> m_blocks;
+	OutputMemoryStream m_profiler_data;
+	Array<float> m_frame_times;
+	OutputMemoryStream m_delta;
+	Array<float> m_delta_sizes;
+};
+
+int main(int argc, char* argv[]) {
+	return runConsoleTool<Bench>(argc, argv);
+}
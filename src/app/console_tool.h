@@ -0,0 +1,69 @@
+#pragma once
+
+// shared bootstrap of headless console tools (bench, server, pack_builder), see `console_tool_project` in genie.lua
+
+#include "core/debug.h"
+#include "core/default_allocator.h"
+#include "core/job_system.h"
+#include "core/log.h"
+#include "core/log_callback.h"
+#include "core/os.h"
+#include "core/profiler.h"
+#include "core/sync.h"
+#include <stdio.h>
+
+namespace Lumix {
+
+inline void logToStdout(LogLevel level, const char* message) {
+	if (level == LogLevel::ERROR) printf("Error: ");
+	printf("%s\n", message);
+}
+
+// tools derive from this, so debug, profiler and job system live longer than the tool's members
+struct ConsoleTool {
+	ConsoleTool()
+		: m_allocator(m_main_allocator)
+	{
+		debug::init(m_allocator);
+		profiler::init(m_allocator);
+		if (!jobs::init(os::getCPUsCount(), m_allocator)) {
+			logError("Failed to initialize job system.");
+		}
+	}
+
+	~ConsoleTool() {
+		jobs::shutdown();
+		profiler::shutdown();
+		debug::shutdown();
+	}
+
+	DefaultAllocator m_main_allocator;
+	debug::Allocator m_allocator;
+};
+
+// `Tool::run` is called in a job, since engine waits for jobs, its result is the exit code
+template <typename Tool>
+int runConsoleTool(int argc, char* argv[]) {
+	os::setCommandLine(argc, argv);
+	registerLogCallback<logToStdout>();
+
+	struct Data {
+		Data() : semaphore(0, 1) {}
+		Tool tool;
+		Semaphore semaphore;
+		int result = 0;
+	} data;
+
+	profiler::setThreadName("Main thread");
+	jobs::run(&data, [](void* ptr) {
+		Data* data = (Data*)ptr;
+		data->result = data->tool.run();
+		data->semaphore.signal();
+	}, nullptr, 0);
+
+	data.semaphore.wait();
+	unregisterLogCallback<logToStdout>();
+	return data.result;
+}
+
+} // namespace Lumix
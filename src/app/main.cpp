@@ -11,6 +11,7 @@
 #include "core/os.h"
 #include "core/path.h"
 #include "core/profiler.h"
+#include "core/string.h"
 #include "core/thread.h"
 #include "engine/component_types.h"
 #include "engine/engine.h"
@@ -20,9 +21,11 @@
 #include "engine/resource_manager.h"
 #include "engine/world.h"
 #include "gui/gui_system.h"
+#include "renderer/model.h"
 #include "renderer/pipeline.h"
 #include "renderer/render_module.h"
 #include "renderer/renderer.h"
+#include "renderer/texture.h"
 #include "imgui_integration.h"
 
 #ifdef __linux__
@@ -83,7 +86,13 @@ struct Runner final
 		m_viewport.rot = Quat::IDENTITY;
 
 		m_renderer = static_cast<Renderer*>(m_engine->getSystemManager().getSystem("renderer"));
+		// level streaming uploads textures and models within a per frame budget instead of all at once
+		ResourceManagerHub& rm = m_engine->getResourceManager();
+		rm.setTimeSliced(Texture::TYPE, true);
+		rm.setTimeSliced(Model::TYPE, true);
+		setResourceBudgets(rm);
 		m_pipeline = Pipeline::create(*m_renderer, PipelineType::GAME_VIEW);
+		m_renderer->setPipelinedFrames(CommandLineParser::isOn("-pipelined_frames"));
 
 		while (m_engine->getFileSystem().hasWork()) {
 			os::sleep(100);
@@ -93,6 +102,30 @@ struct Runner final
 		m_pipeline->setWorld(m_world);
 	}
 
+	// -resource_budget <type> <MB>, e.g. -resource_budget texture 512 -resource_budget model 256
+	void setResourceBudgets(ResourceManagerHub& rm) {
+		char cmd_line[4096];
+		os::getCommandLine(Span(cmd_line));
+		CommandLineParser parser(cmd_line);
+		char type[64];
+		char size[32];
+		while (parser.next()) {
+			if (!parser.currentEquals("-resource_budget")) continue;
+			if (!parser.next()) break;
+			parser.getCurrent(type, lengthOf(type));
+			if (!parser.next()) break;
+			parser.getCurrent(size, lengthOf(size));
+
+			u64 mb = 0;
+			fromCString(size, mb);
+			if (!rm.get(ResourceType(type))) {
+				logError("Unknown resource type ", type, " in -resource_budget");
+				continue;
+			}
+			rm.setBudget(ResourceType(type), mb * 1024 * 1024);
+		}
+	}
+
 	void initDemoScene() {
 		const EntityRef env = m_world->createEntity({0, 0, 0}, Quat::IDENTITY);
 		m_world->createComponent(types::environment, env);
@@ -114,6 +147,13 @@ struct Runner final
 		InputMemoryStream blob(data);
 		EntityMap entity_map(m_allocator);
 
+		ResourceManagerHub& rm = m_engine->getResourceManager();
+		// summary is logged once all resources of the world are loaded
+		if (CommandLineParser::isOn("-trace_load")) rm.beginLoadTrace();
+		const Path manifest_path = ResourceManagerHub::getManifestPath(Path(path));
+		if (CommandLineParser::isOn("-record_manifest")) rm.recordManifest(manifest_path);
+		rm.preload(manifest_path);
+
 		WorldVersion editor_version;
 		if (!m_world->deserialize(blob, entity_map, editor_version)) {
 			logError("Failed to deserialize ", path);
@@ -202,6 +242,8 @@ struct Runner final
 	}
 
 	void shutdown() {
+		// finishes pipelined jobs, which still read the world
+		m_pipeline->setWorld(nullptr);
 		m_engine->destroyWorld(*m_world);
 		auto* gui = static_cast<GUISystem*>(m_engine->getSystemManager().getSystem("gui"));
 		gui->setInterface(nullptr);
@@ -259,7 +301,10 @@ struct Runner final
 		}
 
 		m_imgui.beginFrame();
+		// with pipelined frames, previous frame is culled and encoded while the world is updated
 		m_engine->update(*m_world);
+		const bool pipelined = m_renderer->arePipelinedFramesEnabled();
+		if (pipelined) m_renderer->frame();
 
 		EntityPtr camera = m_pipeline->getModule()->getActiveCamera();
 		if (camera.isValid()) {
@@ -274,7 +319,7 @@ struct Runner final
 		m_pipeline->render(false);
 		m_pipeline->blitOutputToScreen();
 		m_imgui.endFrame();
-		m_renderer->frame();
+		if (!pipelined) m_renderer->frame();
 	}
 
 	DefaultAllocator m_main_allocator;
@@ -0,0 +1,119 @@
+// Builds a pak for `FileSystem::createPacked` from a project directory
+// usage: pack_builder -project dir [-out main.pak] [-dir data_dir]... [-trace world.manifest]... [-align 4096] [-compression none|lz4|auto]
+// packs lumix.prj, compiled resources, shaders/ and all `-dir` directories
+// -trace is a world manifest (e.g. universes/main.unv.manifest) or a text file with one path per line in the order they are loaded,
+// e.g. ".lumix/resources/1234.res"; it can be used more times, e.g. once per world
+
+#include "core/array.h"
+#include "core/command_line_parser.h"
+#include "core/log.h"
+#include "core/math.h"
+#include "core/os.h"
+#include "core/path.h"
+#include "core/stream.h"
+#include "core/string.h"
+#include "engine/file_system.h"
+#include "engine/pack_builder.h"
+#include "console_tool.h"
+
+using namespace Lumix;
+
+struct PackTool : ConsoleTool {
+	PackTool()
+		: m_dirs(m_allocator)
+		, m_trace_paths(m_allocator)
+	{}
+
+	bool parseCommandLine() {
+		char cmd_line[4096];
+		os::getCommandLine(Span(cmd_line));
+		CommandLineParser parser(cmd_line);
+		char tmp[MAX_PATH];
+		while (parser.next()) {
+			auto readValue = [&]() -> bool {
+				if (!parser.next()) return false;
+				parser.getCurrent(tmp, lengthOf(tmp));
+				return true;
+			};
+
+			if (parser.currentEquals("-project")) { if (readValue()) m_project_dir = tmp; }
+			else if (parser.currentEquals("-out")) { if (readValue()) m_out_path = tmp; }
+			else if (parser.currentEquals("-dir")) { if (readValue()) m_dirs.emplace(tmp); }
+			else if (parser.currentEquals("-trace")) { if (readValue()) m_trace_paths.emplace(tmp); }
+			else if (parser.currentEquals("-align")) { if (readValue()) fromCString(tmp, m_alignment); }
+			else if (parser.currentEquals("-compression")) {
+				if (!readValue()) continue;
+				if (equalIStrings(tmp, "none")) m_compression = PackBuilder::Compression::NONE;
+				else if (equalIStrings(tmp, "lz4")) m_compression = PackBuilder::Compression::LZ4;
+				else if (equalIStrings(tmp, "auto")) m_compression = PackBuilder::Compression::AUTO;
+				else {
+					logError("Unknown compression ", tmp);
+					return false;
+				}
+			}
+		}
+		if (m_project_dir.isEmpty()) {
+			logError("Missing -project");
+			return false;
+		}
+		m_alignment = maximum(m_alignment, 1u);
+		return true;
+	}
+
+	bool loadTrace(const Path& trace_path, PackBuilder& builder) {
+		os::InputFile file;
+		if (!file.open(trace_path.c_str())) {
+			logError("Could not open ", trace_path);
+			return false;
+		}
+		OutputMemoryStream trace(m_allocator);
+		trace.resize(file.size());
+		const bool success = file.read(trace.getMutableData(), trace.size());
+		file.close();
+		if (!success) {
+			logError("Could not read ", trace_path);
+			return false;
+		}
+		if (!builder.addLoadTrace(trace)) {
+			logError("Invalid load trace ", trace_path);
+			return false;
+		}
+		return true;
+	}
+
+	int run() {
+		if (!parseCommandLine()) return 1;
+
+		UniquePtr<FileSystem> fs = FileSystem::create(m_project_dir.c_str(), m_allocator, 1);
+		fs->mount(m_project_dir.c_str(), "");
+
+		UniquePtr<PackBuilder> builder = PackBuilder::create(*fs, m_allocator);
+		builder->setAlignment(m_alignment);
+		for (const Path& trace_path : m_trace_paths) {
+			if (!loadTrace(trace_path, *builder)) return 1;
+		}
+
+		builder->addFile(Path("lumix.prj"), m_compression);
+		builder->addDirectory(".lumix/resources", m_compression);
+		builder->addDirectory("shaders", m_compression);
+		for (const Path& dir : m_dirs) builder->addDirectory(dir.c_str(), m_compression);
+
+		PackBuilder::Report report;
+		if (!builder->write(m_out_path.c_str(), report)) return 1;
+
+		logPackReport(report);
+		return 0;
+	}
+
+
+	Path m_project_dir;
+	Path m_out_path = Path("main.pak");
+	Array<Path> m_trace_paths;
+	Array<Path> m_dirs;
+	u32 m_alignment = 1;
+	PackBuilder::Compression m_compression = PackBuilder::Compression::AUTO;
+};
+
+int main(int argc, char* argv[]) {
+	return runConsoleTool<PackTool>(argc, argv);
+}
@@ -0,0 +1,148 @@
+// Dedicated headless server
+// creates engine without window and without systems which only matter for presentation, loads a world and simulates it at fixed tick rate
+// usage: server [-world path.unv] [-pack main.pak] [-tick_rate 30] [-frames 0]
+// -frames 0 runs until the process is killed
+// data of modules which are not loaded (renderer, ...) are skipped when the world is deserialized, so no textures, shaders or models are loaded
+
+#include "core/command_line_parser.h"
+#include "core/log.h"
+#include "core/os.h"
+#include "core/path.h"
+#include "core/profiler.h"
+#include "core/stream.h"
+#include "core/string.h"
+#include "engine/engine.h"
+#include "engine/file_system.h"
+#include "engine/world.h"
+#include "console_tool.h"
+
+using namespace Lumix;
+
+// animation depends on renderer, since poses are stored in model instances
+static const char* EXCLUDED_SYSTEMS[] = { "renderer", "gui", "audio", "animation" };
+
+struct Server : ConsoleTool {
+	void parseCommandLine() {
+		char cmd_line[4096];
+		os::getCommandLine(Span(cmd_line));
+		CommandLineParser parser(cmd_line);
+		char tmp[MAX_PATH];
+		while (parser.next()) {
+			auto readValue = [&]() -> bool {
+				if (!parser.next()) return false;
+				parser.getCurrent(tmp, lengthOf(tmp));
+				return true;
+			};
+
+			if (parser.currentEquals("-world")) { if (readValue()) m_world_path = tmp; }
+			else if (parser.currentEquals("-pack")) { if (readValue()) m_pack_path = tmp; }
+			else if (parser.currentEquals("-tick_rate")) { if (readValue()) fromCString(tmp, m_tick_rate); }
+			else if (parser.currentEquals("-frames")) { if (readValue()) fromCString(tmp, m_frames); }
+		}
+		m_tick_rate = maximum(m_tick_rate, 1.f);
+	}
+
+	void loadProject() {
+		OutputMemoryStream data(m_allocator);
+		if (!m_engine->getFileSystem().getContentSync(Path("lumix.prj"), data)) return;
+
+		InputMemoryStream blob(data);
+		Path startup_world;
+		if (m_engine->deserializeProject(blob, startup_world) != DeserializeProjectResult::SUCCESS) {
+			logError("Failed to deserialize project file");
+			return;
+		}
+		if (m_world_path.isEmpty()) m_world_path = startup_world;
+	}
+
+	bool loadWorld() {
+		FileSystem& fs = m_engine->getFileSystem();
+		OutputMemoryStream data(m_allocator);
+		if (!fs.getContentSync(m_world_path, data)) {
+			logError("Failed to read ", m_world_path);
+			return false;
+		}
+
+		InputMemoryStream blob(data);
+		EntityMap entity_map(m_allocator);
+		WorldVersion version;
+		if (!m_world->deserialize(blob, entity_map, version)) {
+			logError("Failed to deserialize ", m_world_path);
+			return false;
+		}
+
+		while (fs.hasWork()) {
+			os::sleep(1);
+			fs.processCallbacks();
+		}
+		fs.processCallbacks();
+		return true;
+	}
+
+	// sleeps the rest of the tick instead of spinning
+	void runLoop() {
+		const float tick_duration = 1 / m_tick_rate;
+		os::Timer timer;
+		for (u32 frame = 0; m_frames == 0 || frame < m_frames; ++frame) {
+			m_engine->update(*m_world);
+			profiler::frame();
+
+			const float elapsed = timer.getTimeSinceTick();
+			if (elapsed < tick_duration) {
+				PROFILE_BLOCK("sleeping");
+				os::sleep(u32((tick_duration - elapsed) * 1000));
+			}
+			timer.tick();
+		}
+	}
+
+	int run() {
+		parseCommandLine();
+
+		Engine::InitArgs init_data;
+		if (m_pack_path.isEmpty() && os::fileExists("main.pak")) m_pack_path = "main.pak";
+		if (!m_pack_path.isEmpty()) {
+			init_data.file_system = FileSystem::createPacked(m_pack_path.c_str(), m_allocator);
+		}
+		init_data.log_path = "engine/lumix_server.log";
+		init_data.excluded_systems = Span(EXCLUDED_SYSTEMS);
+		m_engine = Engine::create(static_cast<Engine::InitArgs&&>(init_data), m_allocator);
+		m_engine->init();
+		// simulation advances by whole ticks, `update` is called once per tick
+		m_engine->setFixedTimeStep(1 / m_tick_rate, 4);
+		m_world = &m_engine->createWorld();
+
+		loadProject();
+		if (m_world_path.isEmpty()) {
+			logError("No world to run, use -world");
+			m_engine->destroyWorld(*m_world);
+			return 1;
+		}
+		if (!loadWorld()) {
+			m_engine->destroyWorld(*m_world);
+			return 1;
+		}
+
+		logInfo("Running ", m_world_path, " at ", m_tick_rate, " ticks per second");
+		m_engine->startGame(*m_world);
+		runLoop();
+		m_engine->stopGame(*m_world);
+
+		m_engine->destroyWorld(*m_world);
+		m_world = nullptr;
+		m_engine.reset();
+		return 0;
+	}
+
+	UniquePtr<Engine> m_engine;
+	World* m_world = nullptr;
+
+	Path m_world_path;
+	Path m_pack_path;
+	float m_tick_rate = 30;
+	u32 m_frames = 0;
+};
+
+int main(int argc, char* argv[]) {
+	return runConsoleTool<Server>(argc, argv);
+}
@@ -71,6 +71,11 @@ struct AudioModuleImpl final : AudioModule
 	i32 getVersion() const override { return (i32)Version::LATEST; }
 	const char* getName() const override { return "audio"; }
 
+	bool getUpdateAccess(ModuleUpdateAccess& access) const override {
+		access.read_transforms = true;
+		return true;
+	}
+
 	~AudioModuleImpl() {
 		for (const AmbientSound& snd : m_ambient_sounds) {
 			if (snd.clip) snd.clip->decRefCount();
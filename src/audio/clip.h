@@ -22,9 +22,11 @@ struct Clip final : Resource
 	}
 
 	ResourceType getType() const override { return TYPE; }
+	u64 getCPUMemorySize() const override { return m_data.byte_size(); }
 
 	void unload() override;
 	bool load(Span<const u8> mem) override;
+	bool isLoadAsync() const override { return true; }
 	int getChannels() const { return m_channels; }
 	int getSampleRate() const { return m_sample_rate; }
 	int getSize() const { return m_data.size() * sizeof(m_data[0]); }
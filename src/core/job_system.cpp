@@ -44,6 +44,8 @@ static constexpr u64 STATE_WAITING_FIBER_MASK = (~u64(0)) & ~STATE_COUNTER_MASK;
 struct FiberJobPair {
 	Fiber::Handle fiber = Fiber::INVALID_FIBER;
 	Job current_job;
+	// see `setJobLocalData`
+	void* job_local_data = nullptr;
 };
 
 #ifdef _WIN32
@@ -585,10 +587,12 @@ LUMIX_FORCE_INLINE static void executeJob(const Job& job) {
 			if (!work.job.task) continue;
 
 			this_fiber->current_job = work.job;
+			this_fiber->job_local_data = nullptr;
 
 			executeJob(work.job);
 
 			this_fiber->current_job.task = nullptr;
+			this_fiber->job_local_data = nullptr;
 			worker = getWorker();
 		}
 		else ASSERT(false);
@@ -673,6 +677,14 @@ void wait(Counter* counter) {
 	wait(&counter->signal);
 }
 
+void increment(Counter* counter, u32 value) {
+	addCounter(counter, value);
+}
+
+void decrement(Counter* counter) {
+	decCounter(counter);
+}
+
 void wait(Signal* signal) {
 	ASSERT(getWorker());
 
@@ -787,6 +799,16 @@ void yield() {
 	moveJobToWorker(ANY_WORKER);
 }
 
+void setJobLocalData(void* data) {
+	ASSERT(getWorker());
+	getWorker()->m_current_fiber->job_local_data = data;
+}
+
+void* getJobLocalData() {
+	WorkerTask* worker = getWorker();
+	return worker ? worker->m_current_fiber->job_local_data : nullptr;
+}
+
 void run(void* data, void(*task)(void*), Counter* on_finished, u8 worker_index)
 {
 	Job job;
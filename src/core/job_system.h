@@ -32,6 +32,9 @@ LUMIX_CORE_API void wait(Signal* signal);
 LUMIX_CORE_API void waitAndTurnRed(Signal* signal);
 
 LUMIX_CORE_API void wait(Counter* counter);
+// change counter without running a job, e.g. to wait for io requests in the same way as for jobs
+LUMIX_CORE_API void increment(Counter* counter, u32 value = 1);
+LUMIX_CORE_API void decrement(Counter* counter);
 
 LUMIX_CORE_API void enter(Mutex* mutex);
 LUMIX_CORE_API void exit(Mutex* mutex);
@@ -45,6 +48,10 @@ LUMIX_CORE_API u8 getWorkersCount();
 LUMIX_CORE_API void moveJobToWorker(u8 worker_index);
 // yield current job, push it to global queue
 LUMIX_CORE_API void yield();
+// single pointer attached to the running job, it moves with the job to other workers, e.g. after `wait`
+// it's nullptr when a job starts, jobs spawned by the job do not inherit it
+LUMIX_CORE_API void setJobLocalData(void* data);
+LUMIX_CORE_API void* getJobLocalData();
 
 // run single job, increment on_finished counter, decrement it when job is done
 LUMIX_CORE_API void run(void* data, void(*task)(void*), Counter* on_finish, u8 worker_index = ANY_WORKER);
@@ -139,6 +146,13 @@ void forEach(u32 count, u32 step, const F& f) {
 	const u32 steps = (count + step - 1) / step;
 	const u32 num_workers = u32(getWorkersCount());
 	const u32 num_jobs = steps > num_workers ? num_workers : steps;
+	// single worker, e.g. on single core machines
+	if (num_jobs < 2) {
+		for (u32 idx = 0; idx < count; idx += step) {
+			f(idx, idx + step > count ? count : idx + step);
+		}
+		return;
+	}
 	
 	Counter counter;
 	struct Data {
@@ -412,6 +412,45 @@ bool InputFile::seek(u64 pos) {
 }
 
 
+MappedFile::MappedFile() {
+	m_handle = nullptr;
+	m_mapping = nullptr;
+}
+
+
+MappedFile::~MappedFile() {
+	ASSERT(!m_data);
+}
+
+
+bool MappedFile::open(const char* path) {
+	const int fd = ::open(path, O_RDONLY);
+	if (fd < 0) return false;
+
+	struct stat st;
+	// empty files can not be mapped
+	if (fstat(fd, &st) != 0 || st.st_size == 0) {
+		::close(fd);
+		return false;
+	}
+	void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	// mapping keeps the file referenced
+	::close(fd);
+	if (data == MAP_FAILED) return false;
+
+	m_data = (const u8*)data;
+	m_size = st.st_size;
+	return true;
+}
+
+
+void MappedFile::close() {
+	if (m_data) munmap((void*)m_data, m_size);
+	m_data = nullptr;
+	m_size = 0;
+}
+
+
 u32 getCPUsCount() {
 	return sysconf(_SC_NPROCESSORS_ONLN);
 }
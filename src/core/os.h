@@ -140,6 +140,24 @@ struct LUMIX_CORE_API InputFile final : IInputStream {
 private:
 	void* m_handle;
 };
+
+// read-only memory mapped file, can be read from any thread without locking
+struct LUMIX_CORE_API MappedFile {
+	MappedFile();
+	~MappedFile();
+
+	[[nodiscard]] bool open(const char* path);
+	void close();
+
+	const u8* data() const { return m_data; }
+	u64 size() const { return m_size; }
+
+private:
+	void* m_handle;
+	void* m_mapping;
+	const u8* m_data = nullptr;
+	u64 m_size = 0;
+};
 	
 
 struct LUMIX_CORE_API OutputFile final : IOutputStream {
@@ -305,6 +305,13 @@ void OutputMemoryStream::writeString(StringView string) {
 }
 
 
+void OutputMemoryStream::align(u32 alignment) {
+	static const u8 zeros[64] = {};
+	ASSERT(alignment <= sizeof(zeros));
+	write(zeros, (alignment - m_size % alignment) % alignment);
+}
+
+
 void OutputMemoryStream::clear()
 {
 	m_size = 0;
@@ -95,9 +95,13 @@ struct LUMIX_CORE_API OutputMemoryStream final : IOutputStream {
 	template <typename T> void write(const T& value);
 	void clear();
 	void* skip(u64 size);
+	// writes zeros until `size()` is a multiple of `alignment`
+	void align(u32 alignment);
 	bool empty() const { return m_size == 0; }
 	void free();
 	IAllocator& getAllocator() { return *m_allocator; }
+	// false for views created with `OutputMemoryStream(void* data, u64 size)`
+	bool ownsData() const { return m_allocator; }
 
 private:
 	u8* m_data;
@@ -115,6 +119,8 @@ struct LUMIX_CORE_API InputMemoryStream final : IInputStream {
 	bool read(void* data, u64 size) override;
 	bool read(String& string);
 	const void* skip(u64 size);
+	// skips to the next multiple of `alignment`, matches `OutputMemoryStream::align`
+	void align(u32 alignment) { skip((alignment - m_pos % alignment) % alignment); }
 	const void* getData() const { return m_data; }
 	u64 size() const override { return m_size; }
 	u64 remaining() const { return m_size - m_pos; }
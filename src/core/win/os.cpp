@@ -196,6 +196,57 @@ bool InputFile::seek(u64 pos)
 }
 
 
+MappedFile::MappedFile()
+{
+	m_handle = (void*)INVALID_HANDLE_VALUE;
+	m_mapping = nullptr;
+}
+
+
+MappedFile::~MappedFile()
+{
+	ASSERT(!m_data);
+}
+
+
+bool MappedFile::open(const char* path)
+{
+	m_handle = (HANDLE)::CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (INVALID_HANDLE_VALUE == (HANDLE)m_handle) return false;
+
+	LARGE_INTEGER size;
+	// empty files can not be mapped
+	if (!::GetFileSizeEx((HANDLE)m_handle, &size) || size.QuadPart == 0) {
+		close();
+		return false;
+	}
+	m_mapping = ::CreateFileMappingA((HANDLE)m_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!m_mapping) {
+		close();
+		return false;
+	}
+	m_data = (const u8*)::MapViewOfFile((HANDLE)m_mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!m_data) {
+		close();
+		return false;
+	}
+	m_size = size.QuadPart;
+	return true;
+}
+
+
+void MappedFile::close()
+{
+	if (m_data) ::UnmapViewOfFile(m_data);
+	if (m_mapping) ::CloseHandle((HANDLE)m_mapping);
+	if (INVALID_HANDLE_VALUE != (HANDLE)m_handle) ::CloseHandle((HANDLE)m_handle);
+	m_data = nullptr;
+	m_size = 0;
+	m_mapping = nullptr;
+	m_handle = (void*)INVALID_HANDLE_VALUE;
+}
+
+
 static void fromWChar(Span<char> out, const WCHAR* in) {
 	i32 written = WideCharToMultiByte(CP_UTF8, 0, in, -1, out.begin(), out.length(), nullptr, nullptr);
 	FATAL_CHECK(written > 0 && out[written - 1] == 0);
@@ -230,7 +230,7 @@ struct AssetCompilerImpl : AssetCompiler {
 		constexpr u32 COMPRESSION_SIZE_LIMIT = 4096;
 		OutputMemoryStream compressed(m_allocator);
 		if (data.length() > COMPRESSION_SIZE_LIMIT) {
-			if (!m_app.getEngine().compress(data, compressed)) {
+			if (!m_app.getEngine().compressBlocks(data, compressed)) {
 				logWarning("Could not compress ", path, ", using uncompressed file.");
 				compressed.clear();
 			}
@@ -247,7 +247,7 @@ struct AssetCompilerImpl : AssetCompiler {
 		header.decompressed_size = data.length();
 		const u32 compressed_size = (u32)compressed.size();
 		if (data.length() > COMPRESSION_SIZE_LIMIT && compressed_size > 0 && compressed_size < i32(data.length() / 4 * 3)) {
-			header.flags |= CompiledResourceHeader::COMPRESSED;
+			header.flags |= CompiledResourceHeader::COMPRESSED_BLOCKS;
 			(void)file.write(&header, sizeof(header));
 			(void)file.write(compressed.data(), compressed_size);
 		}
@@ -33,6 +33,7 @@
 #include "engine/engine.h"
 #include "engine/file_system.h"
 #include "engine/input_system.h"
+#include "engine/pack_builder.h"
 #include "engine/reflection.h"
 #include "engine/resource_manager.h"
 #include "engine/world.h"
@@ -1000,6 +1001,8 @@ struct StudioAppImpl final : StudioApp {
 		m_settings.registerOption("code_editor_font_size", &CodeEditor::s_font_size, "Code editor", "Font size").setMin(1);
 		m_settings.registerOption("code_editor_show_line_nums", &CodeEditor::s_show_line_numbers, "Code editor", "Show line numbers");
 		m_settings.registerOption("export_pack", &m_export.pack);
+		m_settings.registerOption("export_pack_alignment", &m_export.pack_alignment);
+		m_settings.registerOption("export_blittable_worlds", &m_export.blittable_worlds);
 		m_settings.registerOption("export_dir", &m_export.dest_dir);
 		m_settings.registerOption("gizmo_scale", &m_gizmo_config.scale, "General", "Gizmo scale").setMin(0.001f);
 		m_settings.registerOption("fov", &m_fov, "General", "FOV").setMin(1).setMax(179).setIsAngle(true);
@@ -1429,6 +1432,8 @@ struct StudioAppImpl final : StudioApp {
 		}
 
 		InputMemoryStream blob(data); 
+		// game preloads resources from the manifest, additive loads record manifest of the loaded partition
+		m_engine->getResourceManager().recordManifest(ResourceManagerHub::getManifestPath(path));
 		m_editor->loadWorld(blob, path.c_str(), additive);
 	}
 
@@ -2761,9 +2766,6 @@ struct StudioAppImpl final : StudioApp {
 
 	struct ExportFileInfo {
 		FilePathHash hash;
-		u64 offset;
-		u64 size;
-
 		char path[MAX_PATH];
 	};
 
@@ -2780,9 +2782,6 @@ struct StudioAppImpl final : StudioApp {
 			u64 tmp_hash;
 			fromCString(basename, tmp_hash);
 			rec.hash = FilePathHash::fromU64(tmp_hash);
-			rec.offset = 0;
-			const Path path = fs.getFullPath(Path(".lumix/resources/", info.filename));
-			rec.size = os::getFileSize(path);
 			copyString(rec.path, ".lumix/resources/");
 			catString(rec.path, info.filename);
 			infos.insert(rec.hash, rec);
@@ -2795,14 +2794,10 @@ struct StudioAppImpl final : StudioApp {
 
 
 	void exportFile(const char* file_path, AssociativeArray<FilePathHash, ExportFileInfo>& infos) {
-		FileSystem& fs = m_engine->getFileSystem();
 		const FilePathHash hash(file_path);
 		ExportFileInfo& out_info = infos.emplace(hash);
 		copyString(out_info.path, file_path);
 		out_info.hash = hash;
-		const Path path = fs.getFullPath(file_path);
-		out_info.size = os::getFileSize(path);
-		out_info.offset = ~0UL;
 	}
 
 	void exportDataScan(const char* dir_path, AssociativeArray<FilePathHash, ExportFileInfo>& infos)
@@ -2843,9 +2838,6 @@ struct StudioAppImpl final : StudioApp {
 			auto& out_info = infos.emplace(hash);
 			copyString(out_info.path, out_path);
 			out_info.hash = hash;
-			const Path path = fs.getFullPath(out_path);
-			out_info.size = os::getFileSize(path);
-			out_info.offset = ~0UL;
 		}
 		destroyFileIterator(iter);
 	}
@@ -2865,8 +2857,6 @@ struct StudioAppImpl final : StudioApp {
 					auto& out_info = infos.emplace(hash);
 					copyString(Span(out_info.path), baked_path);
 					out_info.hash = hash;
-					out_info.size = os::getFileSize(baked_path);
-					out_info.offset = ~0UL;
 				}
 			}
 		}
@@ -2892,6 +2882,13 @@ struct StudioAppImpl final : StudioApp {
 
 			ImGuiEx::Label("Pack data");
 			ImGui::Checkbox("##pack", &m_export.pack);
+			if (m_export.pack) {
+				ImGuiEx::Label("Pack alignment");
+				ImGui::InputInt("##pack_align", &m_export.pack_alignment);
+			}
+			ImGuiEx::Label("Blittable worlds");
+			ImGui::Checkbox("##blittable_worlds", &m_export.blittable_worlds);
+			if (ImGui::IsItemHovered()) ImGui::SetTooltip("Faster loading, but the game must be built with the same configuration as the editor");
 			ImGuiEx::Label("Mode");
 			ImGui::Combo("##mode", (int*)&m_export.mode, "All files\0Loaded world\0");
 
@@ -2924,6 +2921,62 @@ struct StudioAppImpl final : StudioApp {
 	}
 
 
+	// files are stored in the order worlds load them, startup world first, see `ResourceManagerHub::recordManifest`
+	void addPackLoadTraces(PackBuilder& builder) {
+		FileSystem& fs = m_engine->getFileSystem();
+		Array<Path> worlds(m_allocator);
+		if (!m_export.startup_world.isEmpty()) worlds.push(m_export.startup_world);
+		forEachWorld([&](const Path& path){
+			if (path.getHash() != m_export.startup_world.getHash()) worlds.push(path);
+		});
+
+		OutputMemoryStream manifest(m_allocator);
+		for (const Path& world : worlds) {
+			const Path manifest_path = ResourceManagerHub::getManifestPath(world);
+			if (!fs.fileExists(manifest_path)) continue;
+
+			manifest.clear();
+			if (!fs.getContentSync(manifest_path, manifest) || !builder.addLoadTrace(manifest)) {
+				logWarning("Could not use ", manifest_path, " as load trace");
+			}
+		}
+	}
+
+	// converted world is saved to `.lumix/export/`, editor data following the world (prefabs, folders) is not needed by the game
+	bool convertWorldToBlittable(const Path& path, Path& converted_path) {
+		FileSystem& fs = m_engine->getFileSystem();
+		OutputMemoryStream data(m_allocator);
+		if (!fs.getContentSync(path, data)) {
+			logError("Could not read ", path);
+			return false;
+		}
+
+		World& world = m_engine->createWorld();
+		InputMemoryStream blob(data);
+		EntityMap entity_map(m_allocator);
+		WorldVersion version;
+		const bool loaded = world.deserialize(blob, entity_map, version);
+		OutputMemoryStream converted(m_allocator);
+		if (loaded) world.serialize(converted, WorldSerializeFlags::BLITTABLE);
+		m_engine->destroyWorld(world);
+		if (!loaded) {
+			logError("Could not load ", path);
+			return false;
+		}
+
+		converted_path = Path(".lumix/export/", path);
+		const Path dir = fs.getFullPath(Path::getDir(converted_path));
+		if (!os::makePath(dir.c_str()) && !os::dirExists(dir.c_str())) {
+			logError("Failed to create ", dir);
+			return false;
+		}
+		if (!fs.saveContentSync(converted_path, converted)) {
+			logError("Could not save ", converted_path);
+			return false;
+		}
+		return true;
+	}
+
 	bool exportData() {
 		if (m_export.dest_dir.length() == 0) return false;
 
@@ -2947,49 +3000,40 @@ struct StudioAppImpl final : StudioApp {
 			case ExportConfig::Mode::CURRENT_WORLD: exportDataScanResources(infos); break;
 		}
 
+		struct ConvertedWorld {
+			Path path;
+			Path converted_path;
+		};
+		Array<ConvertedWorld> converted_worlds(m_allocator);
+		if (m_export.blittable_worlds) {
+			bool failed = false;
+			forEachWorld([&](const Path& path){
+				ConvertedWorld& world = converted_worlds.emplace();
+				world.path = path;
+				failed = !convertWorldToBlittable(path, world.converted_path) || failed;
+			});
+			if (failed) return false;
+		}
+
 		if (m_export.pack) {
 			StaticString<MAX_PATH> dest(m_export.dest_dir, "main.pak");
 			if (infos.size() == 0) {
 				logError("No files found while trying to create ", dest);
 				return false;
 			}
-			u64 total_size = 0;
-			for (ExportFileInfo& info : infos) {
-				info.offset = total_size;
-				total_size += info.size;
-			}
-			
-			os::OutputFile file;
-			if (!file.open(dest)) {
-				logError("Could not create ", dest);
-				return false;
+			UniquePtr<PackBuilder> builder = PackBuilder::create(fs, m_allocator);
+			builder->setAlignment(maximum(m_export.pack_alignment, 1));
+			addPackLoadTraces(*builder);
+			// added first, so they replace the original files; not compressed, so they can be used directly from the pak
+			for (const ConvertedWorld& world : converted_worlds) {
+				builder->addFile(world.path, world.converted_path, PackBuilder::Compression::NONE);
 			}
-
-			const u32 count = (u32)infos.size();
-			bool success = file.write(&count, sizeof(count));
-
-			for (auto& info : infos) {
-				success = file.write(&info.hash, sizeof(info.hash)) && success;
-				success = file.write(&info.offset, sizeof(info.offset)) && success;
-				success = file.write(&info.size, sizeof(info.size)) && success;
-			}
-
-			OutputMemoryStream src(m_allocator);
 			for (const ExportFileInfo& info : infos) {
-				src.clear();
-				if (!fs.getContentSync(Path(info.path), src)) {
-					logError("Could not read ", info.path);
-					file.close();
-					return false;
-				}
-				success = file.write(src.data(), src.size()) && success;
-			}
-			file.close();
-
-			if (!success) {
-				logError("Could not write ", dest);
-				return false;
+				builder->addFile(Path(info.path), PackBuilder::Compression::AUTO);
 			}
+			PackBuilder::Report report;
+			if (!builder->write(dest, report)) return false;
+			logPackReport(report);
 		}
 		else {
 			for (auto& info : infos) {
@@ -3006,6 +3050,19 @@ struct StudioAppImpl final : StudioApp {
 					return false;
 				}
 			}
+			for (const ConvertedWorld& world : converted_worlds) {
+				const Path src = fs.getFullPath(world.converted_path);
+				StaticString<MAX_PATH> dst(m_export.dest_dir, world.path);
+				StaticString<MAX_PATH> dst_dir(m_export.dest_dir, Path::getDir(world.path));
+				if (!os::makePath(dst_dir) && !os::dirExists(dst_dir)) {
+					logError("Failed to create ", dst_dir);
+					return false;
+				}
+				if (!os::copyFile(src, dst)) {
+					logError("Failed to copy ", src, " to ", dst);
+					return false;
+				}
+			}
 		}
 
 		const char* bin_files[] = {"app.exe", "dbghelp.dll", "dbgcore.dll"};
@@ -3163,6 +3220,11 @@ struct StudioAppImpl final : StudioApp {
 		Mode mode = Mode::ALL_FILES;
 
 		bool pack = false;
+		// of files in the pak, e.g. sector size for direct I/O
+		i32 pack_alignment = 1;
+		// worlds are stored with `WorldSerializeFlags::BLITTABLE`, such worlds depend on memory layout,
+		// so the exported app must be built with the same configuration as the editor
+		bool blittable_worlds = false;
 		Path startup_world;
 		String dest_dir;
 	};
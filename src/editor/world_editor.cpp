@@ -1991,7 +1991,11 @@ public:
 		OutputMemoryStream blob(m_allocator);
 		blob.reserve(64 * 1024);
 
-		m_world->serialize(blob, is_game_mode_save ? WorldSerializeFlags::HAS_PARTITIONS : WorldSerializeFlags::NONE);
+		// game mode save is loaded back by this process, so it can use the blittable layout
+		const WorldSerializeFlags flags = is_game_mode_save
+			? WorldSerializeFlags::HAS_PARTITIONS | WorldSerializeFlags::BLITTABLE
+			: WorldSerializeFlags::NONE;
+		m_world->serialize(blob, flags);
 		m_prefab_system->serialize(blob);
 		m_entity_folders->serialize(blob);
 		if (m_view) {
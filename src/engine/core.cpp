@@ -77,6 +77,8 @@ struct CoreModuleImpl : CoreModule {
 		return nullptr;
 	}
 
+	bool canDeserializeInParallel() const override { return true; }
+
 	void deserialize(InputMemoryStream& serializer, const EntityMap& entity_map, i32 version) override {
 		u32 count;
 		if (version > (i32)CoreModuleVersion::SIGNALS) {
@@ -117,6 +119,51 @@ struct CoreModuleImpl : CoreModule {
 		}
 	}
 
+	bool takeSnapshot(OutputMemoryStream& blob) override {
+		blob.write((u32)m_signals.size());
+		for (const UniquePtr<Signal>& signal : m_signals) blob.write(*signal.get());
+
+		blob.write((u32)m_splines.size());
+		for (auto iter : m_splines.iterated()) {
+			blob.write(iter.key());
+			blob.writeArray(iter.value().points);
+		}
+		return true;
+	}
+
+	void restoreSnapshot(InputMemoryStream& blob) override {
+		// components which are not in the snapshot are destroyed afterwards
+		HashMap<EntityRef, u32> restored(m_allocator);
+		const u32 signals_count = blob.read<u32>();
+		restored.reserve(signals_count);
+		for (u32 i = 0; i < signals_count; ++i) {
+			const Signal signal = blob.read<Signal>();
+			// existing signals are updated in place, since signal dispatchers point to them
+			if (!m_signals.find(signal.entity).isValid()) createSignal(signal.entity);
+			*m_signals[signal.entity].get() = signal;
+			restored.insert(signal.entity, i);
+		}
+		Array<EntityRef> to_destroy(m_allocator);
+		for (auto iter : m_signals.iterated()) {
+			if (!restored.find(iter.key()).isValid()) to_destroy.push(iter.key());
+		}
+		for (EntityRef e : to_destroy) destroySignal(e);
+
+		restored.clear();
+		to_destroy.clear();
+		const u32 splines_count = blob.read<u32>();
+		for (u32 i = 0; i < splines_count; ++i) {
+			const EntityRef e = blob.read<EntityRef>();
+			if (!m_splines.find(e).isValid()) createSpline(e);
+			blob.readArray(&m_splines[e].points);
+			restored.insert(e, i);
+		}
+		for (auto iter : m_splines.iterated()) {
+			if (!restored.find(iter.key()).isValid()) to_destroy.push(iter.key());
+		}
+		for (EntityRef e : to_destroy) destroySpline(e);
+	}
+
 	struct SignalDispatcher : reflection::EventBase::Callback {
 		SignalDispatcher(IAllocator& allocator) : map(allocator) {}
 
@@ -170,6 +217,7 @@ struct CoreModuleImpl : CoreModule {
 	const char* getName() const override { return "core"; }
 	ISystem& getSystem() const override { return m_system; }
 	void update(float time_delta) override {}
+	bool getUpdateAccess(ModuleUpdateAccess& access) const override { return true; }
 	World& getWorld() override { return m_world; }
 
 	void createSpline(EntityRef e) override {
@@ -25,6 +25,7 @@ namespace Lumix
 {
 
 static const u32 SERIALIZED_PROJECT_MAGIC = 0x5f50524c;
+static const u32 COMPRESSION_BLOCK_SIZE = 512 * 1024;
 
 struct PrefabResourceManager final : ResourceManager {
 	explicit PrefabResourceManager(IAllocator& allocator)
@@ -44,6 +45,25 @@ struct PrefabResourceManager final : ResourceManager {
 };
 
 
+static bool isExcluded(Span<const char*> excluded_systems, const char* name) {
+	for (const char* excluded : excluded_systems) {
+		if (equalStrings(excluded, name)) return true;
+	}
+	return false;
+}
+
+
+struct ModuleUpdateNode {
+	IModule* module;
+	ModuleUpdateAccess access;
+	bool declared;
+	u64 owned_components = 0;
+	u32 wave = 0;
+	// must wait for frame fence, see `Engine::setFrameFence`
+	bool fenced = false;
+};
+
+
 struct EngineImpl final : Engine {
 	void operator=(const EngineImpl&) = delete;
 	EngineImpl(const EngineImpl&) = delete;
@@ -58,6 +78,9 @@ struct EngineImpl final : Engine {
 		, m_time_multiplier(1.0f)
 		, m_paused(false)
 		, m_next_frame(false)
+		, m_lz4_states(m_allocator)
+		, m_update_nodes(m_allocator)
+		, m_wave_nodes(m_allocator)
 	{
 		PROFILE_FUNCTION();
 		for (float& f : m_last_time_deltas) f = 1/60.f;
@@ -71,12 +94,12 @@ struct EngineImpl final : Engine {
 			m_file_system = static_cast<UniquePtr<FileSystem>&&>(init_data.file_system);
 		}
 		else if (init_data.engine_data_dir) {
-			m_file_system = FileSystem::create(init_data.engine_data_dir, m_allocator);
+			m_file_system = FileSystem::create(init_data.engine_data_dir, m_allocator, init_data.io_threads);
 		}
 		else {			
 			char current_dir[MAX_PATH];
 			os::getCurrentDirectory(Span(current_dir));
-			m_file_system = FileSystem::create(current_dir, m_allocator);
+			m_file_system = FileSystem::create(current_dir, m_allocator, init_data.io_threads);
 		}
 
 		m_is_log_file_open = m_file_system->open(init_data.log_path, m_log_file);
@@ -99,13 +122,14 @@ struct EngineImpl final : Engine {
 
 		logInfo("Engine created.");
 
-		SystemManager::createAllStatic(*this);
+		SystemManager::createAllStatic(*this, init_data.excluded_systems);
 
 		m_system_manager->addSystem(createCorePlugin(*this), nullptr);
 
 		#ifdef LUMIXENGINE_PLUGINS
 			const char* plugins[] = { LUMIXENGINE_PLUGINS };
 			for (auto* plugin_name : plugins) {
+				if (isExcluded(init_data.excluded_systems, plugin_name)) continue;
 				if (plugin_name[0] && !m_system_manager->load(plugin_name)) {
 					logInfo(plugin_name, " plugin has not been loaded");
 				}
@@ -113,12 +137,11 @@ struct EngineImpl final : Engine {
 		#endif
 
 		for (auto* plugin_name : init_data.plugins) {
+			if (isExcluded(init_data.excluded_systems, plugin_name)) continue;
 			if (plugin_name[0] && !m_system_manager->load(plugin_name)) {
 				logInfo(plugin_name, " plugin has not been loaded");
 			}
 		}
-
-		m_lz4_state = (u8*)m_allocator.allocate(LZ4_sizeofState(), 8);
 	}
 
 	void setMainWindow(os::WindowHandle wnd) override {
@@ -131,12 +154,13 @@ struct EngineImpl final : Engine {
 
 	~EngineImpl()
 	{
-		m_allocator.deallocate(m_lz4_state);
+		for (u8* state : m_lz4_states) m_allocator.deallocate(state);
 		
 		for (ISystem* system : m_system_manager->getSystems()) {
 			system->shutdownStarted();
 		}
 
+		m_resource_manager.disableCache();
 		m_prefab_resource_manager.destroy();
 
 		m_system_manager.reset();
@@ -206,6 +230,12 @@ struct EngineImpl final : Engine {
 
 	void destroyWorld(World& world) override
 	{
+		if (&world == m_update_waves_world) {
+			// another world can be created at the same address
+			m_update_waves_world = nullptr;
+			m_update_nodes.clear();
+			m_update_waves_count = 0;
+		}
 		LUMIX_DELETE(m_allocator, &world);
 		m_resource_manager.removeUnreferenced();
 	}
@@ -261,18 +291,296 @@ struct EngineImpl final : Engine {
 		const i32 cap = LZ4_compressBound(mem.length());
 		const u32 start_size = (u32)output.size();
 		output.resize(cap + start_size);
-		jobs::MutexGuard guard(m_lz4_mutex);
-		const i32 compressed_size = LZ4_compress_fast_extState(m_lz4_state, (const char*)mem.begin(), (char*)output.getMutableData() + start_size, mem.length(), cap, 1); 
+		u8* state = allocLZ4State();
+		const i32 compressed_size = LZ4_compress_fast_extState(state, (const char*)mem.begin(), (char*)output.getMutableData() + start_size, mem.length(), cap, 1); 
+		releaseLZ4State(state);
 		if (compressed_size == 0) return false;
 		output.resize(compressed_size + start_size);
 		return true;
 	}
 
+	// states are reused, there are at most as many of them as there are threads compressing at once
+	u8* allocLZ4State() {
+		{
+			jobs::MutexGuard guard(m_lz4_mutex);
+			if (!m_lz4_states.empty()) {
+				u8* state = m_lz4_states.back();
+				m_lz4_states.pop();
+				return state;
+			}
+		}
+		return (u8*)m_allocator.allocate(LZ4_sizeofState(), 8);
+	}
+
+	void releaseLZ4State(u8* state) {
+		jobs::MutexGuard guard(m_lz4_mutex);
+		m_lz4_states.push(state);
+	}
+
+	// format: u32 block_size, u32 blocks_count, u32 compressed_size[blocks_count], compressed blocks
+	bool compressBlocks(Span<const u8> src, OutputMemoryStream& dst) override {
+		PROFILE_FUNCTION();
+		const u32 blocks_count = u32((src.length() + COMPRESSION_BLOCK_SIZE - 1) / COMPRESSION_BLOCK_SIZE);
+		const i32 block_cap = LZ4_compressBound(COMPRESSION_BLOCK_SIZE);
+		OutputMemoryStream tmp(m_allocator);
+		tmp.resize(u64(block_cap) * blocks_count);
+		Array<i32> compressed_sizes(m_allocator);
+		compressed_sizes.resize(blocks_count);
+
+		jobs::forEach(blocks_count, 1, [&](i32 from, i32 to){
+			PROFILE_BLOCK("compress blocks");
+			u8* state = allocLZ4State();
+			for (i32 i = from; i < to; ++i) {
+				const u64 offset = u64(i) * COMPRESSION_BLOCK_SIZE;
+				const i32 size = (i32)minimum(u64(COMPRESSION_BLOCK_SIZE), src.length() - offset);
+				char* block = (char*)tmp.getMutableData() + u64(i) * block_cap;
+				compressed_sizes[i] = LZ4_compress_fast_extState(state, (const char*)src.begin() + offset, block, size, block_cap, 1);
+			}
+			releaseLZ4State(state);
+		});
+
+		dst.write(COMPRESSION_BLOCK_SIZE);
+		dst.write(blocks_count);
+		for (i32 size : compressed_sizes) {
+			if (size == 0) return false;
+			dst.write((u32)size);
+		}
+		for (u32 i = 0; i < blocks_count; ++i) {
+			dst.write(tmp.data() + u64(i) * block_cap, compressed_sizes[i]);
+		}
+		return true;
+	}
+
+	bool decompressBlocks(Span<const u8> src, Span<u8> dst) override {
+		PROFILE_FUNCTION();
+		InputMemoryStream blob(src);
+		const u32 block_size = blob.read<u32>();
+		const u32 blocks_count = blob.read<u32>();
+		if (blob.hasOverflow() || block_size == 0) return false;
+		if (u64(blocks_count) * block_size < dst.length()) return false;
+		if (blocks_count > 0 && u64(blocks_count - 1) * block_size >= dst.length()) return false;
+		
+		const u32* compressed_sizes = (const u32*)blob.skip(blocks_count * sizeof(u32));
+		if (blob.hasOverflow()) return false;
+		Array<u64> offsets(m_allocator);
+		offsets.resize(blocks_count);
+		u64 offset = blob.getPosition();
+		for (u32 i = 0; i < blocks_count; ++i) {
+			offsets[i] = offset;
+			offset += compressed_sizes[i];
+		}
+		if (offset > src.length()) return false;
+
+		AtomicI32 failed = 0;
+		jobs::forEach(blocks_count, 1, [&](i32 from, i32 to){
+			PROFILE_BLOCK("decompress blocks");
+			for (i32 i = from; i < to; ++i) {
+				const u64 dst_offset = u64(i) * block_size;
+				const i32 size = (i32)minimum(u64(block_size), dst.length() - dst_offset);
+				const i32 res = LZ4_decompress_safe((const char*)src.begin() + offsets[i], (char*)dst.begin() + dst_offset, compressed_sizes[i], size);
+				if (res != size) failed = 1;
+			}
+		});
+		return failed == 0;
+	}
+
 	void setTimeMultiplier(float multiplier) override
 	{
 		m_time_multiplier = maximum(multiplier, 0.001f);
 	}
 
+	void setFixedTimeDelta(float time_delta) override {
+		m_fixed_time_delta = maximum(time_delta, 0.f);
+	}
+
+	static bool conflicts(const ModuleUpdateNode& a, const ModuleUpdateNode& b) {
+		if (!a.declared || !b.declared) return true;
+		if (a.access.write_transforms && (b.access.read_transforms || b.access.write_transforms)) return true;
+		if (b.access.write_transforms && a.access.read_transforms) return true;
+		if (a.access.write_components & (b.access.read_components | b.access.write_components)) return true;
+		if (b.access.write_components & a.access.read_components) return true;
+		// accessing components of a module means calling into that module
+		if ((a.access.read_components | a.access.write_components) & b.owned_components) return true;
+		if ((b.access.read_components | b.access.write_components) & a.owned_components) return true;
+		if (a.access.dependsOn(b.module->getName()) || b.access.dependsOn(a.module->getName())) return true;
+		// both call into the same module
+		for (const char* module : a.access.modules) {
+			if (module && b.access.dependsOn(module)) return true;
+		}
+		return false;
+	}
+
+	// modules in the same wave do not conflict with each other and are updated concurrently
+	// conflicting modules are updated in module order, undeclared modules conflict with everything, so they are alone in their wave
+	void buildUpdateWaves(World& world) {
+		if (!m_update_waves_dirty && &world == m_update_waves_world && world.getModules().size() == m_update_waves_modules_count) return;
+
+		PROFILE_FUNCTION();
+		m_update_waves_dirty = false;
+		m_update_waves_world = &world;
+		m_update_waves_modules_count = world.getModules().size();
+		m_update_nodes.clear();
+		for (UniquePtr<IModule>& module : world.getModules()) {
+			ModuleUpdateNode& node = m_update_nodes.emplace();
+			node.module = module.get();
+			node.declared = module->getUpdateAccess(node.access);
+		}
+		// calling into an undeclared or missing module can touch anything, so the caller is undeclared too
+		bool changed = true;
+		while (changed) {
+			changed = false;
+			for (ModuleUpdateNode& node : m_update_nodes) {
+				if (!node.declared) continue;
+				for (const char* dependency : node.access.modules) {
+					if (!dependency) continue;
+					const i32 idx = m_update_nodes.find([&](const ModuleUpdateNode& n){ return equalStrings(n.module->getName(), dependency); });
+					if (idx < 0 || !m_update_nodes[idx].declared) {
+						node.declared = false;
+						changed = true;
+						break;
+					}
+				}
+			}
+		}
+		for (i32 i = 0; i < ComponentType::MAX_TYPES_COUNT; ++i) {
+			IModule* owner = world.getModule(ComponentType{i});
+			if (!owner) continue;
+			for (ModuleUpdateNode& node : m_update_nodes) {
+				if (node.module == owner) node.owned_components |= u64(1) << i;
+			}
+		}
+		if (m_frame_fence.isValid()) markFencedModules();
+		m_update_waves_count = 0;
+		for (i32 i = 0; i < m_update_nodes.size(); ++i) {
+			ModuleUpdateNode& node = m_update_nodes[i];
+			for (i32 j = 0; j < i; ++j) {
+				if (conflicts(node, m_update_nodes[j])) node.wave = maximum(node.wave, m_update_nodes[j].wave + 1);
+			}
+			m_update_waves_count = maximum(m_update_waves_count, node.wave + 1);
+		}
+	}
+
+	// module is fenced if it can touch data of the fenced module, directly or through other fenced modules
+	// undeclared modules can touch anything, world transforms are read by fenced module's jobs too
+	void markFencedModules() {
+		bool changed = true;
+		while (changed) {
+			changed = false;
+			for (ModuleUpdateNode& node : m_update_nodes) {
+				if (node.fenced) continue;
+				node.fenced = !node.declared
+					|| node.access.write_transforms
+					|| (m_frame_fence_module && equalStrings(node.module->getName(), m_frame_fence_module));
+				for (const ModuleUpdateNode& other : m_update_nodes) {
+					if (node.fenced) break;
+					if (!other.fenced) continue;
+					node.fenced = node.access.dependsOn(other.module->getName())
+						|| ((node.access.read_components | node.access.write_components) & other.owned_components) != 0;
+				}
+				changed = changed || node.fenced;
+			}
+		}
+	}
+
+	void setFrameFence(const char* module, Delegate<void()> fence) override {
+		m_frame_fence = fence;
+		m_frame_fence_module = module;
+		m_update_waves_dirty = true;
+	}
+
+	u32 getUpdateWave(World& world, const IModule& module) override {
+		buildUpdateWaves(world);
+		for (const ModuleUpdateNode& node : m_update_nodes) {
+			if (node.module == &module) return node.wave;
+		}
+		ASSERT(false);
+		return 0;
+	}
+
+	// ends the frame of fenced modules, since they could not do it before the fence
+	void waitForFrameFence() {
+		if (!m_frame_fence.isValid()) return;
+		{
+			PROFILE_BLOCK("wait for frame fence");
+			m_frame_fence.invoke();
+		}
+		for (const ModuleUpdateNode& node : m_update_nodes) {
+			if (node.fenced) node.module->endFrame();
+		}
+	}
+
+	// with frame fence, `unfenced` modules run before the fence and the rest after it
+	void updateParallel(bool unfenced, float dt) {
+		m_wave_nodes.clear();
+		for (const ModuleUpdateNode& node : m_update_nodes) {
+			const bool is_unfenced = !node.fenced || node.module->isUpdateParallelUnfenced();
+			if (is_unfenced == unfenced) m_wave_nodes.push(&node);
+		}
+		if (m_wave_nodes.empty()) return;
+		// per-module blocks are named after the module, so they can be attributed in profiler/benchmarks
+		jobs::forEach(m_wave_nodes.size(), 1, [&](u32 idx, u32){
+			PROFILE_BLOCK("update parallel");
+			profiler::Scope module_scope(m_wave_nodes[idx]->module->getName());
+			m_wave_nodes[idx]->module->updateParallel(dt);
+		});
+	}
+
+	static void updateModule(const ModuleUpdateNode& node, bool late, float dt) {
+		profiler::Scope module_scope(node.module->getName());
+		World::UpdateValidation validation;
+		validation.module = node.module;
+		validation.access = &node.access;
+		if (node.declared) World::setUpdateValidation(&validation);
+		if (late) node.module->lateUpdate(dt);
+		else node.module->update(dt);
+		if (node.declared) World::setUpdateValidation(nullptr);
+	}
+
+	void updateModules(bool late, float dt) {
+		for (u32 wave = 0; wave < m_update_waves_count; ++wave) {
+			m_wave_nodes.clear();
+			for (const ModuleUpdateNode& node : m_update_nodes) {
+				if (node.wave == wave) m_wave_nodes.push(&node);
+			}
+			if (m_wave_nodes.size() == 1) {
+				updateModule(*m_wave_nodes[0], late, dt);
+				continue;
+			}
+			jobs::forEach(m_wave_nodes.size(), 1, [&](i32 idx, i32){
+				updateModule(*m_wave_nodes[idx], late, dt);
+			});
+		}
+	}
+
+	void setFixedTimeStep(float time_step, u32 max_substeps) override {
+		m_fixed_time_step = time_step;
+		m_max_fixed_substeps = maximum(max_substeps, 1);
+		m_fixed_time_accumulator = 0;
+		m_fixed_step_alpha = 1;
+	}
+
+	float getFixedTimeStep() const override { return m_fixed_time_step; }
+	float getFixedStepAlpha() const override { return m_fixed_step_alpha; }
+
+	void fixedUpdate(World& world, float dt) {
+		PROFILE_FUNCTION();
+		m_fixed_time_accumulator += dt;
+		u32 substeps = 0;
+		while (m_fixed_time_accumulator >= m_fixed_time_step && substeps < m_max_fixed_substeps) {
+			for (UniquePtr<IModule>& module : world.getModules()) {
+				profiler::Scope module_scope(module->getName());
+				module->fixedUpdate(m_fixed_time_step);
+			}
+			m_fixed_time_accumulator -= m_fixed_time_step;
+			++substeps;
+		}
+		// drop what we can not catch up with
+		if (m_fixed_time_accumulator >= m_fixed_time_step) m_fixed_time_accumulator = fmodf(m_fixed_time_accumulator, m_fixed_time_step);
+		m_fixed_step_alpha = m_fixed_time_accumulator / m_fixed_time_step;
+		static u32 substeps_counter = profiler::createCounter("Fixed substeps", 0);
+		profiler::pushCounter(substeps_counter, float(substeps));
+	}
+
 	void computeSmoothTimeDelta() {
 		float tmp[11];
 		memcpy(tmp, m_last_time_deltas, sizeof(tmp));
@@ -288,10 +596,11 @@ struct EngineImpl final : Engine {
 
 	void update(World& world) override
 	{
+		buildUpdateWaves(world);
 		{
 			PROFILE_BLOCK("end frame");
-			for (UniquePtr<IModule>& module : world.getModules()) {
-				module->endFrame();
+			for (const ModuleUpdateNode& node : m_update_nodes) {
+				if (!node.fenced) node.module->endFrame();
 			}
 		}
 
@@ -306,6 +615,7 @@ struct EngineImpl final : Engine {
 		#endif
 
 		float dt = m_timer.tick() * m_time_multiplier;
+		if (m_fixed_time_delta > 0) dt = m_fixed_time_delta * m_time_multiplier;
 		if (m_next_frame) dt = 1 / 30.0f;
 		++m_last_time_deltas_frame;
 		m_last_time_deltas[m_last_time_deltas_frame % lengthOf(m_last_time_deltas)] = dt;
@@ -314,29 +624,28 @@ struct EngineImpl final : Engine {
 
 		computeSmoothTimeDelta();
 
-		if (!m_paused || m_next_frame) {
-			auto& modules =  world.getModules();
-			jobs::forEach(modules.size(), 1, [&](u32 idx, u32){
-				modules[idx]->updateParallel(dt);
-			});
+		const bool is_updating = !m_paused || m_next_frame;
+		if (is_updating) updateParallel(true, dt);
+		waitForFrameFence();
+
+		if (is_updating) {
+			updateParallel(false, dt);
+			if (m_fixed_time_step > 0) fixedUpdate(world, dt);
 			{
 				PROFILE_BLOCK("update modules");
-				for (UniquePtr<IModule>& module : modules)
-				{
-					module->update(dt);
-				}
+				updateModules(false, dt);
 			}
 			{
 				PROFILE_BLOCK("late update modules");
-				for (UniquePtr<IModule>& module : modules)
-				{
-					module->lateUpdate(dt);
-				}
+				updateModules(true, dt);
 			}
 			m_system_manager->update(dt);
 		}
+		// no-op unless world is in deferred transforms mode
+		world.updateTransforms();
 		m_input_system->update(dt);
 		m_file_system->processCallbacks();
+		m_resource_manager.update();
 		m_next_frame = false;
 	}
 
@@ -411,6 +720,11 @@ private:
 	UniquePtr<InputSystem> m_input_system;
 	os::Timer m_timer;
 	float m_time_multiplier;
+	float m_fixed_time_delta = 0;
+	float m_fixed_time_step = 0;
+	u32 m_max_fixed_substeps = 4;
+	float m_fixed_time_accumulator = 0;
+	float m_fixed_step_alpha = 1;
 	float m_last_time_deltas[11] = {};
 	u32 m_last_time_deltas_frame = 0;
 	float m_smooth_time_delta;
@@ -420,8 +734,17 @@ private:
 	os::WindowHandle m_window_handle = os::INVALID_WINDOW;
 	os::OutputFile m_log_file;
 	bool m_is_log_file_open = false;
-	u8* m_lz4_state = nullptr;
+	Array<u8*> m_lz4_states;
 	jobs::Mutex m_lz4_mutex;
+	Array<ModuleUpdateNode> m_update_nodes;
+	Array<const ModuleUpdateNode*> m_wave_nodes;
+	u32 m_update_waves_count = 0;
+	// waves are rebuilt only when updated world or its set of modules changes, modules are never removed from living world
+	World* m_update_waves_world = nullptr;
+	i32 m_update_waves_modules_count = 0;
+	bool m_update_waves_dirty = true;
+	Delegate<void()> m_frame_fence;
+	const char* m_frame_fence_module = nullptr;
 };
 
 
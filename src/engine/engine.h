@@ -3,6 +3,7 @@
 #include "engine/lumix.h"
 
 #include "core/allocator.h"
+#include "core/delegate.h"
 #include "core/span.h"
 
 namespace Lumix {
@@ -26,6 +27,10 @@ struct LUMIX_ENGINE_API Engine {
 		Span<const char*> plugins;
 		UniquePtr<struct FileSystem> file_system;
 		const char* engine_data_dir = nullptr;
+		// used only if `file_system` is not provided
+		u32 io_threads = 2;
+		// systems which are not loaded, e.g. renderer on dedicated servers
+		Span<const char*> excluded_systems;
 	};
 
 	virtual ~Engine() {}
@@ -59,11 +64,31 @@ struct LUMIX_ENGINE_API Engine {
 	virtual void serializeProject(struct OutputMemoryStream& serializer, const Path& startup_world) const = 0;
 	virtual float getLastTimeDelta() const = 0;
 	virtual void setTimeMultiplier(float multiplier) = 0;
+	// `update` uses `time_delta` instead of measured time, 0 to use measured time; used by benchmarks and captures
+	virtual void setFixedTimeDelta(float time_delta) = 0;
+	// `IModule::fixedUpdate` is called with `time_step` as many times as fits into elapsed time, at most `max_substeps` times per `update`
+	// time which does not fit into `max_substeps` is dropped, so long frames slow the simulation down instead of piling up more work
+	// 0 `time_step` disables fixed steps
+	virtual void setFixedTimeStep(float time_step, u32 max_substeps) = 0;
+	virtual float getFixedTimeStep() const = 0;
+	// [0, 1], how far between the last two fixed steps the current frame is, used to interpolate rendered state
+	virtual float getFixedStepAlpha() const = 0;
+	// pipelined frames - jobs preparing the previous frame for rendering can still run when `update` starts
+	// `fence` waits until they are done, it's called before the first module, which can touch data of `module`, is updated
+	// modules which can not, see `IModule::isUpdateParallelUnfenced`, run in parallel with these jobs
+	// invalid `fence` disables it
+	virtual void setFrameFence(const char* module, Delegate<void()> fence) = 0;
+	// modules in the same wave are updated concurrently, see `IModule::getUpdateAccess`; for benchmarks and tests
+	virtual u32 getUpdateWave(World& world, const struct IModule& module) = 0;
 	virtual void pause(bool pause) = 0;
 	virtual bool isPaused() const = 0;
 	virtual void nextFrame() = 0;
 	virtual bool decompress(Span<const u8> src, Span<u8> dst) = 0;
 	virtual bool compress(Span<const u8> src, OutputMemoryStream& dst) = 0;
+	// independent blocks with a block table, (de)compressed in parallel, not compatible with `compress`/`decompress`
+	// `dst` in `decompressBlocks` must have exactly the size of the uncompressed data
+	virtual bool decompressBlocks(Span<const u8> src, Span<u8> dst) = 0;
+	virtual bool compressBlocks(Span<const u8> src, OutputMemoryStream& dst) = 0;
 
 protected:
 	Engine() {}
@@ -2,16 +2,21 @@
 #include "core/array.h"
 #include "core/delegate_list.h"
 #include "core/hash_map.h"
+#include "core/job_system.h"
 #include "core/log.h"
+#include "core/math.h"
 #include "core/sync.h"
 #include "core/thread.h"
 #include "core/os.h"
 #include "core/path.h"
 #include "core/profiler.h"
+#include "core/sort.h"
 #include "core/stream.h"
 #include "core/string.h"
 
 #include "engine/file_system.h"
+#include "engine/pack_builder.h"
+#include <lz4/lz4.h>
 
 namespace Lumix {
 
@@ -26,18 +31,95 @@ struct AsyncItem {
 		NONE = 0,
 		FAILED = 1 << 0,
 		CANCELED = 1 << 1,
+		PROCESSED = 1 << 2,
+	};
+
+	enum class State : u8 {
+		FREE,
+		QUEUED,
+		READING,
+		PROCESSING,
+		FINISHED
 	};
 
 	AsyncItem(IAllocator& allocator) : data(allocator) {}
 	
 	bool isFailed() const { return isFlagSet(flags, Flags::FAILED); }
 	bool isCanceled() const { return isFlagSet(flags, Flags::CANCELED); }
+	bool needsProcessing() {
+		return process.isValid() && !isFlagSet(flags, Flags::PROCESSED) && !isFailed() && !isCanceled();
+	}
+
+	Span<const u8> getContent() const {
+		if (mapped.length() > 0) return mapped;
+		return Span((const u8*)data.data(), (u32)data.size());
+	}
 
 	FileSystem::ContentCallback callback;
+	FileSystem::ProcessCallback process;
 	OutputMemoryStream data;
+	// owned by file system, e.g. part of mapped pak, used instead of `data` if not empty
+	Span<const u8> mapped;
 	Path path;
 	u32 id = 0;
 	Flags flags = Flags::NONE;
+	State state = State::FREE;
+	FileSystem::Priority priority = FileSystem::Priority::NORMAL;
+	FileSystem::ReadTimes times;
+	bool callback_on_worker = false;
+	jobs::Counter* counter = nullptr;
+	// jobs in `waitAny` / `waitAll`
+	struct Waiter* waiters = nullptr;
+	// jobs in `cancel`, waiting for `process` to return
+	struct Waiter* processing_waiters = nullptr;
+	// incremented when the item is freed, so old handles do not match, wraps only after 2^32 requests using the same item
+	u32 generation = 0;
+};
+
+struct Waiter {
+	jobs::Signal* signal;
+	Waiter* next = nullptr;
+};
+
+// growable ring buffer of item indices
+struct RequestQueue {
+	struct Entry {
+		u32 item;
+		// id of the item when it was pushed, entry is stale if the item has different id now
+		u32 id;
+	};
+
+	RequestQueue(IAllocator& allocator) : entries(allocator) {}
+
+	bool empty() const { return count == 0; }
+
+	void push(u32 item, u32 id) {
+		if (count == (u32)entries.size()) grow();
+		entries[(head + count) & (entries.size() - 1)] = {item, id};
+		++count;
+	}
+
+	Entry pop() {
+		ASSERT(!empty());
+		const Entry e = entries[head];
+		head = (head + 1) & (entries.size() - 1);
+		--count;
+		return e;
+	}
+
+	void grow() {
+		Array<Entry> tmp(entries.getAllocator());
+		tmp.resize(entries.empty() ? 64 : entries.size() * 2);
+		for (u32 i = 0; i < count; ++i) {
+			tmp[i] = entries[(head + i) & (entries.size() - 1)];
+		}
+		entries = static_cast<Array<Entry>&&>(tmp);
+		head = 0;
+	}
+
+	Array<Entry> entries;
+	u32 head = 0;
+	u32 count = 0;
 };
 
 struct FileSystemImpl;
@@ -51,12 +133,10 @@ struct FSTask final : Thread {
 
 	~FSTask() = default;
 
-	void stop();
 	int task() override;
 
 private:
 	FileSystemImpl& m_fs;
-	bool m_finish = false;
 };
 
 struct Mount {
@@ -66,24 +146,50 @@ struct Mount {
 };
 
 struct FileSystemImpl : FileSystem {
-	explicit FileSystemImpl(const char* engine_data_dir, IAllocator& allocator)
+	// max number of requests an io thread takes at once, they are read sorted by `getReadOrder`
+	static constexpr u32 IO_BATCH_SIZE = 8;
+	// `AsyncHandle::value` is item index in low 32 bits and its generation in high 32 bits
+	static u32 getItemIndex(AsyncHandle handle) { return u32(handle.value); }
+
+	explicit FileSystemImpl(const char* engine_data_dir, IAllocator& allocator, u32 io_threads)
 		: m_allocator(allocator)
-		, m_queue(allocator)	
-		, m_finished(allocator)	
+		, m_items(allocator)
+		, m_free_items(allocator)
+		, m_queues(allocator)
+		, m_finished(allocator)
+		, m_tasks(allocator)
 		, m_last_id(0)
 		, m_semaphore(0, 0xffFF)
 		, m_mounts(m_allocator)
 	{
 		mount(engine_data_dir, "engine");
 	
-		m_task.create(*this, m_allocator);
-		m_task->create("Filesystem", true);
+		for (u32 i = 0; i < (u32)Priority::COUNT; ++i) m_queues.emplace(m_allocator);
+		for (u32 i = 0; i < maximum(io_threads, 1u); ++i) {
+			FSTask* task = LUMIX_NEW(m_allocator, FSTask)(*this, m_allocator);
+			task->create("Filesystem", true);
+			m_tasks.push(task);
+		}
 	}
 
 	~FileSystemImpl() override {
-		m_task->stop();
-		m_task->destroy();
-		m_task.destroy();
+		stopWorking();
+		for (AsyncItem* item : m_items) LUMIX_DELETE(m_allocator, item);
+	}
+
+	// stops io threads first, since they can start `process` jobs
+	// derived file systems must call this before they destroy anything used by io threads or `process` jobs
+	void stopWorking() {
+		if (!m_finish) {
+			m_finish = true;
+			for (u32 i = 0; i < (u32)m_tasks.size(); ++i) m_semaphore.signal();
+			for (FSTask* task : m_tasks) {
+				task->destroy();
+				LUMIX_DELETE(m_allocator, task);
+			}
+			m_tasks.clear();
+		}
+		jobs::wait(&m_processing_done);
 	}
 
 	const char* getEngineDataDir() override {
@@ -153,40 +259,219 @@ struct FileSystemImpl : FileSystem {
 		return true;
 	}
 
-	AsyncHandle getContent(const Path& file, const ContentCallback& callback) override
+	// files in a batch are read in ascending order
+	u64 getReadOrder(const Path& path) override { return 0; }
+	// io thread, returns content without copying it if possible, `content` must live as long as the file system
+	virtual bool getMappedContent(const Path& path, Span<const u8>& content) { return false; }
+
+	u32 allocItem() {
+		if (m_free_items.empty()) {
+			m_items.push(LUMIX_NEW(m_allocator, AsyncItem)(m_allocator));
+			return m_items.size() - 1;
+		}
+		const u32 idx = m_free_items.back();
+		m_free_items.pop();
+		return idx;
+	}
+
+	AsyncHandle makeHandle(u32 idx) const {
+		// all bits set is `AsyncHandle::invalid`
+		ASSERT(idx != 0xffFFffFF);
+		return AsyncHandle(idx | (u64(m_items[idx]->generation) << 32));
+	}
+
+	// nullptr if the request is finished
+	AsyncItem* getItem(AsyncHandle handle) const {
+		if (!handle.isValid()) return nullptr;
+		const u32 idx = getItemIndex(handle);
+		if (idx >= (u32)m_items.size()) return nullptr;
+		AsyncItem* item = m_items[idx];
+		if (item->state == AsyncItem::State::FREE) return nullptr;
+		if (item->generation != u32(handle.value >> 32)) return nullptr;
+		return item;
+	}
+
+	// job system context, since it signals waiting jobs, never call it on io threads
+	void freeItem(u32 idx) {
+		AsyncItem& item = *m_items[idx];
+		// `m_mutex` is locked, so waiters can not return before we are done with their signals
+		for (Waiter* w = item.waiters; w; w = w->next) jobs::turnGreen(w->signal);
+		if (item.counter) jobs::decrement(item.counter);
+		item.waiters = nullptr;
+		item.counter = nullptr;
+		item.callback_on_worker = false;
+		++item.generation;
+		item.state = AsyncItem::State::FREE;
+		item.flags = AsyncItem::Flags::NONE;
+		item.callback = {};
+		item.process = {};
+		item.data.free();
+		item.mapped = {};
+		item.times = {};
+		m_free_items.push(idx);
+	}
+
+	AsyncHandle getContent(const Path& file, const ContentCallback& callback, const ProcessCallback& process, Priority priority) override
 	{
 		if (file.isEmpty()) return AsyncHandle::invalid();
 
 		MutexGuard lock(m_mutex);
 		++m_work_counter;
-		AsyncItem& item = m_queue.emplace(m_allocator);
+		const u32 idx = allocItem();
+		AsyncItem& item = *m_items[idx];
 		++m_last_id;
 		if (m_last_id == 0) ++m_last_id;
 		item.id = m_last_id;
 		item.path = file.c_str();
 		item.callback = callback;
+		item.process = process;
+		item.priority = priority;
+		item.state = AsyncItem::State::QUEUED;
+		item.times.queued = os::Timer::getRawTimestamp();
+		m_queues[(u32)priority].push(idx, item.id);
 		m_semaphore.signal();
-		return AsyncHandle(item.id);
+		return makeHandle(idx);
 	}
 
-
-	void cancel(AsyncHandle async) override
+	void getContent(Span<const ContentRequest> requests, Span<AsyncHandle> handles) override
 	{
+		ASSERT(requests.length() == handles.length());
+		u32 count = 0;
 		MutexGuard lock(m_mutex);
-		for (AsyncItem& item : m_queue) {
-			if (item.id == async.value) {
-				item.flags |= AsyncItem::Flags::CANCELED;
-				--m_work_counter;
-				return;
+		for (u32 i = 0; i < requests.length(); ++i) {
+			const ContentRequest& req = requests[i];
+			if (req.path.isEmpty()) {
+				handles[i] = AsyncHandle::invalid();
+				continue;
 			}
+
+			const u32 idx = allocItem();
+			AsyncItem& item = *m_items[idx];
+			++m_last_id;
+			if (m_last_id == 0) ++m_last_id;
+			item.id = m_last_id;
+			item.path = req.path;
+			item.callback = req.callback;
+			item.process = req.process;
+			item.priority = req.priority;
+			item.callback_on_worker = req.callback_on_worker;
+			item.counter = req.counter;
+			if (item.counter) jobs::increment(item.counter);
+			item.state = AsyncItem::State::QUEUED;
+			item.times.queued = os::Timer::getRawTimestamp();
+			m_queues[(u32)req.priority].push(idx, item.id);
+			handles[i] = makeHandle(idx);
+			++count;
 		}
-		for (AsyncItem& item : m_finished) {
-			if (item.id == async.value) {
-				item.flags |= AsyncItem::Flags::CANCELED;
-				return;
+		m_work_counter += count;
+		if (count > 0) m_semaphore.signal(count);
+	}
+
+	void setPriority(AsyncHandle async, Priority priority) override {
+		MutexGuard lock(m_mutex);
+		AsyncItem* item = getItem(async);
+		if (!item || item->state != AsyncItem::State::QUEUED || item->priority == priority) return;
+		// entry in the old queue is skipped, since priority does not match
+		item->priority = priority;
+		m_queues[(u32)priority].push(getItemIndex(async), item->id);
+	}
+
+	ReadTimes getReadTimes(AsyncHandle async) override {
+		MutexGuard lock(m_mutex);
+		const AsyncItem* item = getItem(async);
+		return item ? item->times : ReadTimes();
+	}
+
+	u32 waitAny(Span<const AsyncHandle> handles) override {
+		jobs::Signal signal;
+		jobs::turnRed(&signal);
+		Array<Waiter> waiters(m_allocator);
+		waiters.reserve(handles.length());
+		{
+			MutexGuard lock(m_mutex);
+			for (u32 i = 0; i < handles.length(); ++i) {
+				if (!getItem(handles[i])) return i;
+			}
+			for (AsyncHandle h : handles) {
+				AsyncItem* item = getItem(h);
+				Waiter& w = waiters.emplace();
+				w.signal = &signal;
+				w.next = item->waiters;
+				item->waiters = &w;
 			}
 		}
-		ASSERT(false);
+
+		jobs::wait(&signal);
+
+		MutexGuard lock(m_mutex);
+		u32 finished = 0xffFFffFF;
+		for (u32 i = 0; i < handles.length(); ++i) {
+			AsyncItem* item = getItem(handles[i]);
+			if (!item) {
+				if (finished == 0xffFFffFF) finished = i;
+				continue;
+			}
+			for (Waiter** w = &item->waiters; *w; w = &(*w)->next) {
+				if (*w == &waiters[i]) {
+					*w = waiters[i].next;
+					break;
+				}
+			}
+		}
+		ASSERT(finished != 0xffFFffFF);
+		return finished;
+	}
+
+	void waitAll(Span<const AsyncHandle> handles) override {
+		for (AsyncHandle h : handles) {
+			jobs::Signal signal;
+			Waiter waiter;
+			waiter.signal = &signal;
+			{
+				MutexGuard lock(m_mutex);
+				AsyncItem* item = getItem(h);
+				if (!item) continue;
+				jobs::turnRed(&signal);
+				waiter.next = item->waiters;
+				item->waiters = &waiter;
+			}
+			jobs::wait(&signal);
+			// `freeItem` turns the signal green with `m_mutex` locked, wait until it's done before `signal` goes out of scope
+			MutexGuard lock(m_mutex);
+		}
+	}
+
+	void cancel(AsyncHandle async) override
+	{
+		jobs::Signal signal;
+		Waiter waiter;
+		{
+			MutexGuard lock(m_mutex);
+			AsyncItem* item_ptr = getItem(async);
+			if (!item_ptr) return;
+			AsyncItem& item = *item_ptr;
+			item.flags |= AsyncItem::Flags::CANCELED;
+			switch (item.state) {
+				case AsyncItem::State::FREE:
+					ASSERT(false);
+					return;
+				case AsyncItem::State::QUEUED:
+				case AsyncItem::State::READING:
+				case AsyncItem::State::FINISHED:
+					// freed in `processCallbacks` or in `process` job, still counted in `m_work_counter` until then
+					return;
+				case AsyncItem::State::PROCESSING:
+					break;
+			}
+			jobs::turnRed(&signal);
+			waiter.signal = &signal;
+			waiter.next = item.processing_waiters;
+			item.processing_waiters = &waiter;
+		}
+		// caller can destroy what `process` works with once we return
+		jobs::wait(&signal);
+		// `process` turns the signal green with `m_mutex` locked, wait until it's done before `signal` goes out of scope
+		MutexGuard lock(m_mutex);
 	}
 
 
@@ -273,133 +558,319 @@ struct FileSystemImpl : FileSystem {
 				break;
 			}
 
-			AsyncItem item = static_cast<AsyncItem&&>(m_finished[0]);
-			m_finished.erase(0);
+			const u32 idx = m_finished.pop().item;
+			// items do not move in memory, so it's safe to use it after unlock
+			AsyncItem& item = *m_items[idx];
+			if (item.needsProcessing()) {
+				// still counted in `m_work_counter`, returns to `m_finished` once processed
+				item.state = AsyncItem::State::PROCESSING;
+				m_mutex.exit();
+				jobs::runLambda([this, idx](){ process(idx); }, &m_processing_done);
+				continue;
+			}
 			ASSERT(m_work_counter > 0);
 			--m_work_counter;
 
 			m_mutex.exit();
 
 			if(!item.isCanceled()) {
-				item.callback.invoke(Span((const u8*)item.data.data(), (u32)item.data.size()), !item.isFailed());
+				item.callback.invoke(item.getContent(), !item.isFailed());
 			}
 
+			m_mutex.enter();
+			freeItem(idx);
+			m_mutex.exit();
+
 			if (timer.getTimeSinceStart() > 0.1f) {
 				break;
 			}
 		}
 	}
 
-	IAllocator& m_allocator;
-	Local<FSTask> m_task;
-	Array<AsyncItem> m_queue;
-	u32 m_work_counter = 0;
-	Array<AsyncItem> m_finished;
-	Mutex m_mutex;
-	Semaphore m_semaphore;
-	Array<Mount> m_mounts;
+	// `m_mutex` must be locked, wakes up jobs in `cancel`
+	void finishProcessing(AsyncItem& item) {
+		for (Waiter* w = item.processing_waiters; w; w = w->next) jobs::turnGreen(w->signal);
+		item.processing_waiters = nullptr;
+	}
 
-	u32 m_last_id;
-};
+	// worker thread, also calls callbacks of requests with `callback_on_worker`
+	void process(u32 idx) {
+		PROFILE_BLOCK("process file");
+		AsyncItem* item;
+		bool canceled;
+		{
+			MutexGuard lock(m_mutex);
+			item = m_items[idx];
+			canceled = item->isCanceled();
+		}
+		profiler::pushString(item->path.c_str());
+		if (!item->needsProcessing()) {}
+		else if (!canceled && item->mapped.length() > 0) {
+			// `process` can replace the content, but it must not write to mapped memory
+			OutputMemoryStream view((void*)item->mapped.begin(), item->mapped.length());
+			view.resize(item->mapped.length());
+			item->process.invoke(view);
+			if (view.data() != item->mapped.begin()) {
+				item->data = static_cast<OutputMemoryStream&&>(view);
+				item->mapped = {};
+			}
+		}
+		else if (!canceled) {
+			item->process.invoke(item->data);
+		}
 
+		if (item->callback_on_worker) {
+			if (!item->isCanceled()) item->callback.invoke(item->getContent(), !item->isFailed());
+			MutexGuard lock(m_mutex);
+			ASSERT(m_work_counter > 0);
+			--m_work_counter;
+			finishProcessing(*item);
+			freeItem(idx);
+			return;
+		}
 
-int FSTask::task()
-{
-	while (!m_finish) {
-		m_fs.m_semaphore.wait();
-		if (m_finish) break;
+		MutexGuard lock(m_mutex);
+		finishProcessing(*item);
+		item->flags |= AsyncItem::Flags::PROCESSED;
+		item->state = AsyncItem::State::FINISHED;
+		m_finished.push(idx, item->id);
+	}
 
-		Path path;
+	// io thread, takes up to `IO_BATCH_SIZE` requests with the highest priority and reads them
+	void readBatch() {
+		PROFILE_FUNCTION();
+		struct Request {
+			u32 item;
+			u64 order;
+			Path path;
+		};
+		Request batch[IO_BATCH_SIZE];
+		u32 count = 0;
 		{
-			MutexGuard lock(m_fs.m_mutex);
-			ASSERT(!m_fs.m_queue.empty());
-			path = m_fs.m_queue[0].path;
-			if (m_fs.m_queue[0].isCanceled()) {
-				m_fs.m_queue.erase(0);
-				continue;
+			MutexGuard lock(m_mutex);
+			for (u32 priority = 0; priority < (u32)Priority::COUNT && count == 0; ++priority) {
+				RequestQueue& queue = m_queues[priority];
+				while (!queue.empty() && count < IO_BATCH_SIZE) {
+					const RequestQueue::Entry entry = queue.pop();
+					AsyncItem& item = *m_items[entry.item];
+					if (item.id != entry.id) continue;
+					if (item.state != AsyncItem::State::QUEUED) continue;
+					if ((u32)item.priority != priority) continue;
+					if (item.isCanceled()) {
+						finishRead(entry.item);
+						continue;
+					}
+					item.state = AsyncItem::State::READING;
+					batch[count].item = entry.item;
+					batch[count].path = item.path;
+					++count;
+				}
 			}
 		}
+		if (count == 0) return;
 
-		OutputMemoryStream data(m_fs.m_allocator);
-		bool success = m_fs.getContentSync(path, data);
+		for (u32 i = 0; i < count; ++i) batch[i].order = getReadOrder(batch[i].path);
+		insertSort(batch, batch + count, [](const Request& a, const Request& b){ return a.order < b.order; });
 
-		{
-			MutexGuard lock(m_fs.m_mutex);
-			if (!m_fs.m_queue[0].isCanceled()) {
-				m_fs.m_finished.emplace(static_cast<AsyncItem&&>(m_fs.m_queue[0]));
-				m_fs.m_finished.back().data = static_cast<OutputMemoryStream&&>(data);
-				if(!success) {
-					m_fs.m_finished.back().flags |= AsyncItem::Flags::FAILED;
-				}
+		for (u32 i = 0; i < count; ++i) {
+			PROFILE_BLOCK("read file");
+			profiler::pushString(batch[i].path.c_str());
+			OutputMemoryStream data(m_allocator);
+			Span<const u8> mapped;
+			bool canceled;
+			{
+				MutexGuard lock(m_mutex);
+				canceled = m_items[batch[i].item]->isCanceled();
 			}
-			m_fs.m_queue.erase(0);
+			const u64 io_start = os::Timer::getRawTimestamp();
+			const bool success = !canceled && (getMappedContent(batch[i].path, mapped) || getContentSync(batch[i].path, data));
+			const u64 io_end = os::Timer::getRawTimestamp();
+			profiler::pushInt("bytes", i32(mapped.length() > 0 ? mapped.length() : data.size()));
+
+			MutexGuard lock(m_mutex);
+			AsyncItem& item = *m_items[batch[i].item];
+			if (!item.isCanceled()) {
+				item.times.io_start = io_start;
+				item.times.io_end = io_end;
+				item.data = static_cast<OutputMemoryStream&&>(data);
+				item.mapped = mapped;
+				if (!success) item.flags |= AsyncItem::Flags::FAILED;
+			}
+			finishRead(batch[i].item);
 		}
 	}
-	return 0;
-}
 
+	// io thread, `m_mutex` must be locked
+	// io threads must not signal jobs, so even canceled items are freed in `processCallbacks` or in a `process` job
+	void finishRead(u32 idx) {
+		AsyncItem& item = *m_items[idx];
+		if (item.callback_on_worker) {
+			item.state = AsyncItem::State::PROCESSING;
+			jobs::runLambda([this, idx](){ process(idx); }, &m_processing_done);
+			return;
+		}
+		item.state = AsyncItem::State::FINISHED;
+		m_finished.push(idx, item.id);
+	}
 
-void FSTask::stop()
+	IAllocator& m_allocator;
+	// requests, indexed by `AsyncHandle::value`
+	Array<AsyncItem*> m_items;
+	Array<u32> m_free_items;
+	// one queue per priority
+	Array<RequestQueue> m_queues;
+	RequestQueue m_finished;
+	u32 m_work_counter = 0;
+	jobs::Counter m_processing_done;
+	Array<FSTask*> m_tasks;
+	volatile bool m_finish = false;
+	Mutex m_mutex;
+	Semaphore m_semaphore;
+	Array<Mount> m_mounts;
+
+	u32 m_last_id;
+};
+
+
+int FSTask::task()
 {
-	m_finish = true;
-	m_fs.m_semaphore.signal();
+	while (!m_fs.m_finish) {
+		m_fs.m_semaphore.wait();
+		if (m_fs.m_finish) break;
+		m_fs.readBatch();
+	}
+	return 0;
 }
 
+// pak is mapped to memory, so any number of io threads can read it without locking
 struct PackFileSystem : FileSystemImpl {
-	PackFileSystem(const char* pak_path, IAllocator& allocator) 
-		: FileSystemImpl("pack://", allocator) 
-		, m_map(allocator)
+	struct PackFile {
+		FilePathHash hash;
+		// from the start of the pak
+		u64 offset;
+		u64 size;
+		u64 file_size;
+		bool compressed;
+	};
+
+	PackFileSystem(const char* pak_path, IAllocator& allocator, u32 io_threads) 
+		: FileSystemImpl("pack://", allocator, io_threads) 
+		, m_files(allocator)
 	{
 		if (!m_file.open(pak_path)) {
-			logError("Failed to open game.pak");
+			logError("Failed to open ", pak_path);
 			return;
 		}
-		const u32 count = m_file.read<u32>();
-		for (u32 i = 0; i < count; ++i) {
-			const FilePathHash hash = m_file.read<FilePathHash>();
-			PackFile& f = m_map.insert(hash);
-			f.offset = m_file.read<u64>();
-			f.size = m_file.read<u64>();
+		if (!readTable(m_file.data(), m_file.size())) {
+			logError(pak_path, " is corrupted");
+			m_files.clear();
+			return;
 		}
+		sort(m_files.begin(), m_files.end(), [](const PackFile& a, const PackFile& b){ return a.hash < b.hash; });
 	}
 
 	~PackFileSystem() {
+		// io threads and `process` jobs use the mapping
+		stopWorking();
 		m_file.close();
 	}
 
-	bool getContentSync(const Path& path, OutputMemoryStream& content) override {
-		ASSERT(content.size() == 0);
-		StringView basename = Path::getBasename(path);
-		u64 hashu64;
-		fromCString(basename, hashu64);
-		FilePathHash hash = FilePathHash::fromU64(hashu64);
-		if (basename[0] < '0' || basename[0] > '9' || hashu64 == 0) {
-			hash = path.getHash();
+	bool readTable(const u8* data, u64 size) {
+		InputMemoryStream blob(data, size);
+		if (size < sizeof(PackHeader)) return false;
+
+		PackHeader header;
+		memcpy(&header, data, sizeof(header));
+		if (header.magic != PackHeader::MAGIC) {
+			// pak without header, written before per-file compression was added
+			const u32 count = blob.read<u32>();
+			const u64 header_size = sizeof(u32) + u64(count) * (2 * sizeof(u64) + sizeof(FilePathHash));
+			if (header_size > size) return false;
+			m_files.resize(count);
+			for (PackFile& f : m_files) {
+				blob.read(f.hash);
+				f.offset = blob.read<u64>() + header_size;
+				f.size = blob.read<u64>();
+				f.file_size = f.size;
+				f.compressed = false;
+				if (f.offset + f.size > size) return false;
+			}
+			return true;
 		}
-		auto iter = m_map.find(hash);
-		if (!iter.isValid()) {
-			iter = m_map.find(path.getHash());
-			if (!iter.isValid()) return false;
+
+		if (header.version > PackHeader::VERSION) return false;
+		if (sizeof(header) + u64(header.count) * sizeof(PackEntry) > size) return false;
+		blob.skip(sizeof(header));
+		m_files.resize(header.count);
+		for (PackFile& f : m_files) {
+			PackEntry entry;
+			blob.read(entry);
+			f.hash = entry.hash;
+			f.offset = entry.offset;
+			f.size = entry.size;
+			f.file_size = entry.file_size;
+			f.compressed = entry.flags & PackEntry::COMPRESSED;
+			if (f.offset + f.size > size) return false;
 		}
+		return true;
+	}
 
-		content.resize(iter.value().size);
-		MutexGuard lock(m_mutex);
-		const u32 header_size = sizeof(u32) + m_map.size() * (2 * sizeof(u64) + sizeof(FilePathHash));
-		if (!m_file.seek(iter.value().offset + header_size) || !m_file.read(content.getMutableData(), content.size())) {
-			logError("Could not read ", path);
-			return false;
+	const PackFile* find(FilePathHash hash) const {
+		u32 from = 0;
+		u32 to = m_files.size();
+		while (from < to) {
+			const u32 mid = (from + to) / 2;
+			if (m_files[mid].hash < hash) from = mid + 1;
+			else to = mid;
 		}
+		if (from < (u32)m_files.size() && m_files[from].hash == hash) return &m_files[from];
+		return nullptr;
+	}
+
+	const PackFile* find(const Path& path) const {
+		const PackFile* file = find(getPackedFileHash(path));
+		if (!file) file = find(path.getHash());
+		return file;
+	}
+
+	bool fileExists(StringView path) override {
+		return find(Path(path));
+	}
 
+	// read files in the order they are in the pak
+	u64 getReadOrder(const Path& path) override {
+		const PackFile* file = find(path);
+		return file ? file->offset : 0;
+	}
+
+	bool getMappedContent(const Path& path, Span<const u8>& content) override {
+		const PackFile* file = find(path);
+		// compressed files are decompressed in `getContentSync`
+		if (!file || file->compressed) return false;
+
+		content = Span(m_file.data() + file->offset, file->size);
 		return true;
 	}
-	
-	struct PackFile {
-		u64 offset;
-		u64 size;
-	};
 
-	HashMap<FilePathHash, PackFile> m_map;
-	os::InputFile m_file;
+	bool getContentSync(const Path& path, OutputMemoryStream& content) override {
+		ASSERT(content.size() == 0);
+		const PackFile* file = find(path);
+		if (!file) return false;
+
+		if (!file->compressed) return content.write(m_file.data() + file->offset, file->size);
+
+		content.resize(file->file_size);
+		const i32 res = LZ4_decompress_safe((const char*)m_file.data() + file->offset, (char*)content.getMutableData(), (i32)file->size, (i32)file->file_size);
+		if (res != (i32)file->file_size) {
+			logError("Could not decompress ", path);
+			return false;
+		}
+		return true;
+	}
+
+	// sorted by hash
+	Array<PackFile> m_files;
+	os::MappedFile m_file;
 };
 
 void destroyFileIterator(FileIterator* iterator) {
@@ -421,14 +892,24 @@ bool getNextFile(FileIterator* iterator, os::FileInfo* info) {
 	return os::getNextFile(iterator->iter, info);
 }
 
-UniquePtr<FileSystem> FileSystem::create(const char* base_path, IAllocator& allocator)
+FileSystem::AsyncHandle FileSystem::getContent(const Path& file, const ContentCallback& callback) {
+	return getContent(file, callback, {}, Priority::NORMAL);
+}
+
+FileSystem::AsyncHandle FileSystem::getContent(const ContentRequest& request) {
+	AsyncHandle handle = AsyncHandle::invalid();
+	getContent(Span(&request, 1), Span(&handle, 1));
+	return handle;
+}
+
+UniquePtr<FileSystem> FileSystem::create(const char* base_path, IAllocator& allocator, u32 io_threads)
 {
-	return UniquePtr<FileSystemImpl>::create(allocator, base_path, allocator);
+	return UniquePtr<FileSystemImpl>::create(allocator, base_path, allocator, io_threads);
 }
 
-UniquePtr<FileSystem> FileSystem::createPacked(const char* pak_path, IAllocator& allocator)
+UniquePtr<FileSystem> FileSystem::createPacked(const char* pak_path, IAllocator& allocator, u32 io_threads)
 {
-	return UniquePtr<PackFileSystem>::create(allocator, pak_path, allocator);
+	return UniquePtr<PackFileSystem>::create(allocator, pak_path, allocator, io_threads);
 }
 
 
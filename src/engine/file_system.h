@@ -1,13 +1,18 @@
 #pragma once
 
 #include "lumix.h"
+#include "core/delegate.h"
+#include "core/path.h"
 
 namespace Lumix {
 
-template <typename T> struct Delegate;
 template <typename T> struct Span;
 template <typename T> struct UniquePtr;
 
+namespace jobs {
+	struct Counter;
+}
+
 namespace os {
 	struct FileInfo;
 	struct InputFile;
@@ -20,16 +25,47 @@ LUMIX_ENGINE_API bool getNextFile(FileIterator* iterator, os::FileInfo* info);
 
 struct LUMIX_ENGINE_API FileSystem {
 	using ContentCallback = Delegate<void(Span<const u8>, bool)>;
+	// runs on a worker thread with the content of successfully read file, can modify it, e.g. decompress it
+	using ProcessCallback = Delegate<void(struct OutputMemoryStream&)>;
+
+	// requests with higher priority are read first, e.g. visible meshes before speculative preloads
+	enum class Priority : u8 {
+		HIGH,
+		NORMAL,
+		LOW,
+
+		COUNT
+	};
 
+	// handles of finished requests are stale, they are safe to use, but they do not refer to any request
 	struct LUMIX_ENGINE_API AsyncHandle {
-		static AsyncHandle invalid() { return AsyncHandle(0xffFFffFF); };
-		explicit AsyncHandle(u32 value) : value(value) {}
-		u32 value;
-		bool isValid() const { return value != 0xffFFffFF; }
+		static AsyncHandle invalid() { return AsyncHandle(~u64(0)); };
+		explicit AsyncHandle(u64 value) : value(value) {}
+		u64 value;
+		bool isValid() const { return value != ~u64(0); }
+	};
+
+	struct ContentRequest {
+		Path path;
+		ContentCallback callback;
+		ProcessCallback process;
+		Priority priority = Priority::NORMAL;
+		// `callback` is called on a worker thread right after the file is read and processed, instead of in `processCallbacks`
+		bool callback_on_worker = false;
+		// incremented when the request is submitted, decremented when it's finished or canceled, see `jobs::wait`
+		jobs::Counter* counter = nullptr;
+	};
+
+	// raw `os::Timer` timestamps of an async request, 0 if it did not happen (yet)
+	struct ReadTimes {
+		u64 queued = 0;
+		u64 io_start = 0;
+		u64 io_end = 0;
 	};
 
-	static UniquePtr<FileSystem> create(const char* engine_data_dir, struct IAllocator& allocator);
-	static UniquePtr<FileSystem> createPacked(const char* pak_path, struct IAllocator& allocator);
+	// `io_threads` - number of threads reading files
+	static UniquePtr<FileSystem> create(const char* engine_data_dir, struct IAllocator& allocator, u32 io_threads = 2);
+	static UniquePtr<FileSystem> createPacked(const char* pak_path, struct IAllocator& allocator, u32 io_threads = 2);
 
 	virtual ~FileSystem() {}
 
@@ -51,7 +87,25 @@ struct LUMIX_ENGINE_API FileSystem {
 
 	[[nodiscard]] virtual bool saveContentSync(const struct Path& file, Span<const u8> content) = 0;
 	[[nodiscard]] virtual bool getContentSync(const struct Path& file, struct OutputMemoryStream& content) = 0;
-	virtual AsyncHandle getContent(const Path& file, const ContentCallback& callback) = 0;
+	AsyncHandle getContent(const Path& file, const ContentCallback& callback);
+	// `process` (if valid) is called before `callback`, `callback` is still called on the main thread
+	// `cancel` waits for `process` if it's running
+	virtual AsyncHandle getContent(const Path& file, const ContentCallback& callback, const ProcessCallback& process, Priority priority) = 0;
+	// same as `getContent` for each request, but submitted at once, `handles[i]` is the handle of `requests[i]`
+	virtual void getContent(Span<const ContentRequest> requests, Span<AsyncHandle> handles) = 0;
+	AsyncHandle getContent(const ContentRequest& request);
+	// job system context, a request is finished when its callback returns or when it's canceled
+	// do not wait on the main thread for requests with callbacks called in `processCallbacks`
+	// returns index of a finished request
+	virtual u32 waitAny(Span<const AsyncHandle> handles) = 0;
+	virtual void waitAll(Span<const AsyncHandle> handles) = 0;
+	// does nothing if the file is already read
+	virtual void setPriority(AsyncHandle handle, Priority priority) = 0;
+	// valid until the callback of the request returns
+	virtual ReadTimes getReadTimes(AsyncHandle handle) = 0;
+	// reading files in ascending order minimizes seeks, e.g. offset in pak
+	virtual u64 getReadOrder(const Path& path) = 0;
+	// does nothing if the request is already finished
 	virtual void cancel(AsyncHandle handle) = 0;
 };
 
@@ -0,0 +1,383 @@
+#include "core/allocator.h"
+#include "core/array.h"
+#include "core/crt.h"
+#include "core/hash_map.h"
+#include "core/log.h"
+#include "core/math.h"
+#include "core/os.h"
+#include "core/path.h"
+#include "core/profiler.h"
+#include "core/sort.h"
+#include "core/stream.h"
+#include "core/string.h"
+
+#include "engine/file_system.h"
+#include "engine/pack_builder.h"
+#include "engine/resource.h"
+#include "engine/resource_manager.h"
+#include <lz4/lz4.h>
+
+namespace Lumix {
+
+// `Compression::AUTO` stores files compressed only if they shrink at least to this ratio
+static constexpr float AUTO_COMPRESSION_RATIO = 0.9f;
+static constexpr u32 NOT_TRACED = 0xffFFffFF;
+
+static u64 alignOffset(u64 offset, u32 alignment) {
+	return (offset + alignment - 1) / alignment * alignment;
+}
+
+FilePathHash getPackedFileHash(const Path& path) {
+	const StringView compiled_prefix = ".lumix/resources/";
+	const StringView compiled_ext = ".res";
+	StringView str = path.c_str();
+	if (!startsWith(str, compiled_prefix) || !endsWith(str, compiled_ext)) return path.getHash();
+
+	// anything else than `<digits>.res` in the directory, e.g. `_resources.txt` or `123.res.tmp`, uses its full path
+	const StringView name(str.begin + compiled_prefix.size(), str.end - compiled_ext.size());
+	if (name.size() == 0) return path.getHash();
+	for (const char* c = name.begin; c != name.end; ++c) {
+		if (*c < '0' || *c > '9') return path.getHash();
+	}
+	u64 hash = 0;
+	fromCString(name, hash);
+	return FilePathHash::fromU64(hash);
+}
+
+struct PackBuilderImpl final : PackBuilder {
+	struct File {
+		Path path;
+		// content is read from here, see `PackBuilder::addFile`
+		Path src_path;
+		Compression compression;
+		// index in `m_payloads`
+		u32 payload = 0;
+	};
+
+	// unique content, shared by all files with the same content
+	struct Payload {
+		// first file with this content
+		u32 file;
+		u64 offset = 0;
+		u64 size = 0;
+		u64 file_size = 0;
+		bool compressed = false;
+		// position of the first load in trace
+		u32 trace_order = NOT_TRACED;
+	};
+
+	PackBuilderImpl(FileSystem& fs, IAllocator& allocator)
+		: m_fs(fs)
+		, m_allocator(allocator)
+		, m_files(allocator)
+		, m_file_map(allocator)
+		, m_payloads(allocator)
+		, m_order(allocator)
+		, m_trace(allocator)
+	{}
+
+	void addFile(const Path& path, Compression compression) override { addFile(path, path, compression); }
+
+	void addFile(const Path& path, const Path& src_path, Compression compression) override {
+		const FilePathHash hash = getPackedFileHash(path);
+		auto iter = m_file_map.find(hash);
+		if (iter.isValid()) {
+			const Path& other = m_files[iter.value()].path;
+			// same file added twice, e.g. overlapping directories
+			if (equalStrings(other.c_str(), path.c_str())) return;
+			logError("Can not pack ", path, ", its hash collides with ", other);
+			return;
+		}
+
+		m_file_map.insert(hash, m_files.size());
+		File& file = m_files.emplace();
+		file.path = path;
+		file.src_path = src_path;
+		file.compression = compression;
+	}
+
+	void addDirectory(const char* dir, Compression compression) override {
+		FileIterator* iter = m_fs.createFileIterator(dir);
+		if (!iter) {
+			logError("Could not open ", dir);
+			return;
+		}
+		os::FileInfo info;
+		while (getNextFile(iter, &info)) {
+			if (info.filename[0] == '.') continue;
+
+			const Path path(dir, "/", info.filename);
+			if (info.is_directory) addDirectory(path.c_str(), compression);
+			else addFile(path, compression);
+		}
+		destroyFileIterator(iter);
+	}
+
+	void setAlignment(u32 alignment) override {
+		ASSERT(alignment > 0);
+		m_alignment = alignment;
+	}
+
+	bool addManifestTrace(Span<const u8> manifest) {
+		InputMemoryStream blob(manifest);
+		blob.skip(sizeof(u32));
+		if (blob.read<u32>() != ResourceManagerHub::MANIFEST_VERSION) {
+			logError("Unsupported manifest version");
+			return false;
+		}
+		const u32 count = blob.read<u32>();
+		for (u32 i = 0; i < count; ++i) {
+			blob.read<u64>(); // resource type
+			const Path path(blob.readString());
+			if (blob.hasOverflow()) {
+				logError("Manifest is corrupted");
+				return false;
+			}
+			// manifest contains resources, the pak contains their compiled files
+			m_trace.push(getPackedFileHash(Resource::getFilePath(path)));
+		}
+		return true;
+	}
+
+	bool addLoadTrace(Span<const u8> trace) override {
+		if (trace.length() >= sizeof(u32)) {
+			u32 magic;
+			memcpy(&magic, trace.begin(), sizeof(magic));
+			if (magic == ResourceManagerHub::MANIFEST_MAGIC) return addManifestTrace(trace);
+		}
+
+		StringView text(trace);
+		while (text.size() > 0) {
+			const char* line_end = find(text, '\n');
+			StringView line(text.begin, line_end ? line_end : text.end);
+			text.begin = line_end ? line_end + 1 : text.end;
+
+			while (line.size() > 0 && isWhitespace(line.back())) line.removeSuffix(1);
+			while (line.size() > 0 && isWhitespace(line[0])) line.removePrefix(1);
+			if (line.size() == 0) continue;
+
+			m_trace.push(getPackedFileHash(Path(line)));
+		}
+		return true;
+	}
+
+	bool compress(Span<const u8> content, Compression compression, OutputMemoryStream& compressed) {
+		if (compression == Compression::NONE) return false;
+		if (content.length() == 0 || content.length() > LZ4_MAX_INPUT_SIZE) return false;
+
+		const i32 cap = LZ4_compressBound((i32)content.length());
+		compressed.resize(cap);
+		const i32 size = LZ4_compress_default((const char*)content.begin(), (char*)compressed.getMutableData(), (i32)content.length(), cap);
+		if (size <= 0) return false;
+
+		compressed.resize(size);
+		if (compression == Compression::AUTO && size > content.length() * AUTO_COMPRESSION_RATIO) return false;
+		return true;
+	}
+
+	// reads all files, finds duplicates and decides about compression
+	bool gatherPayloads(Report& report) {
+		PROFILE_FUNCTION();
+		// we do not keep contents in memory, so duplicates are found by hash and then compared
+		HashMap<StableHash, u32> content_map(m_allocator);
+		OutputMemoryStream content(m_allocator);
+		OutputMemoryStream other(m_allocator);
+		OutputMemoryStream compressed(m_allocator);
+		for (u32 i = 0, c = m_files.size(); i < c; ++i) {
+			File& file = m_files[i];
+			content.clear();
+			if (!m_fs.getContentSync(file.src_path, content)) {
+				logError("Could not read ", file.src_path);
+				return false;
+			}
+			++report.files;
+			report.files_size += content.size();
+
+			const StableHash content_hash(content.data(), (u32)content.size());
+			auto iter = content_map.find(content_hash);
+			if (iter.isValid()) {
+				const Payload& payload = m_payloads[iter.value()];
+				other.clear();
+				if (m_fs.getContentSync(m_files[payload.file].src_path, other)
+					&& other.size() == content.size()
+					&& memcmp(other.data(), content.data(), content.size()) == 0)
+				{
+					file.payload = iter.value();
+					++report.duplicates;
+					report.saved_by_dedupe += content.size();
+					continue;
+				}
+			}
+
+			file.payload = m_payloads.size();
+			Payload& payload = m_payloads.emplace();
+			payload.file = i;
+			payload.file_size = content.size();
+			payload.compressed = compress(content, file.compression, compressed);
+			payload.size = payload.compressed ? compressed.size() : content.size();
+			report.saved_by_compression += payload.file_size - payload.size;
+			if (!iter.isValid()) content_map.insert(content_hash, file.payload);
+		}
+		return true;
+	}
+
+	// traced payloads go first, in the order of their first load
+	void layout(Report& report) {
+		u32 trace_order = 0;
+		for (FilePathHash hash : m_trace) {
+			auto iter = m_file_map.find(hash);
+			if (!iter.isValid()) continue;
+
+			Payload& payload = m_payloads[m_files[iter.value()].payload];
+			if (payload.trace_order == NOT_TRACED) payload.trace_order = trace_order++;
+		}
+
+		m_order.resize(m_payloads.size());
+		for (u32 i = 0; i < (u32)m_order.size(); ++i) m_order[i] = i;
+		sort(m_order.begin(), m_order.end(), [&](u32 a, u32 b){
+			if (m_payloads[a].trace_order != m_payloads[b].trace_order) return m_payloads[a].trace_order < m_payloads[b].trace_order;
+			return a < b;
+		});
+
+		u64 offset = sizeof(PackHeader) + m_files.size() * sizeof(PackEntry);
+		for (u32 idx : m_order) {
+			Payload& payload = m_payloads[idx];
+			const u64 aligned = alignOffset(offset, m_alignment);
+			report.padding += aligned - offset;
+			payload.offset = aligned;
+			offset = aligned + payload.size;
+		}
+		report.pak_size = offset;
+	}
+
+	bool writePadding(os::OutputFile& file, u64 size) {
+		static const u8 zeros[256] = {};
+		while (size > 0) {
+			const u64 chunk = minimum(size, (u64)sizeof(zeros));
+			if (!file.write(zeros, chunk)) return false;
+			size -= chunk;
+		}
+		return true;
+	}
+
+	bool writeTable(os::OutputFile& file) {
+		PackHeader header;
+		header.count = m_files.size();
+		header.alignment = m_alignment;
+
+		Array<PackEntry> entries(m_allocator);
+		entries.reserve(m_files.size());
+		for (const File& f : m_files) {
+			const Payload& payload = m_payloads[f.payload];
+			PackEntry& entry = entries.emplace();
+			entry.hash = getPackedFileHash(f.path);
+			entry.offset = payload.offset;
+			entry.size = payload.size;
+			entry.file_size = payload.file_size;
+			entry.flags = payload.compressed ? PackEntry::COMPRESSED : PackEntry::NONE;
+		}
+		sort(entries.begin(), entries.end(), [](const PackEntry& a, const PackEntry& b){ return a.hash < b.hash; });
+
+		if (!file.write(&header, sizeof(header))) return false;
+		return file.write(entries.begin(), entries.byte_size());
+	}
+
+	bool writePayloads(os::OutputFile& file) {
+		PROFILE_FUNCTION();
+		OutputMemoryStream content(m_allocator);
+		OutputMemoryStream compressed(m_allocator);
+		u64 offset = sizeof(PackHeader) + m_files.size() * sizeof(PackEntry);
+		for (u32 idx : m_order) {
+			const Payload& payload = m_payloads[idx];
+			const File& f = m_files[payload.file];
+			content.clear();
+			if (!m_fs.getContentSync(f.src_path, content)) {
+				logError("Could not read ", f.src_path);
+				return false;
+			}
+			if (content.size() != payload.file_size) {
+				logError(f.src_path, " changed while packing");
+				return false;
+			}
+
+			if (!writePadding(file, payload.offset - offset)) return false;
+			if (payload.compressed) {
+				// compression is deterministic, so we get the same size as in `gatherPayloads`
+				if (!compress(content, Compression::LZ4, compressed)) return false;
+				ASSERT(compressed.size() == payload.size);
+				if (!file.write(compressed.data(), compressed.size())) return false;
+			}
+			else if (!file.write(content.data(), content.size())) {
+				return false;
+			}
+			offset = payload.offset + payload.size;
+		}
+		return true;
+	}
+
+	void countSeeks(Report& report) {
+		u64 end = 0;
+		for (FilePathHash hash : m_trace) {
+			auto iter = m_file_map.find(hash);
+			if (!iter.isValid()) continue;
+
+			const Payload& payload = m_payloads[m_files[iter.value()].payload];
+			++report.traced_reads;
+			if (report.traced_reads == 1 || payload.offset != alignOffset(end, m_alignment)) ++report.expected_seeks;
+			end = payload.offset + payload.size;
+		}
+	}
+
+	bool write(const char* pak_path, Report& report) override {
+		PROFILE_FUNCTION();
+		report = {};
+		m_payloads.clear();
+		if (m_files.empty()) {
+			logError("No files to pack into ", pak_path);
+			return false;
+		}
+		if (!gatherPayloads(report)) return false;
+		layout(report);
+
+		os::OutputFile file;
+		if (!file.open(pak_path)) {
+			logError("Could not create ", pak_path);
+			return false;
+		}
+		const bool success = writeTable(file) && writePayloads(file);
+		file.close();
+		if (!success) {
+			logError("Could not write ", pak_path);
+			return false;
+		}
+
+		countSeeks(report);
+		return true;
+	}
+
+	FileSystem& m_fs;
+	IAllocator& m_allocator;
+	Array<File> m_files;
+	HashMap<FilePathHash, u32> m_file_map;
+	Array<Payload> m_payloads;
+	// indices of `m_payloads` in the order they are stored in the pak
+	Array<u32> m_order;
+	Array<FilePathHash> m_trace;
+	u32 m_alignment = 1;
+};
+
+UniquePtr<PackBuilder> PackBuilder::create(FileSystem& fs, IAllocator& allocator) {
+	return UniquePtr<PackBuilderImpl>::create(allocator, fs, allocator);
+}
+
+void logPackReport(const PackBuilder::Report& report) {
+	logInfo("Packed ", report.files, " files (", report.files_size, " B) into ", report.pak_size, " B");
+	logInfo("Saved by compression: ", report.saved_by_compression, " B");
+	logInfo("Saved by deduplication: ", report.saved_by_dedupe, " B in ", report.duplicates, " files");
+	logInfo("Alignment padding: ", report.padding, " B");
+	if (report.traced_reads > 0) {
+		logInfo("Expected seeks: ", report.expected_seeks, " in ", report.traced_reads, " traced reads");
+	}
+}
+
+} // namespace Lumix
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "lumix.h"
+#include "core/hash.h"
+
+namespace Lumix {
+
+template <typename T> struct UniquePtr;
+
+// pak layout: PackHeader, PackEntry[count] sorted by hash, payloads
+// paks without PackHeader (older ones) are `u32 count`, (hash, offset, size)[count], payloads
+#pragma pack(1)
+struct PackHeader {
+	static constexpr u32 MAGIC = 'LPAK';
+	static constexpr u32 VERSION = 1;
+	u32 magic = MAGIC;
+	u32 version = VERSION;
+	u32 count = 0;
+	// of each payload
+	u32 alignment = 1;
+};
+
+struct PackEntry {
+	enum Flags : u32 {
+		NONE = 0,
+		COMPRESSED = 1 << 0 // LZ4
+	};
+	FilePathHash hash;
+	// from the start of the pak
+	u64 offset = 0;
+	// size of payload in the pak
+	u64 size = 0;
+	// size of the file, differs from `size` if the payload is compressed
+	u64 file_size = 0;
+	u32 flags = NONE;
+	u32 padding = 0;
+};
+#pragma pack()
+
+// hash used to find `path` in a pak, compiled resources (.lumix/resources/<digits>.res) use the hash from their name, other files the hash of the full path
+LUMIX_ENGINE_API FilePathHash getPackedFileHash(const struct Path& path);
+
+// writes paks for `FileSystem::createPacked`
+struct LUMIX_ENGINE_API PackBuilder {
+	enum class Compression : u8 {
+		NONE,
+		LZ4,
+		// LZ4 if it makes the file noticeably smaller, e.g. resources compressed by asset compiler are stored as they are
+		AUTO
+	};
+
+	struct Report {
+		u32 files = 0;
+		u32 duplicates = 0;
+		u64 files_size = 0;
+		u64 saved_by_compression = 0;
+		u64 saved_by_dedupe = 0;
+		u64 padding = 0;
+		u64 pak_size = 0;
+		// number of files in the trace
+		u32 traced_reads = 0;
+		// number of traced reads which do not continue where the previous read ended
+		u32 expected_seeks = 0;
+	};
+
+	static UniquePtr<PackBuilder> create(struct FileSystem& fs, struct IAllocator& allocator);
+
+	virtual ~PackBuilder() {}
+	virtual void addFile(const Path& path, Compression compression) = 0;
+	// stored as `path`, but read from `src_path`, e.g. files converted for the target during export
+	virtual void addFile(const Path& path, const Path& src_path, Compression compression) = 0;
+	// recursive
+	virtual void addDirectory(const char* dir, Compression compression) = 0;
+	// payloads are aligned to `alignment` bytes, e.g. sector size for direct I/O
+	virtual void setAlignment(u32 alignment) = 0;
+	// `trace` - world manifest (see `ResourceManagerHub::recordManifest`) or text with paths, one per line, in the order they were loaded
+	// payloads are stored in this order, so the traced loads read the pak sequentially; untraced files follow
+	// traces of several worlds are appended, each file is stored where it was first loaded
+	[[nodiscard]] virtual bool addLoadTrace(Span<const u8> trace) = 0;
+	[[nodiscard]] virtual bool write(const char* pak_path, Report& report) = 0;
+};
+
+LUMIX_ENGINE_API void logPackReport(const PackBuilder::Report& report);
+
+} // namespace Lumix
@@ -20,6 +20,13 @@ namespace Lumix
 
 	ISystem::~ISystem() = default;
 
+	bool ModuleUpdateAccess::dependsOn(const char* module_name) const {
+		for (const char* module : modules) {
+			if (module && equalStrings(module, module_name)) return true;
+		}
+		return false;
+	}
+
 	struct SystemManagerImpl final : SystemManager
 	{
 		SystemManagerImpl(Engine& engine, IAllocator& allocator)
@@ -197,9 +204,18 @@ namespace Lumix
 		return UniquePtr<SystemManagerImpl>::create(engine.getAllocator(), engine, engine.getAllocator());
 	}
 
-	void SystemManager::createAllStatic(Engine& engine) {
+	void SystemManager::createAllStatic(Engine& engine, Span<const char*> excluded_systems) {
 		PROFILE_FUNCTION();
-		#include "plugins.inl"
+		#ifdef STATIC_PLUGINS
+			// used in plugins.inl, which creates systems only in static builds
+			auto isExcluded = [&](const char* name){
+				for (const char* excluded : excluded_systems) {
+					if (equalStrings(excluded, name)) return true;
+				}
+				return false;
+			};
+			#include "plugins.inl"
+		#endif
 		for (ISystem* system : engine.getSystemManager().getSystems()) {
 			logInfo("Plugin ", system->getName(), " loaded");
 		}
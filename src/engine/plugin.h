@@ -17,7 +17,8 @@ struct LUMIX_ENGINE_API SystemManager
 	virtual ~SystemManager() {}
 
 	static UniquePtr<SystemManager> create(struct Engine& engine);
-	static void createAllStatic(Engine& engine);
+	// creates statically linked systems, except those named in `excluded_systems`
+	static void createAllStatic(Engine& engine, Span<const char*> excluded_systems);
 	
 	virtual void initSystems() = 0;
 	virtual void unload(struct ISystem* system) = 0;
@@ -31,6 +32,19 @@ struct LUMIX_ENGINE_API SystemManager
 	virtual DelegateList<void(void*)>& libraryLoaded() = 0;
 };
 
+// what module's `update` and `lateUpdate` access besides module's own data, see `IModule::getUpdateAccess`
+struct LUMIX_ENGINE_API ModuleUpdateAccess {
+	bool dependsOn(const char* module_name) const;
+
+	bool read_transforms = false;
+	bool write_transforms = false;
+	// masks of `ComponentType::index`, for components of other modules
+	u64 read_components = 0;
+	u64 write_components = 0;
+	// other modules accessed directly, e.g. through `World::getModule`, including callbacks into them
+	const char* modules[4] = {};
+};
+
 // Modules inherited from IModule manage components of certain types in single world,
 // e.g. RenderModule manages all render components - models, lights, ... 
 // Each world has its own instance of every type of module, e.g. RenderModule, AnimationModule, ...
@@ -41,6 +55,11 @@ struct LUMIX_ENGINE_API IModule
 	virtual void init() {}
 	virtual void serialize(struct OutputMemoryStream& serializer) = 0;
 	virtual void deserialize(struct InputMemoryStream& serialize, const struct EntityMap& entity_map, i32 version) = 0;
+	// blittable worlds (see `WorldSerializeFlags::BLITTABLE`) are loaded by the same build, so the module can store raw arrays there
+	// return false if not supported, `serialize` is used then; module's data starts 16-byte aligned
+	virtual bool serializeBlittable(OutputMemoryStream& serializer) { return false; }
+	// called instead of `deserialize` for data written by `serializeBlittable`
+	virtual void deserializeBlittable(InputMemoryStream& serializer, const EntityMap& entity_map, i32 version) {}
 	virtual void beforeReload(OutputMemoryStream& serializer) {}
 	virtual void afterReload(InputMemoryStream& serializer) {}
 	virtual const char* getName() const = 0;
@@ -48,16 +67,41 @@ struct LUMIX_ENGINE_API IModule
 	
 	// called for all modules at once, i.e. all modules are updated in parallel
 	virtual void updateParallel(float time_delta) {}
+	// called with constant time delta, zero or more times per frame, after updateParallel and before update, called on "main thread"
+	// only if fixed steps are enabled, see `Engine::setFixedTimeStep`
+	virtual void fixedUpdate(float time_step) {}
 	// called after all updateParallel calls are finished, called on "main thread"
 	virtual void update(float time_delta) = 0;
 	// called after all update calls are finished, called on "main thread"
 	virtual void lateUpdate(float time_delta) {}
+	// modules which declare their access and do not conflict with each other run `update` and `lateUpdate` concurrently, not necessarily on "main thread"
+	// return false if not declared, such module is updated alone on "main thread", in module order
+	// module which depends on undeclared or missing module is treated as undeclared
+	// queried only when the set of world's modules changes, so the result must not change during module's lifetime
+	virtual bool getUpdateAccess(ModuleUpdateAccess& access) const { return false; }
+	// with frame fence (see `Engine::setFrameFence`), modules which can touch fenced data wait for the fence before `endFrame`
+	// return true if `updateParallel` never touches such data, so it can run before the fence even if the rest of the module can not
+	virtual bool isUpdateParallelUnfenced() const { return false; }
 	
 	virtual void endFrame() {}
 	virtual struct World& getWorld() = 0;
 	virtual void startGame() {}
 	virtual void stopGame() {}
 	virtual i32 getVersion() const { return -1; }
+	// called by `World::createComponents`, module can override this to create many components at once
+	// module must still call `World::onComponentCreated` for each entity, world then invokes `componentsAdded` once for the whole batch
+	// return false if batched creation of `type` is not supported, world then creates the components one by one
+	virtual bool createComponents(ComponentType type, Span<const EntityRef> entities) { return false; }
+	// return true if `deserialize` touches only module's own data, creates components (`World::onComponentCreated`) and reads transforms
+	// it must not load resources, since resource managers are not thread safe
+	// such modules are deserialized in parallel with each other, before all other modules regardless of module order
+	// so other modules see their data already deserialized
+	virtual bool canDeserializeInParallel() const { return false; }
+	// raw copy of module's state for rollback and replays, see `World::takeSnapshot`
+	// return false if not supported, such module keeps its current state when a snapshot is restored
+	virtual bool takeSnapshot(OutputMemoryStream& blob) { return false; }
+	// entities are already restored, the module creates and destroys its components to match the snapshot
+	virtual void restoreSnapshot(InputMemoryStream& blob) {}
 };
 
 // There should be single instance in whole app of every system inherited from ISystem, e.g. only one renderer, one animation system, ...
@@ -18,6 +18,7 @@ struct LUMIX_ENGINE_API PrefabResource final : Resource {
 	ResourceType getType() const override;
 	void unload() override;
 	bool load(Span<const u8> mem) override;
+	bool isLoadAsync() const override { return true; }
 
 	OutputMemoryStream data;
 	StableHash content_hash;
@@ -1,8 +1,10 @@
 #include "engine/lumix.h"
 
+#include "core/crt.h"
 #include "core/hash.h"
 #include "core/log.h"
 #include "core/path.h"
+#include "core/profiler.h"
 #include "core/stream.h"
 #include "core/string.h"
 #include "engine/engine.h"
@@ -45,18 +47,31 @@ void Resource::refresh() {
 
 	const State old_state = m_current_state;
 	m_current_state = State::EMPTY;	
-	m_cb.invoke(old_state, m_current_state, *this);
+	onCurrentStateChanged(old_state);
 	checkState();
 }
 
 
+// keeps memory stats of `ResourceManager` in sync and notifies observers
+void Resource::onCurrentStateChanged(State old_state) {
+	if (old_state == State::READY) m_resource_manager.removeResident(*this);
+	if (m_current_state == State::READY) m_resource_manager.addResident(*this);
+	ResourceManagerHub& hub = m_resource_manager.getOwner();
+	if (hub.isLoadTraceActive()) {
+		if (m_current_state == State::READY) hub.traceLoadEvent(*this, ResourceLoadEvent::READY);
+		if (m_current_state == State::FAILURE) hub.traceLoadEvent(*this, ResourceLoadEvent::FAILED);
+	}
+	m_cb.invoke(old_state, m_current_state, *this);
+}
+
+
 void Resource::checkState()
 {
 	auto old_state = m_current_state;
 	if (m_failed_dep_count > 0 && m_current_state != State::FAILURE)
 	{
 		m_current_state = State::FAILURE;
-		m_cb.invoke(old_state, m_current_state, *this);
+		onCurrentStateChanged(old_state);
 	}
 
 	if (m_failed_dep_count == 0)
@@ -79,28 +94,38 @@ void Resource::checkState()
 			}
 
 			m_current_state = State::READY;
-			m_cb.invoke(old_state, m_current_state, *this);
+			onCurrentStateChanged(old_state);
 		}
 
 		if (m_empty_dep_count > 0 && m_current_state != State::EMPTY)
 		{
 			m_current_state = State::EMPTY;
-			m_cb.invoke(old_state, m_current_state, *this);
+			onCurrentStateChanged(old_state);
 		}
 	}
 }
 
 
 void Resource::fileLoaded(Span<const u8> blob, bool success) {
+	PROFILE_FUNCTION();
+	profiler::pushString(m_path.c_str());
 	ASSERT(m_async_op.isValid());
+	ResourceManagerHub& hub = m_resource_manager.getOwner();
+	if (hub.isLoadTraceActive()) {
+		const FileSystem::ReadTimes times = hub.getFileSystem().getReadTimes(m_async_op);
+		hub.traceLoadEvent(*this, ResourceLoadEvent::IO_START, times.io_start);
+		hub.traceLoadEvent(*this, ResourceLoadEvent::IO_END, times.io_end, m_file_size);
+	}
 	m_async_op = FileSystem::AsyncHandle::invalid();
-	if (m_desired_state != State::READY) return;
+	if (m_desired_state != State::READY) {
+		freeDeferredContent();
+		return;
+	}
 	
 	ASSERT(m_current_state != State::READY);
 	ASSERT(m_empty_dep_count == 1);
 
 	if (!success) {
-		ResourceManagerHub& hub = m_resource_manager.getOwner();
 		if (!m_hooked && hub.isHooked()) {
 			if (hub.onBeforeLoad(*this) == ResourceManagerHub::LoadHook::Action::DEFERRED) {
 				m_hooked = true;
@@ -120,10 +145,27 @@ void Resource::fileLoaded(Span<const u8> blob, bool success) {
 		return;
 	}
 
+	if (m_deferred_content || (m_decode_result == DecodeResult::LOADED && m_resource_manager.m_is_time_sliced)) {
+		hub.enqueueFinalize(*this);
+		return;
+	}
+	finishLoad(blob);
+}
+
+
+void Resource::finishLoad(Span<const u8> blob) {
+	ResourceManagerHub& hub = m_resource_manager.getOwner();
 	const CompiledResourceHeader* header = (const CompiledResourceHeader*)blob.begin();
-	m_file_size = blob.length();
-	if (startsWith(getPath(), ".lumix/asset_tiles/")) {
+	if (m_decode_result == DecodeResult::LOADED) {
+		if (!finishAsyncLoad()) ++m_failed_dep_count;
+	}
+	else if (m_decode_result == DecodeResult::FAILED) {
+		++m_failed_dep_count;
+	}
+	else if (startsWith(getPath(), ".lumix/asset_tiles/")) {
+		hub.traceLoadEvent(*this, ResourceLoadEvent::LOAD_START);
 		if (!load(blob)) ++m_failed_dep_count;
+		hub.traceLoadEvent(*this, ResourceLoadEvent::LOAD_END);
 	}
 	else if (blob.length() < sizeof(*header)) {
 		logError("Invalid resource file, please delete .lumix directory");
@@ -137,20 +179,16 @@ void Resource::fileLoaded(Span<const u8> blob, bool success) {
 		logError("Unsupported resource file version, please delete .lumix directory");
 		++m_failed_dep_count;
 	}
-	else if (header->flags & CompiledResourceHeader::COMPRESSED) {
-		OutputMemoryStream tmp(m_resource_manager.m_allocator);
-		tmp.resize(header->decompressed_size);
-		Engine& engine = m_resource_manager.getOwner().getEngine();
-		const Span<const u8> src((const u8*)blob.begin() + sizeof(*header), u64(blob.length() - sizeof(*header)));
-		if (!engine.decompress(src, Span<u8>(tmp.getMutableData(), tmp.size())) || !load(tmp)) {
-			++m_failed_dep_count;
-		}
-	}
 	else {
+		// `decodeFile` already decompressed it
+		ASSERT((header->flags & (CompiledResourceHeader::COMPRESSED | CompiledResourceHeader::COMPRESSED_BLOCKS)) == 0);
+		hub.traceLoadEvent(*this, ResourceLoadEvent::LOAD_START);
 		if (!load(blob.fromLeft(sizeof(*header)))) {
 			++m_failed_dep_count;
 		}
+		hub.traceLoadEvent(*this, ResourceLoadEvent::LOAD_END);
 	} 
+	m_decode_result = DecodeResult::NONE;
 
 	ASSERT(m_empty_dep_count > 0);
 	--m_empty_dep_count;
@@ -158,17 +196,96 @@ void Resource::fileLoaded(Span<const u8> blob, bool success) {
 }
 
 
+void Resource::finalize() {
+	PROFILE_FUNCTION();
+	profiler::pushString(m_path.c_str());
+	ASSERT(m_desired_state == State::READY);
+	OutputMemoryStream* content = m_deferred_content;
+	m_deferred_content = nullptr;
+	finishLoad(content ? Span<const u8>(*content) : Span<const u8>());
+	LUMIX_DELETE(m_resource_manager.m_allocator, content);
+}
+
+
+void Resource::freeDeferredContent() {
+	LUMIX_DELETE(m_resource_manager.m_allocator, m_deferred_content);
+	m_deferred_content = nullptr;
+}
+
+
+// worker thread, decompresses the file and calls `loadAsync` if the resource supports it
+// invalid files are left as they are, `fileLoaded` reports them
+void Resource::decodeFile(OutputMemoryStream& content) {
+	PROFILE_FUNCTION();
+	profiler::pushString(m_path.c_str());
+	m_decode_result = DecodeResult::NONE;
+	m_file_size = content.size();
+	ResourceManagerHub& hub = m_resource_manager.getOwner();
+	Span<const u8> blob = content;
+	if (!startsWith(getPath(), ".lumix/asset_tiles/")) {
+		CompiledResourceHeader header;
+		if (content.size() < sizeof(header)) return;
+		memcpy(&header, content.data(), sizeof(header));
+		if (header.magic != CompiledResourceHeader::MAGIC || header.version != 0) return;
+
+		if (header.flags & (CompiledResourceHeader::COMPRESSED | CompiledResourceHeader::COMPRESSED_BLOCKS)) {
+			PROFILE_BLOCK("decompress");
+			profiler::pushInt("bytes", i32(header.decompressed_size));
+			hub.traceLoadEvent(*this, ResourceLoadEvent::DECOMPRESS_START);
+			OutputMemoryStream tmp(m_resource_manager.m_allocator);
+			tmp.resize(sizeof(header) + header.decompressed_size);
+			Engine& engine = m_resource_manager.getOwner().getEngine();
+			const Span<const u8> src(content.data() + sizeof(header), u64(content.size() - sizeof(header)));
+			const Span<u8> dst(tmp.getMutableData() + sizeof(header), header.decompressed_size);
+			const bool decompressed = header.flags & CompiledResourceHeader::COMPRESSED_BLOCKS
+				? engine.decompressBlocks(src, dst)
+				: engine.decompress(src, dst);
+			hub.traceLoadEvent(*this, ResourceLoadEvent::DECOMPRESS_END, 0, header.decompressed_size);
+			if (!decompressed) {
+				m_decode_result = DecodeResult::FAILED;
+				return;
+			}
+			// main thread then sees uncompressed file
+			header.flags &= ~(CompiledResourceHeader::COMPRESSED | CompiledResourceHeader::COMPRESSED_BLOCKS);
+			memcpy(tmp.getMutableData(), &header, sizeof(header));
+			content = static_cast<OutputMemoryStream&&>(tmp);
+		}
+		blob = Span(content.data() + sizeof(header), u64(content.size() - sizeof(header)));
+	}
+
+	if (!isLoadAsync()) {
+		if (!m_resource_manager.m_is_time_sliced) return;
+		// `content` is freed after `fileLoaded`, but time sliced `load` can happen several frames later
+		// so we take it, only views of mapped memory are copied, since the file system owns them
+		ASSERT(!m_deferred_content);
+		IAllocator& allocator = m_resource_manager.m_allocator;
+		m_deferred_content = content.ownsData()
+			? LUMIX_NEW(allocator, OutputMemoryStream)(static_cast<OutputMemoryStream&&>(content))
+			: LUMIX_NEW(allocator, OutputMemoryStream)(content, allocator);
+		return;
+	}
+	hub.traceLoadEvent(*this, ResourceLoadEvent::LOAD_START);
+	m_decode_result = loadAsync(blob) ? DecodeResult::LOADED : DecodeResult::FAILED;
+	hub.traceLoadEvent(*this, ResourceLoadEvent::LOAD_END);
+}
+
+
 void Resource::doUnload()
 {
+	if (m_is_cached) m_resource_manager.uncache(*this);
+
 	if (m_async_op.isValid())
 	{
 		FileSystem& fs = m_resource_manager.getOwner().getFileSystem();
 		fs.cancel(m_async_op);
 		m_async_op = FileSystem::AsyncHandle::invalid();
 	}
+	if (m_is_finalize_queued) m_resource_manager.getOwner().dequeueFinalize(*this);
+	freeDeferredContent();
 
 	m_hooked = false;
 	m_desired_state = State::EMPTY;
+	m_decode_result = DecodeResult::NONE;
 	unload();
 	ASSERT(m_empty_dep_count <= 1);
 
@@ -191,26 +308,45 @@ void Resource::onCreated(State state)
 }
 
 
-void Resource::doLoad()
+void Resource::setLoadPriority(FileSystem::Priority priority) {
+	m_load_priority = priority;
+	if (m_async_op.isValid()) {
+		m_resource_manager.getOwner().getFileSystem().setPriority(m_async_op, priority);
+	}
+}
+
+
+bool Resource::prepareLoad(FileSystem::ContentRequest& request)
 {
-	if (m_desired_state == State::READY) return;
+	if (m_desired_state == State::READY) return false;
 	m_desired_state = State::READY;
 
-	if (m_async_op.isValid()) return;
+	if (m_async_op.isValid()) return false;
 
 	ASSERT(m_current_state != State::READY);
 
+	m_resource_manager.getOwner().traceLoadEvent(*this, ResourceLoadEvent::QUEUED);
+	request.path = getFilePath(m_path);
+	request.callback = makeDelegate<&Resource::fileLoaded>(this);
+	request.process = makeDelegate<&Resource::decodeFile>(this);
+	request.priority = m_load_priority;
+	return true;
+}
+
+
+void Resource::doLoad()
+{
+	FileSystem::ContentRequest req;
+	if (!prepareLoad(req)) return;
+
 	FileSystem& fs = m_resource_manager.getOwner().getFileSystem();
-	FileSystem::ContentCallback cb = makeDelegate<&Resource::fileLoaded>(this);
+	m_async_op = fs.getContent(req.path, req.callback, req.process, req.priority);
+}
 
-	if (startsWith(m_path, ".lumix/asset_tiles/")) {
-		m_async_op = fs.getContent(m_path, cb);
-	}
-	else {	
-		const FilePathHash hash = m_path.getHash();
-		const Path res_path(".lumix/resources/", hash, ".res");
-		m_async_op = fs.getContent(res_path, cb);
-	}
+
+Path Resource::getFilePath(const Path& path) {
+	if (startsWith(path, ".lumix/asset_tiles/")) return path;
+	return Path(".lumix/resources/", path.getHash(), ".res");
 }
 
 
@@ -249,7 +385,7 @@ u32 Resource::decRefCount() {
 	ASSERT(m_ref_count > 0);
 	--m_ref_count;
 	if (m_ref_count == 0 && m_resource_manager.m_is_unload_enabled) {
-		doUnload();
+		m_resource_manager.onUnreferenced(*this);
 	}
 	return m_ref_count;
 }
@@ -277,10 +413,55 @@ void Resource::onStateChanged(State old_state, State new_state, Resource& depend
 
 	if (new_state == State::EMPTY) ++m_empty_dep_count;
 	if (new_state == State::FAILURE) ++m_failed_dep_count;
+	if (old_state == State::EMPTY && m_current_state == State::EMPTY) {
+		m_resource_manager.getOwner().traceLoadDependency(*this, dependency);
+	}
 
 	checkState();
 }
 
+ResourceGroup::ResourceGroup(IAllocator& allocator)
+	: m_resources(allocator)
+{}
+
+ResourceGroup::~ResourceGroup() {
+	clear();
+}
+
+void ResourceGroup::add(Resource& resource) {
+	m_resources.push(&resource);
+	resource.getObserverCb().bind<&ResourceGroup::onStateChanged>(this);
+	if (resource.isEmpty()) ++m_pending_count;
+	if (resource.isFailure()) ++m_failed_count;
+}
+
+void ResourceGroup::add(Span<Resource*> resources) {
+	m_resources.reserve(m_resources.size() + resources.length());
+	for (Resource* res : resources) {
+		if (res) add(*res);
+	}
+	// everything is already ready or failed, there will be no state change to report it
+	if (m_pending_count == 0 && on_complete.isValid()) on_complete.invoke(*this);
+}
+
+void ResourceGroup::clear() {
+	for (Resource* res : m_resources) res->getObserverCb().unbind<&ResourceGroup::onStateChanged>(this);
+	m_resources.clear();
+	m_pending_count = 0;
+	m_failed_count = 0;
+}
+
+void ResourceGroup::onStateChanged(Resource::State old_state, Resource::State new_state, Resource& resource) {
+	if (old_state == Resource::State::FAILURE) --m_failed_count;
+	if (new_state == Resource::State::FAILURE) ++m_failed_count;
+	if (new_state == Resource::State::EMPTY) ++m_pending_count;
+	if (old_state == Resource::State::EMPTY) {
+		ASSERT(m_pending_count > 0);
+		--m_pending_count;
+		if (m_pending_count == 0 && on_complete.isValid()) on_complete.invoke(*this);
+	}
+}
+
 StringView ResourcePath::getResource(StringView str) {
 	const char* c = str.begin;
 	if (str.end) {
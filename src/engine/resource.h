@@ -2,6 +2,7 @@
 
 #include "engine/lumix.h"
 
+#include "core/array.h"
 #include "core/delegate_list.h"
 #include "core/path.h"
 #include "engine/file_system.h"
@@ -35,7 +36,10 @@ template <> struct HashFunc<ResourceType> {
 #pragma pack(1)
 struct CompiledResourceHeader {
 	static constexpr u32 MAGIC = 'LRES';
-	enum Flags { COMPRESSED = 1 << 0 };
+	enum Flags {
+		COMPRESSED = 1 << 0, // `Engine::compress`
+		COMPRESSED_BLOCKS = 1 << 1 // `Engine::compressBlocks`
+	};
 	u32 magic = MAGIC;
 	u32 version = 0;
 	u32 flags = 0;
@@ -72,6 +76,16 @@ struct LUMIX_ENGINE_API Resource {
 	u32 incRefCount() { return ++m_ref_count; }
 	bool wantReady() const { return m_desired_state == State::READY; }
 	bool isHooked() const { return m_hooked; }
+	// file read by `doLoad`, e.g. compiled resource
+	static Path getFilePath(const Path& path);
+	// e.g. raise priority of visible resources or lower it for speculative loads
+	void setLoadPriority(FileSystem::Priority priority);
+	// memory used by the loaded resource, used for `ResourceManager` budgets
+	virtual u64 getCPUMemorySize() const { return m_file_size; }
+	virtual u64 getGPUMemorySize() const { return 0; }
+	u64 getMemorySize() const { return getCPUMemorySize() + getGPUMemorySize(); }
+	// unreferenced, but kept loaded for reuse
+	bool isCached() const { return m_is_cached; }
 
 	template <auto Function, typename C> void onLoaded(C* instance) {
 		m_cb.bind<Function>(instance);
@@ -86,6 +100,12 @@ protected:
 	virtual void onBeforeReady() {}
 	virtual void unload() = 0;
 	virtual bool load(Span<const u8> blob) = 0;
+	// opt-in per resource type, `loadAsync` is then called on a worker thread instead of `load`
+	// it can only parse `blob` into the resource itself, e.g. it must not load other resources or add dependencies
+	// `finishAsyncLoad` is called on the main thread afterwards and can do the rest
+	virtual bool isLoadAsync() const { return false; }
+	virtual bool loadAsync(Span<const u8> blob) { return load(blob); }
+	virtual bool finishAsyncLoad() { return true; }
 
 	void onCreated(State state);
 	void doUnload();
@@ -100,8 +120,17 @@ protected:
 
 protected:
 	void doLoad();
+	// first part of `doLoad`, returns true if the file should be read with `request`
+	bool prepareLoad(FileSystem::ContentRequest& request);
 	void fileLoaded(Span<const u8> mem, bool success);
+	void decodeFile(OutputMemoryStream& content);
+	// second part of `fileLoaded`, calls `load` or `finishAsyncLoad`
+	void finishLoad(Span<const u8> blob);
+	// `finishLoad` deferred by `ResourceManagerHub`'s finalize queue
+	void finalize();
+	void freeDeferredContent();
 	void onStateChanged(State old_state, State new_state, Resource&);
+	void onCurrentStateChanged(State old_state);
 
 	Resource(const Resource&) = delete;
 	void operator=(const Resource&) = delete;
@@ -113,8 +142,54 @@ protected:
 	u16 m_failed_dep_count;
 	State m_current_state;
 	FileSystem::AsyncHandle m_async_op;
+	FileSystem::Priority m_load_priority = FileSystem::Priority::NORMAL;
 	bool m_hooked = false;
+	// cached resources are in `ResourceManager`'s LRU list, `m_lru_prev` is less recently used
+	bool m_is_cached = false;
+	Resource* m_lru_prev = nullptr;
+	Resource* m_lru_next = nullptr;
+	// memory size when the resource became ready
+	u64 m_resident_size = 0;
+
+	// result of `decodeFile`, which runs on a worker thread
+	enum class DecodeResult : u8 {
+		NONE,
+		LOADED,
+		FAILED
+	};
+	DecodeResult m_decode_result = DecodeResult::NONE;
+	// copy of the file made by `decodeFile` if `load` is time sliced, see `ResourceManager::setTimeSliced`
+	OutputMemoryStream* m_deferred_content = nullptr;
+	bool m_is_finalize_queued = false;
+	// `m_load_priority` can change while the resource is queued
+	FileSystem::Priority m_finalize_priority = FileSystem::Priority::NORMAL;
 }; // struct Resource
 
+// tracks loading of a set of resources, e.g. from `ResourceManagerHub::loadMany`
+// does not hold references to the resources
+struct LUMIX_ENGINE_API ResourceGroup {
+	explicit ResourceGroup(IAllocator& allocator);
+	~ResourceGroup();
+
+	void add(Resource& resource);
+	void add(Span<Resource*> resources);
+	void clear();
+	// all resources are ready or failed
+	bool isComplete() const { return m_pending_count == 0; }
+	u32 getPendingCount() const { return m_pending_count; }
+	u32 getFailedCount() const { return m_failed_count; }
+
+	// called on the main thread once the last pending resource is ready or failed, it must not destroy the group
+	// also called from `add(Span)` if nothing is pending after it, so bind it before adding
+	Delegate<void(ResourceGroup&)> on_complete;
+
+private:
+	void onStateChanged(Resource::State old_state, Resource::State new_state, Resource& resource);
+
+	Array<Resource*> m_resources;
+	u32 m_pending_count = 0;
+	u32 m_failed_count = 0;
+};
+
 
 } // namespace Lumix
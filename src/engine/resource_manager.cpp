@@ -2,7 +2,12 @@
 
 #include "core/array.h"
 #include "core/log.h"
+#include "core/math.h"
+#include "core/os.h"
+#include "core/profiler.h"
+#include "core/sort.h"
 #include "core/stream.h"
+#include "core/string.h"
 
 #include "engine/resource.h"
 #include "engine/resource_manager.h"
@@ -11,6 +16,185 @@
 namespace Lumix
 {
 
+// resources can be destroyed while traced or recorded, so we identify them by type and path instead of pointers
+static RuntimeHash getResourceKey(ResourceType type, const Path& path) {
+	const u64 data[] = { type.type.getHashValue(), path.getHash().getHashValue() };
+	return RuntimeHash(data, sizeof(data));
+}
+
+// false if the resource does not exist (anymore)
+static bool isLoading(ResourceManagerHub& hub, ResourceType type, const Path& path) {
+	ResourceManager* manager = hub.get(type);
+	if (!manager) return false;
+	auto iter = manager->getResourceTable().find(path.getHash());
+	if (!iter.isValid()) return false;
+	const Resource* res = iter.value();
+	return res->isEmpty() && res->wantReady();
+}
+
+struct ResourceLoadTrace {
+	// number of slowest loads of each type in the summary
+	static constexpr u32 TOP_COUNT = 5;
+
+	struct Entry {
+		u64 time(ResourceLoadEvent event) const { return times[(u32)event]; }
+		// 0 if any of the events did not happen
+		u64 duration(ResourceLoadEvent from, ResourceLoadEvent to) const {
+			return time(from) && time(to) > time(from) ? time(to) - time(from) : 0;
+		}
+		u64 end() const { return maximum(time(ResourceLoadEvent::READY), time(ResourceLoadEvent::FAILED)); }
+		// from request to ready or failed
+		u64 total() const { return end() > time(ResourceLoadEvent::REQUESTED) && time(ResourceLoadEvent::REQUESTED) ? end() - time(ResourceLoadEvent::REQUESTED) : 0; }
+
+		Path path;
+		ResourceType type;
+		u64 times[(u32)ResourceLoadEvent::COUNT] = {};
+		u64 file_size = 0;
+		u64 decompressed_size = 0;
+		// key of the last dependency the resource waited for
+		RuntimeHash dependency;
+		bool has_dependency = false;
+	};
+
+	explicit ResourceLoadTrace(IAllocator& allocator)
+		: entries(allocator)
+		, map(allocator)
+	{}
+
+	Entry& getEntry(Resource& resource) {
+		const RuntimeHash key = getResourceKey(resource.getType(), resource.getPath());
+		auto iter = map.find(key);
+		if (iter.isValid()) return entries[iter.value()];
+
+		map.insert(key, entries.size());
+		Entry& entry = entries.emplace();
+		entry.path = resource.getPath();
+		entry.type = resource.getType();
+		return entry;
+	}
+
+	// no traced resource is loading, canceled loads are finished too
+	bool isFinished(ResourceManagerHub& hub) const {
+		if (entries.empty()) return false;
+		for (const Entry& e : entries) {
+			if (isLoading(hub, e.type, e.path)) return false;
+		}
+		return true;
+	}
+
+	Array<Entry> entries;
+	HashMap<RuntimeHash, u32> map;
+	u64 start = os::Timer::getRawTimestamp();
+};
+
+// resources loaded since `ResourceManagerHub::recordManifest`
+struct ManifestRecording {
+	struct Entry {
+		ResourceType type;
+		Path path;
+	};
+
+	ManifestRecording(const Path& path, IAllocator& allocator)
+		: path(path)
+		, resources(allocator)
+		, map(allocator)
+	{}
+
+	bool isFinished(ResourceManagerHub& hub) const {
+		if (resources.empty()) return false;
+		for (const Entry& e : resources) {
+			if (isLoading(hub, e.type, e.path)) return false;
+		}
+		return true;
+	}
+
+	Path path;
+	Array<Entry> resources;
+	HashMap<RuntimeHash, u32> map;
+};
+
+static float toMS(u64 raw) {
+	return os::Timer::rawToSeconds(raw) * 1000;
+}
+
+static void logLoadTimes(const char* prefix, const ResourceLoadTrace::Entry& e) {
+	using E = ResourceLoadEvent;
+	logInfo(prefix, e.path, " (", e.file_size, " B) total ", toMS(e.total()), " ms"
+		, ", hook ", toMS(e.duration(E::REQUESTED, E::QUEUED)), " ms"
+		, ", queue ", toMS(e.duration(E::QUEUED, E::IO_START)), " ms"
+		, ", io ", toMS(e.duration(E::IO_START, E::IO_END)), " ms"
+		, ", decompress ", toMS(e.duration(E::DECOMPRESS_START, E::DECOMPRESS_END)), " ms"
+		, ", load ", toMS(e.duration(E::LOAD_START, E::LOAD_END)), " ms"
+		, ", dependencies ", toMS(e.duration(E::LOAD_END, E::READY)), " ms"
+		, e.time(E::FAILED) ? ", FAILED" : "");
+}
+
+static void logLoadTrace(ResourceLoadTrace& trace, IAllocator& allocator) {
+	using E = ResourceLoadEvent;
+	using Entry = ResourceLoadTrace::Entry;
+	if (trace.entries.empty()) {
+		logInfo("Resource load trace: nothing loaded");
+		return;
+	}
+
+	u64 end = trace.start;
+	u64 bytes = 0;
+	const Entry* last = nullptr;
+	for (const Entry& e : trace.entries) {
+		bytes += e.file_size;
+		if (e.end() >= end) {
+			end = e.end();
+			last = &e;
+		}
+	}
+	logInfo("Resource load trace: ", trace.entries.size(), " resources, ", bytes, " B read, ", toMS(end - trace.start), " ms");
+
+	// per type, sorted by type so resources of the same type are next to each other
+	Array<const Entry*> sorted(allocator);
+	sorted.reserve(trace.entries.size());
+	for (const Entry& e : trace.entries) sorted.push(&e);
+	sort(sorted.begin(), sorted.end(), [](const Entry* a, const Entry* b){
+		if (a->type != b->type) return a->type < b->type;
+		return a->total() > b->total();
+	});
+	for (u32 i = 0, c = sorted.size(); i < c;) {
+		u32 j = i;
+		u64 type_bytes = 0, io = 0, decompress = 0, load = 0, dependencies = 0;
+		for (; j < c && sorted[j]->type == sorted[i]->type; ++j) {
+			const Entry& e = *sorted[j];
+			type_bytes += e.file_size;
+			io += e.duration(E::IO_START, E::IO_END);
+			decompress += e.duration(E::DECOMPRESS_START, E::DECOMPRESS_END);
+			load += e.duration(E::LOAD_START, E::LOAD_END);
+			dependencies += e.duration(E::LOAD_END, E::READY);
+		}
+		// resource types do not have names in release builds
+		logInfo("*.", Path::getExtension(sorted[i]->path), ": ", j - i, " resources, ", type_bytes, " B"
+			, ", io ", toMS(io), " ms"
+			, ", decompress ", toMS(decompress), " ms"
+			, ", load ", toMS(load), " ms"
+			, ", dependencies ", toMS(dependencies), " ms");
+		for (u32 k = i; k < minimum(j, i + ResourceLoadTrace::TOP_COUNT); ++k) {
+			logLoadTimes("    ", *sorted[k]);
+		}
+		i = j;
+	}
+
+	// follow the dependencies which finished last, starting with the resource which finished last
+	logInfo("Critical path:");
+	for (u32 i = 0, c = trace.entries.size(); last && i < c; ++i) {
+		logLoadTimes("    ", *last);
+		if (!last->has_dependency) break;
+
+		auto iter = trace.map.find(last->dependency);
+		if (!iter.isValid()) break;
+		const Entry& dep = trace.entries[iter.value()];
+		// the dependency was ready before `last` was loaded, so it did not delay it
+		if (dep.end() <= last->time(E::LOAD_END)) break;
+		last = &dep;
+	}
+}
+
 void ResourceManager::create(ResourceType type, ResourceManagerHub& owner)
 {
 	owner.add(type, this);
@@ -19,7 +203,9 @@ void ResourceManager::create(ResourceType type, ResourceManagerHub& owner)
 
 void ResourceManager::destroy()
 {
+	while (m_lru_head) m_lru_head->doUnload();
 	for (Resource* resource : m_resources) {
+		if (resource->m_is_finalize_queued) resource->doUnload();
 		if (!resource->isEmpty()) {
 			logError("Leaking resource ", resource->getPath(), "\n");
 		}
@@ -41,6 +227,31 @@ Resource* ResourceManager::get(const Path& path)
 }
 
 Resource* ResourceManager::load(const Path& path)
+{
+	return load(path, nullptr, nullptr);
+}
+
+void ResourceManager::loadMany(Span<const Path> paths, Span<Resource*> resources)
+{
+	ASSERT(paths.length() == resources.length());
+	m_resources.reserve(m_resources.size() + paths.length());
+	Array<FileSystem::ContentRequest> requests(m_allocator);
+	Array<Resource*> to_read(m_allocator);
+	requests.reserve(paths.length());
+	to_read.reserve(paths.length());
+	for (u32 i = 0; i < paths.length(); ++i) {
+		resources[i] = load(paths[i], &requests, &to_read);
+	}
+	if (requests.empty()) return;
+
+	Array<FileSystem::AsyncHandle> handles(m_allocator);
+	handles.reserve(requests.size());
+	for (u32 i = 0; i < (u32)requests.size(); ++i) handles.push(FileSystem::AsyncHandle::invalid());
+	m_owner->getFileSystem().getContent(requests, handles);
+	for (u32 i = 0; i < (u32)to_read.size(); ++i) to_read[i]->m_async_op = handles[i];
+}
+
+Resource* ResourceManager::load(const Path& path, Array<FileSystem::ContentRequest>* requests, Array<Resource*>* to_read)
 {
 	if (path.isEmpty()) return nullptr;
 	Resource* resource = get(path);
@@ -51,8 +262,13 @@ Resource* ResourceManager::load(const Path& path)
 		m_resources.insert(path.getHash(), resource);
 	}
 
+	if (resource->m_is_cached) uncache(*resource);
+	m_owner->onLoad(*resource);
+
 	if(resource->isEmpty() && resource->m_desired_state == Resource::State::EMPTY)
 	{
+		++m_stats.misses;
+		m_owner->traceLoadEvent(*resource, ResourceLoadEvent::REQUESTED);
 		if (m_owner->onBeforeLoad(*resource) == ResourceManagerHub::LoadHook::Action::DEFERRED)
 		{
 			ASSERT(!resource->m_hooked);
@@ -62,13 +278,88 @@ Resource* ResourceManager::load(const Path& path)
 			resource->incRefCount(); // for return value
 			return resource;
 		}
-		resource->doLoad();
+		if (requests) {
+			if (resource->prepareLoad(requests->emplace())) to_read->push(resource);
+			else requests->pop();
+		}
+		else {
+			resource->doLoad();
+		}
+	}
+	else {
+		++m_stats.hits;
 	}
 
 	resource->incRefCount();
 	return resource;
 }
 
+void ResourceManager::setBudget(u64 budget)
+{
+	m_budget = budget;
+	evict();
+}
+
+void ResourceManager::onUnreferenced(Resource& resource)
+{
+	if (m_budget == 0 || !resource.isReady()) {
+		resource.doUnload();
+		return;
+	}
+	cache(resource);
+	evict();
+}
+
+// most recently unreferenced resources are at the tail
+void ResourceManager::cache(Resource& resource)
+{
+	ASSERT(!resource.m_is_cached);
+	resource.m_is_cached = true;
+	resource.m_lru_prev = m_lru_tail;
+	resource.m_lru_next = nullptr;
+	if (m_lru_tail) m_lru_tail->m_lru_next = &resource;
+	else m_lru_head = &resource;
+	m_lru_tail = &resource;
+	m_stats.cached_size += resource.m_resident_size;
+	++m_stats.cached_count;
+}
+
+void ResourceManager::uncache(Resource& resource)
+{
+	ASSERT(resource.m_is_cached);
+	if (resource.m_lru_prev) resource.m_lru_prev->m_lru_next = resource.m_lru_next;
+	else m_lru_head = resource.m_lru_next;
+	if (resource.m_lru_next) resource.m_lru_next->m_lru_prev = resource.m_lru_prev;
+	else m_lru_tail = resource.m_lru_prev;
+	resource.m_lru_prev = resource.m_lru_next = nullptr;
+	resource.m_is_cached = false;
+	m_stats.cached_size -= resource.m_resident_size;
+	--m_stats.cached_count;
+}
+
+void ResourceManager::evict()
+{
+	while (m_lru_head && (m_budget == 0 || m_stats.resident_size > m_budget)) {
+		++m_stats.evictions;
+		m_lru_head->doUnload();
+	}
+}
+
+void ResourceManager::addResident(Resource& resource)
+{
+	// size can change while the resource is ready (e.g. a dependency is reloaded), so we remember what we added
+	resource.m_resident_size = resource.getMemorySize();
+	m_stats.resident_size += resource.m_resident_size;
+	if (resource.m_is_cached) m_stats.cached_size += resource.m_resident_size;
+}
+
+void ResourceManager::removeResident(Resource& resource)
+{
+	m_stats.resident_size -= resource.m_resident_size;
+	if (resource.m_is_cached) m_stats.cached_size -= resource.m_resident_size;
+	resource.m_resident_size = 0;
+}
+
 void ResourceManager::removeUnreferenced()
 {
 	if (!m_is_unload_enabled) return;
@@ -82,8 +373,14 @@ void ResourceManager::removeUnreferenced()
 	for (auto* i : to_remove)
 	{
 		auto iter = m_resources.find(i->getPath().getHash());
-		if (iter.value()->isReady()) iter.value()->doUnload();
+		Resource* res = iter.value();
+		if (!res->isReady() || res->m_is_cached) continue;
+		// with a budget, unreferenced resources go through the cache like in `onUnreferenced`
+		if (m_budget == 0) res->doUnload();
+		else cache(*res);
 	}
+	// cached resources are unloaded only down to the budget, least recently used first
+	evict();
 }
 
 void ResourceManager::reload(const Path& path)
@@ -99,6 +396,7 @@ void ResourceManager::reload(Resource& resource)
 	}
 	else if (resource.m_desired_state == Resource::State::READY) return;
 
+	m_owner->traceLoadEvent(resource, ResourceLoadEvent::REQUESTED);
 	if (m_owner->onBeforeLoad(resource) == ResourceManagerHub::LoadHook::Action::DEFERRED)
 	{
 		ASSERT(!resource.m_hooked);
@@ -144,10 +442,19 @@ ResourceManagerHub::ResourceManagerHub(Engine& engine, IAllocator& allocator)
 	, m_allocator(allocator)
 	, m_load_hook(nullptr)
 	, m_file_system(nullptr)
+	, m_preloaded(allocator)
+	, m_finalize_queues(allocator)
 {
+	for (u32 i = 0; i < (u32)FileSystem::Priority::COUNT; ++i) m_finalize_queues.emplace(allocator);
 }
 
-ResourceManagerHub::~ResourceManagerHub() = default;
+ResourceManagerHub::~ResourceManagerHub()
+{
+	LUMIX_DELETE(m_allocator, m_load_trace);
+	LUMIX_DELETE(m_allocator, m_manifest_recording);
+	ASSERT(m_preloaded.empty());
+	ASSERT(m_finalize_queue_size == 0);
+}
 
 
 void ResourceManagerHub::init(FileSystem& fs)
@@ -172,6 +479,18 @@ Resource* ResourceManagerHub::load(ResourceManager& manager, const Path& path)
 	return manager.load(path);
 }
 
+void ResourceManagerHub::loadMany(ResourceType type, Span<const Path> paths, Span<Resource*> resources, ResourceGroup* group)
+{
+	PROFILE_FUNCTION();
+	ResourceManager* manager = get(type);
+	if (!manager) {
+		for (Resource*& res : resources) res = nullptr;
+		return;
+	}
+	manager->loadMany(paths, resources);
+	if (group) group->add(resources);
+}
+
 ResourceManager* ResourceManagerHub::get(ResourceType type)
 {
 	auto iter = m_resource_managers.find(type); 
@@ -232,6 +551,332 @@ void ResourceManagerHub::removeUnreferenced()
 	}
 }
 
+void ResourceManagerHub::setBudget(ResourceType type, u64 budget)
+{
+	ResourceManager* manager = get(type);
+	if (manager) manager->setBudget(budget);
+}
+
+void ResourceManagerHub::setTimeSliced(ResourceType type, bool enable)
+{
+	ResourceManager* manager = get(type);
+	if (manager) manager->setTimeSliced(enable);
+}
+
+void ResourceManagerHub::setFinalizeBudget(float ms, u64 bytes)
+{
+	m_finalize_budget_ms = ms;
+	m_finalize_budget_bytes = bytes;
+}
+
+void ResourceManagerHub::FinalizeQueue::push(Resource* resource)
+{
+	if (count == (u32)entries.size()) grow();
+	entries[(head + count) & (entries.size() - 1)] = resource;
+	++count;
+}
+
+Resource* ResourceManagerHub::FinalizeQueue::pop()
+{
+	ASSERT(!empty());
+	Resource* res = entries[head];
+	head = (head + 1) & (entries.size() - 1);
+	--count;
+	return res;
+}
+
+// unloading a queued resource is rare, so it's fine to search
+void ResourceManagerHub::FinalizeQueue::remove(Resource* resource)
+{
+	for (u32 i = 0; i < count; ++i) {
+		Resource*& entry = entries[(head + i) & (entries.size() - 1)];
+		if (entry == resource) {
+			entry = nullptr;
+			return;
+		}
+	}
+	ASSERT(false);
+}
+
+void ResourceManagerHub::FinalizeQueue::grow()
+{
+	Array<Resource*> tmp(entries.getAllocator());
+	tmp.resize(entries.empty() ? 64 : entries.size() * 2);
+	for (u32 i = 0; i < count; ++i) {
+		tmp[i] = entries[(head + i) & (entries.size() - 1)];
+	}
+	entries = static_cast<Array<Resource*>&&>(tmp);
+	head = 0;
+}
+
+void ResourceManagerHub::enqueueFinalize(Resource& resource)
+{
+	ASSERT(!resource.m_is_finalize_queued);
+	resource.m_is_finalize_queued = true;
+	resource.m_finalize_priority = resource.m_load_priority;
+	m_finalize_queues[(u32)resource.m_finalize_priority].push(&resource);
+	++m_finalize_queue_size;
+}
+
+void ResourceManagerHub::dequeueFinalize(Resource& resource)
+{
+	ASSERT(resource.m_is_finalize_queued);
+	resource.m_is_finalize_queued = false;
+	m_finalize_queues[(u32)resource.m_finalize_priority].remove(&resource);
+	--m_finalize_queue_size;
+}
+
+void ResourceManagerHub::finalizeQueued()
+{
+	PROFILE_FUNCTION();
+	os::Timer timer;
+	u64 bytes = 0;
+	u32 count = 0;
+	// finalizing can queue new resources or unload queued ones, so we always take the first one with the highest priority
+	while (m_finalize_queue_size > 0) {
+		if (count > 0) {
+			if (m_finalize_budget_ms > 0 && timer.getTimeSinceStart() * 1000 > m_finalize_budget_ms) break;
+			if (m_finalize_budget_bytes > 0 && bytes >= m_finalize_budget_bytes) break;
+		}
+		Resource* res = nullptr;
+		for (FinalizeQueue& queue : m_finalize_queues) {
+			while (!res && !queue.empty()) res = queue.pop();
+			if (res) break;
+		}
+		ASSERT(res);
+		res->m_is_finalize_queued = false;
+		--m_finalize_queue_size;
+		bytes += res->m_deferred_content ? res->m_deferred_content->size() : res->m_file_size;
+		++count;
+		res->finalize();
+	}
+
+	static u32 queue_counter = profiler::createCounter("Resource finalize queue", 0);
+	static u32 finalized_counter = profiler::createCounter("Resources finalized", 0);
+	static u32 finalized_size_counter = profiler::createCounter("Resources finalized (MB)", 0);
+	profiler::pushCounter(queue_counter, float(m_finalize_queue_size));
+	// per frame
+	profiler::pushCounter(finalized_counter, float(count));
+	profiler::pushCounter(finalized_size_counter, float(double(bytes) / (1024 * 1024)));
+}
+
+void ResourceManagerHub::disableCache()
+{
+	for (Resource* res : m_preloaded) res->decRefCount();
+	m_preloaded.clear();
+
+	for (ResourceManager* manager : m_resource_managers) {
+		manager->setBudget(0);
+	}
+}
+
+void ResourceManagerHub::update()
+{
+	PROFILE_FUNCTION();
+	finalizeQueued();
+
+	ResourceManager::Stats stats;
+	for (ResourceManager* manager : m_resource_managers) {
+		manager->evict();
+		const ResourceManager::Stats& s = manager->getStats();
+		stats.resident_size += s.resident_size;
+		stats.cached_size += s.cached_size;
+		stats.cached_count += s.cached_count;
+		stats.hits += s.hits;
+		stats.misses += s.misses;
+		stats.evictions += s.evictions;
+	}
+
+	static u32 resident_counter = profiler::createCounter("Resources resident (MB)", 0);
+	static u32 cached_counter = profiler::createCounter("Resources cached (MB)", 0);
+	static u32 hits_counter = profiler::createCounter("Resource cache hits", 0);
+	static u32 misses_counter = profiler::createCounter("Resource cache misses", 0);
+	static u32 evictions_counter = profiler::createCounter("Resource evictions", 0);
+	profiler::pushCounter(resident_counter, float(double(stats.resident_size) / (1024 * 1024)));
+	profiler::pushCounter(cached_counter, float(double(stats.cached_size) / (1024 * 1024)));
+	// per frame
+	profiler::pushCounter(hits_counter, float(stats.hits - m_last_stats.hits));
+	profiler::pushCounter(misses_counter, float(stats.misses - m_last_stats.misses));
+	profiler::pushCounter(evictions_counter, float(stats.evictions - m_last_stats.evictions));
+	m_last_stats = stats;
+
+	if (m_manifest_recording && m_manifest_recording->isFinished(*this)) {
+		saveManifest();
+	}
+
+	if (!m_preloaded.empty() && !isAnyLoading(m_preloaded)) {
+		for (Resource* res : m_preloaded) res->decRefCount();
+		m_preloaded.clear();
+	}
+
+	if (m_load_trace) {
+		bool finished;
+		{
+			MutexGuard lock(m_load_trace_mutex);
+			finished = m_load_trace && m_load_trace->isFinished(*this);
+		}
+		if (finished) endLoadTrace();
+	}
+}
+
+void ResourceManagerHub::beginLoadTrace()
+{
+	MutexGuard lock(m_load_trace_mutex);
+	LUMIX_DELETE(m_allocator, m_load_trace);
+	m_load_trace = LUMIX_NEW(m_allocator, ResourceLoadTrace)(m_allocator);
+}
+
+void ResourceManagerHub::endLoadTrace()
+{
+	ResourceLoadTrace* trace;
+	{
+		MutexGuard lock(m_load_trace_mutex);
+		trace = m_load_trace;
+		m_load_trace = nullptr;
+	}
+	if (!trace) return;
+
+	logLoadTrace(*trace, m_allocator);
+	LUMIX_DELETE(m_allocator, trace);
+}
+
+void ResourceManagerHub::traceLoadEvent(Resource& resource, ResourceLoadEvent event, u64 timestamp, u64 bytes)
+{
+	if (!m_load_trace) return;
+	if (timestamp == 0) timestamp = os::Timer::getRawTimestamp();
+
+	switch (event) {
+		case ResourceLoadEvent::REQUESTED:
+		case ResourceLoadEvent::READY:
+		case ResourceLoadEvent::FAILED: {
+			// instant events are shown as empty blocks
+			static const char* names[] = { "resource requested", "resource ready", "resource failed" };
+			profiler::beginBlock(names[event == ResourceLoadEvent::REQUESTED ? 0 : event == ResourceLoadEvent::READY ? 1 : 2]);
+			profiler::pushString(resource.getPath().c_str());
+			profiler::endBlock();
+			break;
+		}
+		default: break;
+	}
+
+	MutexGuard lock(m_load_trace_mutex);
+	if (!m_load_trace) return;
+	ResourceLoadTrace::Entry& entry = m_load_trace->getEntry(resource);
+	if (event == ResourceLoadEvent::REQUESTED) {
+		// reload
+		memset(entry.times, 0, sizeof(entry.times));
+		entry.has_dependency = false;
+	}
+	entry.times[(u32)event] = timestamp;
+	if (event == ResourceLoadEvent::IO_END) entry.file_size = bytes;
+	if (event == ResourceLoadEvent::DECOMPRESS_END) entry.decompressed_size = bytes;
+}
+
+void ResourceManagerHub::traceLoadDependency(Resource& resource, Resource& dependency)
+{
+	if (!m_load_trace) return;
+	MutexGuard lock(m_load_trace_mutex);
+	if (!m_load_trace) return;
+	ResourceLoadTrace::Entry& entry = m_load_trace->getEntry(resource);
+	entry.dependency = getResourceKey(dependency.getType(), dependency.getPath());
+	entry.has_dependency = true;
+}
+
+void ResourceManagerHub::onLoad(Resource& resource)
+{
+	if (!m_manifest_recording || m_is_preloading) return;
+	const RuntimeHash key = getResourceKey(resource.getType(), resource.getPath());
+	if (m_manifest_recording->map.find(key).isValid()) return;
+
+	m_manifest_recording->map.insert(key, m_manifest_recording->resources.size());
+	m_manifest_recording->resources.push({resource.getType(), resource.getPath()});
+}
+
+bool ResourceManagerHub::isAnyLoading(const Array<Resource*>& resources) const
+{
+	for (Resource* res : resources) {
+		if (res->isEmpty() && res->m_desired_state == Resource::State::READY) return true;
+	}
+	return false;
+}
+
+void ResourceManagerHub::recordManifest(const Path& manifest_path)
+{
+	LUMIX_DELETE(m_allocator, m_manifest_recording);
+	m_manifest_recording = LUMIX_NEW(m_allocator, ManifestRecording)(manifest_path, m_allocator);
+}
+
+void ResourceManagerHub::saveManifest()
+{
+	OutputMemoryStream blob(m_allocator);
+	blob.write(MANIFEST_MAGIC);
+	blob.write(MANIFEST_VERSION);
+	blob.write(m_manifest_recording->resources.size());
+	for (const ManifestRecording::Entry& e : m_manifest_recording->resources) {
+		blob.write(e.type.type.getHashValue());
+		blob.writeString(e.path);
+	}
+	if (!m_file_system->saveContentSync(m_manifest_recording->path, blob)) {
+		logError("Could not save ", m_manifest_recording->path);
+	}
+	LUMIX_DELETE(m_allocator, m_manifest_recording);
+	m_manifest_recording = nullptr;
+}
+
+Path ResourceManagerHub::getManifestPath(const Path& world_path)
+{
+	return Path(world_path, ".manifest");
+}
+
+bool ResourceManagerHub::preload(const Path& manifest_path)
+{
+	PROFILE_FUNCTION();
+	OutputMemoryStream data(m_allocator);
+	if (!m_file_system->getContentSync(manifest_path, data)) return false;
+
+	InputMemoryStream blob(data);
+	if (blob.read<u32>() != MANIFEST_MAGIC || blob.read<u32>() != MANIFEST_VERSION) {
+		logWarning("Unsupported manifest ", manifest_path);
+		return false;
+	}
+
+	struct Request {
+		ResourceManager* manager;
+		Path path;
+		u64 order;
+	};
+	Array<Request> requests(m_allocator);
+	const u32 count = blob.read<u32>();
+	for (u32 i = 0; i < count && !blob.hasOverflow(); ++i) {
+		ResourceType type;
+		type.type = RuntimeHash::fromU64(blob.read<u64>());
+		const Path path(blob.readString());
+		if (blob.hasOverflow()) break;
+
+		// stale entries, e.g. resource was deleted since the manifest was recorded
+		ResourceManager* manager = get(type);
+		if (!manager) continue;
+		const Path file_path = Resource::getFilePath(path);
+		if (!m_file_system->fileExists(file_path)) continue;
+
+		Request& req = requests.emplace();
+		req.manager = manager;
+		req.path = path;
+		req.order = m_file_system->getReadOrder(file_path);
+	}
+	sort(requests.begin(), requests.end(), [](const Request& a, const Request& b){ return a.order < b.order; });
+
+	// preloaded resources are recorded only if something else loads them too
+	m_is_preloading = true;
+	m_preloaded.reserve(m_preloaded.size() + requests.size());
+	for (const Request& req : requests) {
+		Resource* res = req.manager->load(req.path);
+		if (res) m_preloaded.push(res);
+	}
+	m_is_preloading = false;
+	return true;
+}
+
 void ResourceManagerHub::enableUnload(bool enable)
 {
 	for (auto* manager : m_resource_managers)
@@ -247,7 +892,10 @@ void ResourceManagerHub::reloadAll() {
 	for (auto* manager : m_resource_managers) {
 		ResourceManager::ResourceTable& resources = manager->getResourceTable();
 		for (Resource* res : resources) {
-			if (res->isReady()) {
+			if (res->isCached()) {
+				res->doUnload();
+			}
+			else if (res->isReady()) {
 				res->doUnload();
 				to_reload.push(res);
 			}
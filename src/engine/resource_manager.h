@@ -2,23 +2,67 @@
 
 #include "engine/lumix.h"
 
+#include "core/array.h"
 #include "core/hash.h"
 #include "core/hash_map.h"
+#include "core/sync.h"
+#include "engine/file_system.h"
 
 
 namespace Lumix {
 
+// lifecycle of a resource load, see `ResourceManagerHub::beginLoadTrace`
+enum class ResourceLoadEvent : u8 {
+	REQUESTED,
+	// file requested from file system, time since `REQUESTED` is spent in load hook, e.g. asset compiler
+	QUEUED,
+	IO_START,
+	IO_END,
+	DECOMPRESS_START,
+	DECOMPRESS_END,
+	LOAD_START,
+	// resource waits for its dependencies until `READY`
+	LOAD_END,
+	READY,
+	FAILED,
+
+	COUNT
+};
+
 struct LUMIX_ENGINE_API ResourceManager {
 	friend struct Resource;
 	friend struct ResourceManagerHub;
 	using ResourceTable = HashMap<FilePathHash, struct Resource*>;
 
+	struct Stats {
+		// memory of ready resources, including cached ones
+		u64 resident_size = 0;
+		// memory of unreferenced resources kept loaded for reuse
+		u64 cached_size = 0;
+		u32 cached_count = 0;
+		// `load` of a resource which is already loaded or loading
+		u64 hits = 0;
+		u64 misses = 0;
+		u64 evictions = 0;
+	};
+
 	void create(struct ResourceType type, struct ResourceManagerHub& owner);
 	void destroy();
 
 	void enableUnload(bool enable);
 
+	// unloads unreferenced resources, with a budget they are cached and evicted only down to the budget
 	void removeUnreferenced();
+	// unreferenced resources stay loaded until memory of ready resources exceeds `budget`
+	// then they are unloaded, least recently used first; 0 - unreferenced resources are unloaded immediately
+	void setBudget(u64 budget);
+	u64 getBudget() const { return m_budget; }
+	const Stats& getStats() const { return m_stats; }
+	void evict();
+	// loaded resources are finalized (`load` or `finishAsyncLoad`) within `ResourceManagerHub`'s per frame budget
+	// instead of as soon as their file is read, see `ResourceManagerHub::setFinalizeBudget`
+	void setTimeSliced(bool enable) { m_is_time_sliced = enable; }
+	bool isTimeSliced() const { return m_is_time_sliced; }
 
 	void reload(const struct Path& path);
 	void reload(Resource& resource);
@@ -30,19 +74,36 @@ struct LUMIX_ENGINE_API ResourceManager {
 
 protected:
 	Resource* load(const Path& path);
+	void loadMany(Span<const Path> paths, Span<Resource*> resources);
+	// reads are not started if `requests` is not null, they are added to `requests` and `to_read` instead
+	Resource* load(const Path& path, Array<FileSystem::ContentRequest>* requests, Array<Resource*>* to_read);
 	virtual Resource* createResource(const Path& path) = 0;
 	virtual void destroyResource(Resource& resource) = 0;
 	Resource* get(const Path& path);
+	void onUnreferenced(Resource& resource);
+	void cache(Resource& resource);
+	void uncache(Resource& resource);
+	void addResident(Resource& resource);
+	void removeResident(Resource& resource);
 
 protected:
 	IAllocator& m_allocator;
 	ResourceTable m_resources;
 	ResourceManagerHub* m_owner;
 	bool m_is_unload_enabled;
+	u64 m_budget = 0;
+	Stats m_stats;
+	// cached resources, `m_lru_head` is the least recently used
+	Resource* m_lru_head = nullptr;
+	Resource* m_lru_tail = nullptr;
+	// also read on worker threads by `Resource::decodeFile`
+	bool m_is_time_sliced = false;
 };
 
 
 struct LUMIX_ENGINE_API ResourceManagerHub {
+	friend struct ResourceManager;
+	friend struct Resource;
 	using ResourceManagerTable = HashMap<ResourceType, ResourceManager*>;
 
 	struct LUMIX_ENGINE_API LoadHook {
@@ -71,6 +132,9 @@ struct LUMIX_ENGINE_API ResourceManagerHub {
 	}
 
 	Resource* load(ResourceType type, const Path& path);
+	// same as calling `load` for each path, but file reads are submitted at once
+	// `resources[i]` is the resource for `paths[i]`, `group` (optional) tracks when all of them are loaded
+	void loadMany(ResourceType type, Span<const Path> paths, Span<Resource*> resources, struct ResourceGroup* group = nullptr);
 	// use `loadRaw` to load nonresource files, synchronous
 	// files loaded this way are tracked as dependencies 
 	bool loadRaw(const Path& included_from, const Path& path, OutputMemoryStream& data);
@@ -84,16 +148,84 @@ struct LUMIX_ENGINE_API ResourceManagerHub {
 	void reloadAll();
 	void removeUnreferenced();
 	void enableUnload(bool enable);
+	void setBudget(ResourceType type, u64 budget);
+	void setTimeSliced(ResourceType type, bool enable);
+	// time sliced resources are finalized in `update`, higher priority first, until `ms` or `bytes` is spent
+	// at least one resource is finalized each frame, 0 - unlimited
+	void setFinalizeBudget(float ms, u64 bytes);
+	u32 getFinalizeQueueSize() const { return m_finalize_queue_size; }
+	// releases preloaded resources, unloads cached ones and sets all budgets to 0, e.g. before managers are destroyed
+	void disableCache();
+	// finalizes queued resources, evicts resources over budget and pushes stats to profiler, once per frame
+	void update();
+
+	// records lifecycle of resource loads, the summary is logged once all traced loads are finished
+	void beginLoadTrace();
+	// logs the summary even if some traced loads are not finished
+	void endLoadTrace();
+	bool isLoadTraceActive() const { return m_load_trace; }
+	// can be called from any thread, `timestamp` is raw `os::Timer` timestamp, 0 - now
+	void traceLoadEvent(Resource& resource, ResourceLoadEvent event, u64 timestamp = 0, u64 bytes = 0);
+	// `dependency` became ready while `resource` waited for it
+	void traceLoadDependency(Resource& resource, Resource& dependency);
+
+	// records all resources loaded from now on, once they are loaded, saves them to `manifest_path`
+	// e.g. while a world loads, manifest is then stored next to the world
+	void recordManifest(const Path& manifest_path);
+	// loads all resources from the manifest at once, in the order they are in pak,
+	// instead of discovering them one dependency layer at a time
+	// entries which do not exist anymore are skipped, preloaded resources are released once all of them are loaded
+	bool preload(const Path& manifest_path);
+	// manifest of a world is stored next to it
+	static Path getManifestPath(const Path& world_path);
+	// manifest: MANIFEST_MAGIC, MANIFEST_VERSION, u32 count, (u64 type hash, path)[count], e.g. a load trace for `PackBuilder`
+	static constexpr u32 MANIFEST_MAGIC = 'LMFT';
+	static constexpr u32 MANIFEST_VERSION = 0;
 
 	FileSystem& getFileSystem() { return *m_file_system; }
 
 private:
+	// growable ring buffer, FIFO, resources removed from the middle are replaced with nullptr
+	struct FinalizeQueue {
+		FinalizeQueue(IAllocator& allocator) : entries(allocator) {}
+		bool empty() const { return count == 0; }
+		void push(Resource* resource);
+		// can return nullptr
+		Resource* pop();
+		void remove(Resource* resource);
+		void grow();
+
+		Array<Resource*> entries;
+		u32 head = 0;
+		u32 count = 0;
+	};
+
 	Resource* load(ResourceManager& manager, const Path& path);
+	void onLoad(Resource& resource);
+	bool isAnyLoading(const Array<Resource*>& resources) const;
+	void saveManifest();
+	void enqueueFinalize(Resource& resource);
+	void dequeueFinalize(Resource& resource);
+	void finalizeQueued();
+
 	IAllocator& m_allocator;
 	ResourceManagerTable m_resource_managers;
 	FileSystem* m_file_system;
 	Engine& m_engine;
 	LoadHook* m_load_hook;
+	// totals from the last `update`
+	ResourceManager::Stats m_last_stats;
+	struct ResourceLoadTrace* m_load_trace = nullptr;
+	Mutex m_load_trace_mutex;
+	struct ManifestRecording* m_manifest_recording = nullptr;
+	// we hold a reference to preloaded resources until all of them are loaded
+	Array<Resource*> m_preloaded;
+	bool m_is_preloading = false;
+	// one queue per load priority
+	Array<FinalizeQueue> m_finalize_queues;
+	u32 m_finalize_queue_size = 0;
+	float m_finalize_budget_ms = 2;
+	u64 m_finalize_budget_bytes = 0;
 };
 
 
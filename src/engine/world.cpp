@@ -1,9 +1,11 @@
 #include "world.h"
 #include "engine/engine.h"
 #include "core/hash.h"
+#include "core/hash_map.h"
+#include "core/job_system.h"
 #include "core/log.h"
 #include "core/math.h"
-#include "core/sort.h"
+#include "core/profiler.h"
 #include "engine/plugin.h"
 #include "engine/prefab.h"
 #include "engine/reflection.h"
@@ -17,80 +19,197 @@ static constexpr int RESERVED_ENTITIES_COUNT = 1024;
 
 const ComponentUID ComponentUID::INVALID(INVALID_ENTITY, { -1 }, 0);
 
+// kept in job's data, since the job can continue on another thread after it waits
+void World::setUpdateValidation(UpdateValidation* validation) {
+	#ifdef LUMIX_DEBUG
+		jobs::setJobLocalData(validation);
+	#endif
+}
+
+// reported once per update call, to not flood the log
+static void validateModuleAccess(const IModule* accessed) {
+	#ifdef LUMIX_DEBUG
+		World::UpdateValidation* v = (World::UpdateValidation*)jobs::getJobLocalData();
+		if (!v || v->reported || !accessed || accessed == v->module) return;
+		if (v->access->dependsOn(accessed->getName())) return;
+		v->reported = true;
+		logError("Module ", v->module->getName(), " accesses module ", accessed->getName(), " during update, but does not declare it in getUpdateAccess");
+	#endif
+}
+
+static void validateComponentAccess(const IModule* accessed, ComponentType type) {
+	#ifdef LUMIX_DEBUG
+		World::UpdateValidation* v = (World::UpdateValidation*)jobs::getJobLocalData();
+		if (!v || v->reported || !accessed || accessed == v->module) return;
+		const u64 bit = u64(1) << type.index;
+		if ((v->access->read_components | v->access->write_components) & bit) return;
+		validateModuleAccess(accessed);
+	#endif
+}
+
+static void validateTransformWrite() {
+	#ifdef LUMIX_DEBUG
+		World::UpdateValidation* v = (World::UpdateValidation*)jobs::getJobLocalData();
+		if (!v || v->reported || v->access->write_transforms) return;
+		v->reported = true;
+		logError("Module ", v->module->getName(), " writes transforms during update, but does not declare it in getUpdateAccess");
+	#endif
+}
+
 
 static constexpr u32 EMPTY_ARCHETYPE = 0;
 
 // archetype is a unique set of component types
+// since there are at most 64 component types, the set is represented by a bitmask, which is also used as a key for lookup
+// add/remove transitions between archetypes are cached, so changing components of an entity does not need any lookup
 struct World::ArchetypeManager {
+	static constexpr ArchetypeHandle INVALID_ARCHETYPE = 0xffFF;
+	static_assert(ComponentType::MAX_TYPES_COUNT <= 64, "Archetype mask can not hold all component types");
+
 	struct Archetype {
 		Archetype(IAllocator& allocator)
 			: types(allocator)
-		{}
+			, entities(allocator)
+		{
+			for (ArchetypeHandle& h : add_edges) h = INVALID_ARCHETYPE;
+			for (ArchetypeHandle& h : remove_edges) h = INVALID_ARCHETYPE;
+		}
 
-		RuntimeHash32 hash;
+		u64 mask = 0;
+		// sorted by ComponentType::index
 		Array<ComponentType> types;
+		// all entities with this archetype, in no particular order, EntityData::archetype_slot is index into this
+		Array<EntityRef> entities;
+		// archetype we get by adding/removing component type to/from this archetype, indexed by ComponentType::index
+		ArchetypeHandle add_edges[ComponentType::MAX_TYPES_COUNT];
+		ArchetypeHandle remove_edges[ComponentType::MAX_TYPES_COUNT];
 	};
 
-	using ArchetypeHandle = u32;
-	
 	ArchetypeManager(IAllocator& allocator)
 		: m_archetypes(allocator)
 		, m_allocator(allocator)
+		, m_map(allocator)
 	{
 		m_archetypes.reserve(1024);
-		m_archetypes.emplace(m_allocator); // 0-th archetype is reserved for invalid archetype
+		m_map.reserve(1024);
+		m_archetypes.emplace(m_allocator); // 0-th archetype is empty set of components
+		m_map.insert(0, EMPTY_ARCHETYPE);
 	}
 
-	const Archetype& get(ArchetypeHandle handle) {
+	Archetype& get(ArchetypeHandle handle) {
 		return m_archetypes[handle];
 	}
 
 	bool hasComponent(ArchetypeHandle archetype, ComponentType type) {
-		const Archetype& a = m_archetypes[archetype];
-		for (ComponentType t : a.types) {
-			if (t == type) return true;
-		}
-		return false;
+		return m_archetypes[archetype].mask & (u64(1) << type.index);
+	}
+
+	ArchetypeHandle addComponent(ArchetypeHandle archetype, ComponentType type) {
+		ArchetypeHandle res = m_archetypes[archetype].add_edges[type.index];
+		if (res != INVALID_ARCHETYPE) return res;
+
+		res = fromMask(m_archetypes[archetype].mask | (u64(1) << type.index));
+		m_archetypes[archetype].add_edges[type.index] = res;
+		if (res != archetype) m_archetypes[res].remove_edges[type.index] = archetype;
+		return res;
 	}
 
-	ArchetypeHandle get(Span<ComponentType> types) {
-		RollingHasher hasher;
+	ArchetypeHandle removeComponent(ArchetypeHandle archetype, ComponentType type) {
+		ArchetypeHandle res = m_archetypes[archetype].remove_edges[type.index];
+		if (res != INVALID_ARCHETYPE) return res;
 
-		// we sort to get the same hash for different order
-		sort(types.begin(), types.end(), [](const ComponentType& a, const ComponentType& b) { return a.index < b.index; });
+		res = fromMask(m_archetypes[archetype].mask & ~(u64(1) << type.index));
+		m_archetypes[archetype].remove_edges[type.index] = res;
+		if (res != archetype) m_archetypes[res].add_edges[type.index] = archetype;
+		return res;
+	}
 
-		hasher.begin();
-		for (ComponentType type : types) {
-			hasher.update(&type, sizeof(type));
-		}
-		const RuntimeHash32 hash = hasher.end();
-
-		for (u32 i = 0, c = m_archetypes.size(); i < c; ++i) {
-			if (m_archetypes[i].hash == hash) {
-				Archetype& a = m_archetypes[i];
-				if (a.types.size() != types.length()) continue;
-				bool equal = true;
-				for (u32 j = 0; j < types.length(); ++j) {
-					if (a.types[j] != types[j]) {
-						equal = false;
-						break;
-					}
-				}
-				if (equal) return i;
-			}
+	// `entities` are indexed by EntityRef::index
+	template <typename T>
+	void rebuildEntityLists(Array<T>& entities) {
+		for (Archetype& a : m_archetypes) a.entities.clear();
+		for (i32 i = 0, c = entities.size(); i < c; ++i) {
+			T& e = entities[i];
+			if (!e.valid) continue;
+			Array<EntityRef>& list = m_archetypes[e.archetype].entities;
+			e.archetype_slot = list.size();
+			list.push({i});
 		}
+	}
+
+	ArchetypeHandle fromMask(u64 mask) {
+		auto iter = m_map.find(mask);
+		if (iter.isValid()) return iter.value();
 
+		ASSERT(m_archetypes.size() < INVALID_ARCHETYPE);
+		const ArchetypeHandle handle = (ArchetypeHandle)m_archetypes.size();
 		Archetype& a = m_archetypes.emplace(m_allocator);
-		a.hash = hash;
-		a.types.resize(types.length());
-		memcpy(a.types.begin(), types.begin(), types.length() * sizeof(ComponentType));
-		return m_archetypes.size() - 1;
+		a.mask = mask;
+		for (i32 i = 0; i < ComponentType::MAX_TYPES_COUNT; ++i) {
+			if (mask & (u64(1) << i)) a.types.push({i});
+		}
+		m_map.insert(mask, handle);
+		return handle;
 	}
 
 	IAllocator& m_allocator;
 	Array<Archetype> m_archetypes;
+	HashMap<u64, ArchetypeHandle> m_map;
 };
 
+void World::setArchetype(EntityRef entity, ArchetypeHandle archetype) {
+	EntityData& data = m_entities[entity.index];
+	if (data.archetype == archetype) return;
+
+	Array<EntityRef>& old_entities = m_archetype_manager->get(data.archetype).entities;
+	const EntityRef last = old_entities.back();
+	old_entities[data.archetype_slot] = last;
+	m_entities[last.index].archetype_slot = data.archetype_slot;
+	old_entities.pop();
+
+	Array<EntityRef>& new_entities = m_archetype_manager->get(archetype).entities;
+	data.archetype = archetype;
+	data.archetype_slot = new_entities.size();
+	new_entities.push(entity);
+}
+
+u32 World::getArchetypesCount() const {
+	return m_archetype_manager->m_archetypes.size();
+}
+
+u64 World::getArchetypeMask(ArchetypeHandle archetype) const {
+	return m_archetype_manager->get(archetype).mask;
+}
+
+Span<const EntityRef> World::getArchetypeEntities(ArchetypeHandle archetype) const {
+	return m_archetype_manager->get(archetype).entities;
+}
+
+EntityQuery::EntityQuery(World& world, Span<const ComponentType> with, Span<const ComponentType> without)
+	: m_world(world)
+	, m_archetypes(world.getAllocator())
+{
+	for (ComponentType type : with) m_with |= u64(1) << type.index;
+	for (ComponentType type : without) m_without |= u64(1) << type.index;
+}
+
+void EntityQuery::update() {
+	const u32 count = m_world.getArchetypesCount();
+	for (u32 i = m_checked_archetypes; i < count; ++i) {
+		const u64 mask = m_world.getArchetypeMask((World::ArchetypeHandle)i);
+		if ((mask & m_with) == m_with && (mask & m_without) == 0) {
+			m_archetypes.push((World::ArchetypeHandle)i);
+		}
+	}
+	m_checked_archetypes = count;
+}
+
+u32 EntityQuery::count() {
+	u32 res = 0;
+	forEachChunk([&](Span<const EntityRef> entities){ res += entities.length(); });
+	return res;
+}
+
 EntityMap::EntityMap(IAllocator& allocator) 
 	: m_map(allocator)
 {}
@@ -128,11 +247,15 @@ World::World(Engine& engine)
 	, m_component_destroyed(m_allocator)
 	, m_entity_destroyed(m_allocator)
 	, m_entity_created(m_allocator)
+	, m_entities_created(m_allocator)
+	, m_entities_destroyed(m_allocator)
+	, m_components_added(m_allocator)
 	, m_first_free_slot(-1)
 	, m_modules(m_allocator)
 	, m_hierarchy(m_allocator)
 	, m_transforms(m_allocator)
 	, m_partitions(m_allocator)
+	, m_dirty_transforms(m_allocator)
 {
 	m_archetype_manager = UniquePtr<ArchetypeManager>::create(m_allocator, m_allocator);
 	m_entities.reserve(RESERVED_ENTITIES_COUNT);
@@ -163,10 +286,12 @@ World::PartitionHandle World::createPartition(const char* name) {
 }
 
 void World::destroyPartition(PartitionHandle partition) {
+	Array<EntityRef> entities(m_allocator);
 	for (EntityData& e : m_entities) {
 		if (!e.valid) continue;
-		if (e.partition == partition) destroyEntity({i32(&e - m_entities.begin())});
+		if (e.partition == partition) entities.push({i32(&e - m_entities.begin())});
 	}
+	destroyEntities(entities);
 	m_partitions.eraseItems([&](const Partition& p){ return p.handle == partition; });
 }
 
@@ -192,7 +317,9 @@ World::PartitionHandle World::getPartition(EntityRef entity) {
 
 IModule* World::getModule(ComponentType type) const {
 	ComponentTypeEntry* entry = m_component_type_map[type.index].get();
-	return entry ? entry->module : nullptr;
+	if (!entry) return nullptr;
+	validateComponentAccess(entry->module, type);
+	return entry->module;
 }
 
 
@@ -202,6 +329,7 @@ IModule* World::getModule(const char* name) const
 	{
 		if (equalStrings(module->getName(), name))
 		{
+			validateModuleAccess(module.get());
 			return module.get();
 		}
 	}
@@ -252,12 +380,132 @@ DelegateList<void(EntityRef)>& World::componentTransformed(ComponentType type) {
 	return m_component_type_map[type.index]->transformed;
 }
 
+void World::enableTransformTracking(ComponentType type, bool enable) {
+	if (!m_component_type_map[type.index].get()) m_component_type_map[type.index].create(m_allocator);
+	if (!enable) clearTransformedEntities(type);
+	m_component_type_map[type.index]->track_transforms = enable;
+}
+
+Span<const EntityRef> World::getTransformedEntities(ComponentType type) const {
+	const ComponentTypeEntry* entry = m_component_type_map[type.index].get();
+	if (!entry) return {};
+	return entry->tracked_transforms;
+}
+
+void World::clearTransformedEntities(ComponentType type) {
+	ComponentTypeEntry* entry = m_component_type_map[type.index].get();
+	if (!entry) return;
+	const u64 mask = ~(u64(1) << type.index);
+	for (EntityRef e : entry->tracked_transforms) m_entities[e.index].tracked_transforms &= mask;
+	entry->tracked_transforms.clear();
+}
+
+void World::notifyTransformed(EntityRef entity) {
+	EntityData& data = m_entities[entity.index];
+	const ArchetypeManager::Archetype& archetype = m_archetype_manager->get(data.archetype);
+	for (ComponentType type : archetype.types) {
+		ComponentTypeEntry& entry = *m_component_type_map[type.index];
+		entry.transformed.invoke(entity);
+		const u64 bit = u64(1) << type.index;
+		if (entry.track_transforms && (data.tracked_transforms & bit) == 0) {
+			data.tracked_transforms |= bit;
+			entry.tracked_transforms.push(entity);
+		}
+	}
+}
+
+void World::setDeferredTransforms(bool enable) {
+	if (!enable) updateTransforms();
+	m_deferred_transforms = enable;
+}
+
+// global transforms below dirty entities are stale until `updateTransforms`, this recomputes `entity`'s and its ancestors' ones
+// returns true if `entity` has a dirty ancestor
+bool World::resolveTransform(EntityRef entity) {
+	if (!m_deferred_transforms || m_dirty_transforms.empty()) return false;
+	const i32 hierarchy_idx = m_entities[entity.index].hierarchy;
+	if (hierarchy_idx < 0) return false;
+	const Hierarchy& h = m_hierarchy[hierarchy_idx];
+	if (!h.parent.isValid()) return false;
+
+	const EntityRef parent = (EntityRef)h.parent;
+	if (!resolveTransform(parent) && !m_entities[parent.index].transform_dirty) return false;
+	m_transforms[entity.index] = m_transforms[parent.index].compose(h.local_transform);
+	return true;
+}
+
+void World::markTransformDirty(EntityRef entity) {
+	EntityData& data = m_entities[entity.index];
+	if (data.transform_dirty) return;
+	data.transform_dirty = true;
+	m_dirty_transforms.push(entity);
+}
+
+bool World::hasDirtyAncestor(EntityRef entity) const {
+	for (EntityPtr e = getParent(entity); e.isValid(); e = getParent((EntityRef)e)) {
+		if (m_entities[e.index].transform_dirty) return true;
+	}
+	return false;
+}
+
+// `entity`'s global transform is up to date, recompute its descendants
+void World::propagateTransform(EntityRef entity, Array<EntityRef>& transformed) {
+	transformed.push(entity);
+	const i32 hierarchy_idx = m_entities[entity.index].hierarchy;
+	if (hierarchy_idx < 0) return;
+
+	const Transform my_transform = m_transforms[entity.index];
+	for (EntityPtr child = m_hierarchy[hierarchy_idx].first_child; child.isValid();) {
+		const Hierarchy& child_h = m_hierarchy[m_entities[child.index].hierarchy];
+		m_transforms[child.index] = my_transform.compose(child_h.local_transform);
+		propagateTransform((EntityRef)child, transformed);
+		child = child_h.next_sibling;
+	}
+}
+
+void World::updateTransforms() {
+	if (m_dirty_transforms.empty()) return;
+	PROFILE_FUNCTION();
+
+	// dirty entities with dirty ancestor are handled by the ancestor, the rest are roots of independent subtrees
+	Array<EntityRef> roots(m_allocator);
+	for (EntityRef e : m_dirty_transforms) {
+		if (!m_entities[e.index].valid) continue;
+		if (!hasDirtyAncestor(e)) roots.push(e);
+	}
+
+	Array<EntityRef> transformed(m_allocator);
+	jobs::Mutex mutex;
+	jobs::forEach(roots.size(), 64, [&](i32 from, i32 to){
+		PROFILE_BLOCK("propagate transforms");
+		Array<EntityRef> tmp(m_allocator);
+		for (i32 i = from; i < to; ++i) propagateTransform(roots[i], tmp);
+		jobs::MutexGuard guard(mutex);
+		for (EntityRef e : tmp) transformed.push(e);
+	});
+
+	for (EntityRef e : m_dirty_transforms) m_entities[e.index].transform_dirty = false;
+	m_dirty_transforms.clear();
+
+	// modules which want all transformed entities at once use `enableTransformTracking`
+	for (EntityRef e : transformed) notifyTransformed(e);
+}
+
 void World::transformEntity(EntityRef entity, bool update_local)
 {
-	const ArchetypeManager::Archetype& archetype = m_archetype_manager->get(m_entities[entity.index].archetype);
-	for (ComponentType type : archetype.types) {
-		m_component_type_map[type.index]->transformed.invoke(entity);
+	validateTransformWrite();
+	if (m_deferred_transforms) {
+		// setters call `resolveTransform` before they write, so the parent is up to date
+		EntityData& data = m_entities[entity.index];
+		if (update_local && data.hierarchy >= 0) {
+			Hierarchy& h = m_hierarchy[data.hierarchy];
+			if (h.parent.isValid()) h.local_transform = Transform::computeLocal(getTransform((EntityRef)h.parent), getTransform(entity));
+		}
+		markTransformDirty(entity);
+		return;
 	}
+
+	notifyTransformed(entity);
 	
 	const i32 hierarchy_idx = m_entities[entity.index].hierarchy;
 	if (hierarchy_idx >= 0) {
@@ -284,6 +532,7 @@ void World::transformEntity(EntityRef entity, bool update_local)
 
 void World::setRotation(EntityRef entity, const Quat& rot)
 {
+	resolveTransform(entity);
 	m_transforms[entity.index].rot = rot;
 	transformEntity(entity, true);
 }
@@ -291,6 +540,7 @@ void World::setRotation(EntityRef entity, const Quat& rot)
 
 void World::setRotation(EntityRef entity, float x, float y, float z, float w)
 {
+	resolveTransform(entity);
 	m_transforms[entity.index].rot.set(x, y, z, w);
 	transformEntity(entity, true);
 }
@@ -304,14 +554,13 @@ bool World::hasEntity(EntityRef entity) const
 
 void World::setTransformKeepChildren(EntityRef entity, const Transform& transform)
 {
+	validateTransformWrite();
+	resolveTransform(entity);
 	Transform& tmp = m_transforms[entity.index];
+	const Transform old_transform = tmp;
 	tmp = transform;
 	
 	int hierarchy_idx = m_entities[entity.index].hierarchy;
-	const ArchetypeManager::Archetype& archetype = m_archetype_manager->get(m_entities[entity.index].archetype);
-	for (ComponentType type : archetype.types) {
-		m_component_type_map[type.index]->transformed.invoke(entity);
-	}
 	if (hierarchy_idx >= 0)
 	{
 		Hierarchy& h = m_hierarchy[hierarchy_idx];
@@ -327,15 +576,20 @@ void World::setTransformKeepChildren(EntityRef entity, const Transform& transfor
 		{
 			Hierarchy& child_h = m_hierarchy[m_entities[child.index].hierarchy];
 
-			child_h.local_transform = Transform::computeLocal(my_transform, getTransform((EntityRef)child));
+			// in deferred mode, children's global transforms are stale if `entity` is dirty
+			const Transform child_tr = m_deferred_transforms ? old_transform.compose(child_h.local_transform) : getTransform((EntityRef)child);
+			child_h.local_transform = Transform::computeLocal(my_transform, child_tr);
 			child = child_h.next_sibling;
 		}
 	}
+	if (m_deferred_transforms) markTransformDirty(entity);
+	else notifyTransformed(entity);
 }
 
 
 void World::setTransform(EntityRef entity, const Transform& transform)
 {
+	resolveTransform(entity);
 	Transform& tmp = m_transforms[entity.index];
 	tmp = transform;
 	transformEntity(entity, true);
@@ -344,6 +598,7 @@ void World::setTransform(EntityRef entity, const Transform& transform)
 
 void World::setTransform(EntityRef entity, const RigidTransform& transform)
 {
+	resolveTransform(entity);
 	auto& tmp = m_transforms[entity.index];
 	tmp.pos = transform.pos;
 	tmp.rot = transform.rot;
@@ -353,6 +608,7 @@ void World::setTransform(EntityRef entity, const RigidTransform& transform)
 
 void World::setTransform(EntityRef entity, const DVec3& pos, const Quat& rot, const Vec3& scale)
 {
+	resolveTransform(entity);
 	auto& tmp = m_transforms[entity.index];
 	tmp.pos = pos;
 	tmp.rot = rot;
@@ -379,6 +635,7 @@ Matrix World::getRelativeMatrix(EntityRef entity, const DVec3& base_pos) const
 
 void World::setPosition(EntityRef entity, const DVec3& pos)
 {
+	resolveTransform(entity);
 	m_transforms[entity.index].pos = pos;
 	transformEntity(entity, true);
 }
@@ -481,45 +738,104 @@ void World::emplaceEntity(EntityRef entity)
 	data.hierarchy = -1;
 	data.archetype = EMPTY_ARCHETYPE;
 	data.valid = true;
+	Array<EntityRef>& archetype_entities = m_archetype_manager->get(EMPTY_ARCHETYPE).entities;
+	data.archetype_slot = archetype_entities.size();
+	archetype_entities.push(entity);
 
 	m_entity_created.invoke(entity);
 }
 
 
+void World::allocateEntities(Span<EntityRef> entities) {
+	u32 i = 0;
+	for (; i < entities.length() && m_first_free_slot >= 0; ++i) {
+		EntityData& data = m_entities[m_first_free_slot];
+		entities[i] = {m_first_free_slot};
+		if (data.next >= 0) m_entities[data.next].prev = -1;
+		m_first_free_slot = data.next;
+	}
+
+	// free slots are exhausted, the rest is contiguous
+	const u32 first_new = m_entities.size();
+	const u32 new_count = entities.length() - i;
+	if (new_count > 0) {
+		m_entities.resize(first_new + new_count);
+		m_transforms.resize(first_new + new_count);
+		for (u32 j = 0; j < new_count; ++j) entities[i + j] = {i32(first_new + j)};
+	}
+
+	Array<EntityRef>& archetype_entities = m_archetype_manager->get(EMPTY_ARCHETYPE).entities;
+	archetype_entities.reserve(archetype_entities.size() + entities.length());
+	for (EntityRef entity : entities) {
+		EntityData& data = m_entities[entity.index];
+		Transform& tr = m_transforms[entity.index];
+		tr.pos = DVec3(0);
+		tr.rot = Quat::IDENTITY;
+		tr.scale = Vec3(1);
+		data.partition = m_active_partition;
+		data.name = -1;
+		data.hierarchy = -1;
+		data.archetype = EMPTY_ARCHETYPE;
+		data.valid = true;
+		data.archetype_slot = archetype_entities.size();
+		archetype_entities.push(entity);
+	}
+}
+
+
 EntityRef World::createEntity(const DVec3& position, const Quat& rotation)
 {
-	EntityData* data;
 	EntityRef entity;
-	Transform* tr;
-	if (m_first_free_slot >= 0)
-	{
-		data = &m_entities[m_first_free_slot];
-		tr = &m_transforms[m_first_free_slot];
-		entity.index = m_first_free_slot;
-		if (data->next >= 0) m_entities[data->next].prev = -1;
-		m_first_free_slot = data->next;
-	}
-	else
-	{
-		entity.index = m_entities.size();
-		data = &m_entities.emplace();
-		tr = &m_transforms.emplace();
-	}
-	tr->pos = position;
-	tr->rot = rotation;
-	tr->scale = Vec3(1);
-	data->partition = m_active_partition;
-	data->name = -1;
-	data->hierarchy = -1;
-	data->archetype = EMPTY_ARCHETYPE;
-	data->valid = true;
+	allocateEntities(Span(&entity, 1));
+	Transform& tr = m_transforms[entity.index];
+	tr.pos = position;
+	tr.rot = rotation;
 	m_entity_created.invoke(entity);
+	m_entities_created.invoke(Span(&entity, 1));
 
 	return entity;
 }
 
 
+void World::createEntities(Span<EntityRef> entities)
+{
+	PROFILE_FUNCTION();
+	allocateEntities(entities);
+	for (EntityRef e : entities) m_entity_created.invoke(e);
+	m_entities_created.invoke(entities);
+}
+
+
+void World::createComponents(ComponentType type, Span<const EntityRef> entities)
+{
+	PROFILE_FUNCTION();
+	IModule* module = m_component_type_map[type.index]->module;
+	if (!module->createComponents(type, entities)) {
+		auto& create_method = m_component_type_map[type.index]->create;
+		for (EntityRef e : entities) create_method(module, e);
+	}
+	m_components_added.invoke(type, entities);
+}
+
+
 void World::destroyEntity(EntityRef entity)
+{
+	releaseEntity(entity);
+	m_entity_destroyed.invoke(entity);
+	m_entities_destroyed.invoke(Span(&entity, 1));
+}
+
+
+void World::destroyEntities(Span<const EntityRef> entities)
+{
+	PROFILE_FUNCTION();
+	for (EntityRef e : entities) releaseEntity(e);
+	for (EntityRef e : entities) m_entity_destroyed.invoke(e);
+	m_entities_destroyed.invoke(entities);
+}
+
+
+void World::releaseEntity(EntityRef entity)
 {
 	EntityData& entity_data = m_entities[entity.index];
 	ASSERT(entity_data.valid);
@@ -534,6 +850,11 @@ void World::destroyEntity(EntityRef entity)
 		auto destroy_method = m_component_type_map[type.index]->destroy;
 		destroy_method(module, entity);
 	}
+	// all components should be destroyed by now, so entity is in the empty archetype
+	setArchetype(entity, EMPTY_ARCHETYPE);
+	Array<EntityRef>& archetype_entities = m_archetype_manager->get(EMPTY_ARCHETYPE).entities;
+	m_entities[archetype_entities.back().index].archetype_slot = entity_data.archetype_slot;
+	archetype_entities.swapAndPop(entity_data.archetype_slot);
 
 	entity_data.next = m_first_free_slot;
 	entity_data.prev = -1;
@@ -553,7 +874,6 @@ void World::destroyEntity(EntityRef entity)
 	}
 
 	m_first_free_slot = entity.index;
-	m_entity_destroyed.invoke(entity);
 }
 
 
@@ -621,6 +941,10 @@ void World::setParent(EntityPtr new_parent, EntityRef child)
 		return;
 	}
 
+	// in deferred mode, `child`'s subtree is not propagated by its old dirty ancestor anymore
+	const bool had_dirty_ancestor = resolveTransform(child);
+	if (new_parent.isValid()) resolveTransform((EntityRef)new_parent);
+
 	auto collectGarbage = [this](EntityRef entity) {
 		Hierarchy& h = m_hierarchy[m_entities[entity.index].hierarchy];
 		if (h.parent.isValid()) return;
@@ -694,6 +1018,7 @@ void World::setParent(EntityPtr new_parent, EntityRef child)
 	{
 		if (child_idx >= 0) collectGarbage(child);
 	}
+	if (had_dirty_ancestor) markTransformDirty(child);
 }
 
 
@@ -701,6 +1026,7 @@ void World::updateGlobalTransform(EntityRef entity)
 {
 	const Hierarchy& h = m_hierarchy[m_entities[entity.index].hierarchy];
 	ASSERT(h.parent.isValid());
+	resolveTransform((EntityRef)h.parent);
 	Transform parent_tr = getTransform((EntityRef)h.parent);
 	
 	Transform new_tr = parent_tr.compose(h.local_transform);
@@ -794,6 +1120,10 @@ static bool hasSerializedModules(World& world, InputMemoryStream& serializer) {
 	return true;
 }
 
+// blittable parts of world are aligned, so they can be used directly, e.g. from memory mapped file
+static void alignStream(OutputMemoryStream& blob) { blob.align(16); }
+static void alignStream(InputMemoryStream& blob) { blob.align(16); }
+
 #pragma pack(1)
 struct WorldEditorHeaderLegacy {
 	enum class Version : u32 {
@@ -837,7 +1167,189 @@ void World::serialize(OutputMemoryStream& serializer, WorldSerializeFlags flags)
 	serializeModuleList(*this, serializer);
 	serializer.write(flags);
 
+	const bool blittable = (u32)flags & (u32)WorldSerializeFlags::BLITTABLE;
 	OutputMemoryStream blob(m_allocator);
+	if (blittable) {
+		serializeBlittable(blob);
+	}
+	else {
+		serializeEntities(blob, serialize_partitions);
+	}
+
+	blob.write((i32)m_modules.size());
+	for (const UniquePtr<IModule>& module : m_modules) {
+		blob.writeString(module->getName());
+		blob.write(module->getVersion());
+		const u64 size_offset = blob.size();
+		blob.write((u32)0);
+		const u64 raw_offset = blob.size();
+		if (blittable) {
+			blob.write(false);
+			alignStream(blob);
+		}
+		const u64 module_start = blob.size();
+		if (blittable && module->serializeBlittable(blob)) {
+			blob.getMutableData()[raw_offset] = 1;
+		}
+		else {
+			// anything written by `serializeBlittable` which returned false is dropped
+			blob.resize(module_start);
+			module->serialize(blob);
+		}
+		const u32 module_size = u32(blob.size() - module_start);
+		memcpy(blob.getMutableData() + size_offset, &module_size, sizeof(module_size));
+	}
+
+	if (serialize_partitions) {
+		blob.write((u32)m_partitions.size());
+		blob.write(m_partitions.begin(), m_partitions.byte_size());
+		blob.write(m_active_partition);
+	}
+
+	if (blittable) {
+		serializer.write((u32)blob.size());
+		serializer.write((u32)blob.size());
+		alignStream(serializer);
+		serializer.write(blob.data(), blob.size());
+		return;
+	}
+
+	const u64 offset = serializer.size();
+	serializer.write((u32)blob.size()); // uncompressed size
+	serializer.write((u32)0); // compressed size, 0 == stored uncompressed
+	if (!m_engine.compressBlocks(blob, serializer)) {
+		// compressBlocks can fail after writing part of its output
+		serializer.resize(offset + sizeof(u32) * 2);
+		serializer.write(blob.data(), blob.size());
+		return;
+	}
+	u32* sizes = (u32*)(serializer.getMutableData() + offset);
+	sizes[1] = u32(serializer.size() - offset - sizeof(u32) * 2);
+}
+
+static const u32 SNAPSHOT_MAGIC = '_LSN';
+
+void World::takeSnapshot(OutputMemoryStream& snapshot) {
+	PROFILE_FUNCTION();
+	updateTransforms();
+	snapshot.clear();
+	snapshot.write(SNAPSHOT_MAGIC);
+	snapshot.write((u32)m_entities.size());
+	snapshot.write(m_first_free_slot);
+	snapshot.write(m_entities.begin(), m_entities.byte_size());
+	snapshot.write(m_transforms.begin(), m_transforms.byte_size());
+	snapshot.write((u32)m_hierarchy.size());
+	snapshot.write(m_hierarchy.begin(), m_hierarchy.byte_size());
+	snapshot.write((u32)m_names.size());
+	snapshot.write(m_names.begin(), m_names.byte_size());
+	snapshot.write((u32)m_partitions.size());
+	snapshot.write(m_partitions.begin(), m_partitions.byte_size());
+	snapshot.write(m_active_partition);
+
+	for (u32 i = 0, c = m_modules.size(); i < c; ++i) {
+		const u64 start = snapshot.size();
+		snapshot.write(i);
+		snapshot.write((u32)0);
+		if (!m_modules[i]->takeSnapshot(snapshot)) {
+			snapshot.resize(start);
+			continue;
+		}
+		const u32 size = u32(snapshot.size() - start - sizeof(u32) * 2);
+		memcpy(snapshot.getMutableData() + start + sizeof(u32), &size, sizeof(size));
+	}
+	snapshot.write(u32(-1));
+}
+
+bool World::restoreSnapshot(Span<const u8> snapshot) {
+	PROFILE_FUNCTION();
+	updateTransforms();
+	InputMemoryStream blob(snapshot);
+	if (blob.read<u32>() != SNAPSHOT_MAGIC) {
+		logError("Invalid world snapshot");
+		return false;
+	}
+
+	const u32 count = blob.read<u32>();
+	const i32 first_free_slot = blob.read<i32>();
+	const EntityData* entities = (const EntityData*)blob.skip(count * sizeof(EntityData));
+	const Transform* transforms = (const Transform*)blob.skip(count * sizeof(Transform));
+	const u32 hierarchy_count = blob.read<u32>();
+	const Hierarchy* hierarchy = (const Hierarchy*)blob.skip(hierarchy_count * sizeof(Hierarchy));
+	const u32 names_count = blob.read<u32>();
+	const EntityName* names = (const EntityName*)blob.skip(names_count * sizeof(EntityName));
+	const u32 partitions_count = blob.read<u32>();
+	const Partition* partitions = (const Partition*)blob.skip(partitions_count * sizeof(Partition));
+	const PartitionHandle active_partition = blob.read<PartitionHandle>();
+	if (blob.hasOverflow()) {
+		logError("Invalid world snapshot");
+		return false;
+	}
+
+	// destroy entities created since the snapshot, modules (even those without snapshots) clean up their components
+	Array<EntityRef> to_destroy(m_allocator);
+	for (i32 i = 0, c = m_entities.size(); i < c; ++i) {
+		if (m_entities[i].valid && (i >= (i32)count || !entities[i].valid)) to_destroy.push({i});
+	}
+	destroyEntities(to_destroy);
+
+	for (InputMemoryStream tmp = blob;;) {
+		const u32 module_idx = tmp.read<u32>();
+		if (module_idx == u32(-1) || tmp.hasOverflow()) break;
+		if (module_idx >= (u32)m_modules.size()) {
+			logError("Invalid world snapshot");
+			return false;
+		}
+		tmp.skip(tmp.read<u32>());
+	}
+
+	Array<EntityRef> revived(m_allocator);
+	Array<EntityRef> moved(m_allocator);
+	const u32 old_count = m_entities.size();
+	m_entities.resize(count);
+	m_transforms.resize(count);
+	for (u32 i = 0; i < count; ++i) {
+		EntityData& data = m_entities[i];
+		const bool was_valid = i < old_count && data.valid;
+		// components are kept, modules with snapshot support create and destroy them in `restoreSnapshot`
+		const ArchetypeHandle archetype = was_valid ? data.archetype : m_archetype_manager->fromMask(0);
+		const u64 tracked_transforms = i < old_count ? data.tracked_transforms : 0;
+		data = entities[i];
+		data.tracked_transforms = tracked_transforms;
+		if (!data.valid) continue;
+
+		const EntityRef e = {(i32)i};
+		data.archetype = archetype;
+		if (!was_valid) revived.push(e);
+		else if (memcmp(&m_transforms[i], &transforms[i], sizeof(Transform)) != 0) moved.push(e);
+	}
+	memcpy(m_transforms.begin(), transforms, count * sizeof(Transform));
+	m_first_free_slot = first_free_slot;
+	m_hierarchy.resize(hierarchy_count);
+	memcpy(m_hierarchy.begin(), hierarchy, hierarchy_count * sizeof(Hierarchy));
+	m_names.resize(names_count);
+	memcpy(m_names.begin(), names, names_count * sizeof(EntityName));
+	m_partitions.resize(partitions_count);
+	memcpy(m_partitions.begin(), partitions, partitions_count * sizeof(Partition));
+	m_active_partition = active_partition;
+	m_archetype_manager->rebuildEntityLists(m_entities);
+
+	for (EntityRef e : revived) m_entity_created.invoke(e);
+	m_entities_created.invoke(revived);
+
+	for (;;) {
+		const u32 module_idx = blob.read<u32>();
+		if (module_idx == u32(-1) || blob.hasOverflow()) break;
+		const u32 size = blob.read<u32>();
+		InputMemoryStream module_blob(blob.skip(size), size);
+		m_modules[module_idx]->restoreSnapshot(module_blob);
+	}
+
+	for (EntityRef e : revived) m_deferred_transforms ? markTransformDirty(e) : notifyTransformed(e);
+	for (EntityRef e : moved) m_deferred_transforms ? markTransformDirty(e) : notifyTransformed(e);
+	return true;
+}
+
+void World::serializeEntities(OutputMemoryStream& blob, bool serialize_partitions) {
 	blob.write((u32)m_entities.size());
 
 	for (u32 i = 0, c = m_entities.size(); i < c; ++i) {
@@ -869,27 +1381,168 @@ void World::serialize(OutputMemoryStream& serializer, WorldSerializeFlags flags)
 			blob.write(h.local_transform.scale);
 		}
 	}
+}
 
-	blob.write((i32)m_modules.size());
-	for (const UniquePtr<IModule>& module : m_modules) {
-		blob.writeString(module->getName());
-		blob.write(module->getVersion());
-		module->serialize(blob);
+// entity table as raw arrays, so it can be memcpy'd on load, layout depends on platform/compiler
+void World::serializeBlittable(OutputMemoryStream& blob) {
+	blob.write((u32)m_entities.size());
+	for (const EntityData& e : m_entities) blob.write((u8)e.valid);
+	for (const EntityData& e : m_entities) blob.write(e.valid ? e.partition : PartitionHandle(0));
+	alignStream(blob);
+	blob.write(m_transforms.begin(), m_transforms.byte_size());
+
+	blob.write((u32)m_names.size());
+	alignStream(blob);
+	blob.write(m_names.begin(), m_names.byte_size());
+
+	blob.write((u32)m_hierarchy.size());
+	alignStream(blob);
+	blob.write(m_hierarchy.begin(), m_hierarchy.byte_size());
+}
+
+void World::deserializeBlittable(InputMemoryStream& serializer, EntityMap& entity_map, bool deserialize_partitions) {
+	PROFILE_FUNCTION();
+	const u32 count = serializer.read<u32>();
+	const u8* valid = (const u8*)serializer.skip(count);
+	const PartitionHandle* partitions = (const PartitionHandle*)serializer.skip(count * sizeof(PartitionHandle));
+	alignStream(serializer);
+	const Transform* transforms = (const Transform*)serializer.skip(count * sizeof(Transform));
+	
+	u32 valid_count = 0;
+	for (u32 i = 0; i < count; ++i) valid_count += valid[i];
+
+	Array<EntityRef> new_entities(m_allocator);
+	new_entities.resize(valid_count);
+	entity_map.reserve(count);
+	if (m_entities.empty()) {
+		// fast path, entities keep their indices, transforms are copied at once
+		m_entities.resize(count);
+		m_transforms.resize(count);
+		memcpy(m_transforms.begin(), transforms, count * sizeof(Transform));
+		Array<EntityRef>& archetype_entities = m_archetype_manager->get(EMPTY_ARCHETYPE).entities;
+		archetype_entities.reserve(archetype_entities.size() + valid_count);
+		u32 new_idx = 0;
+		for (u32 i = 0; i < count; ++i) {
+			const EntityRef e = {(i32)i};
+			EntityData& data = m_entities[i];
+			data.name = -1;
+			data.hierarchy = -1;
+			if (!valid[i]) {
+				data.valid = false;
+				data.prev = -1;
+				data.next = m_first_free_slot;
+				if (m_first_free_slot >= 0) m_entities[m_first_free_slot].prev = i;
+				m_first_free_slot = i;
+				continue;
+			}
+			data.valid = true;
+			data.partition = deserialize_partitions ? partitions[i] : m_active_partition;
+			data.archetype = EMPTY_ARCHETYPE;
+			data.archetype_slot = archetype_entities.size();
+			archetype_entities.push(e);
+			entity_map.set(e, e);
+			new_entities[new_idx] = e;
+			++new_idx;
+		}
+	}
+	else {
+		allocateEntities(new_entities);
+		u32 new_idx = 0;
+		for (u32 i = 0; i < count; ++i) {
+			if (!valid[i]) continue;
+			const EntityRef e = new_entities[new_idx];
+			++new_idx;
+			entity_map.set(EntityRef{(i32)i}, e);
+			m_transforms[e.index] = transforms[i];
+			if (deserialize_partitions) m_entities[e.index].partition = partitions[i];
+		}
 	}
 
-	if (serialize_partitions) {
-		blob.write((u32)m_partitions.size());
-		blob.write(m_partitions.begin(), m_partitions.byte_size());
-		blob.write(m_active_partition);
+	const u32 names_count = serializer.read<u32>();
+	alignStream(serializer);
+	const u32 old_names_count = m_names.size();
+	m_names.resize(old_names_count + names_count);
+	memcpy(m_names.begin() + old_names_count, serializer.skip(names_count * sizeof(EntityName)), names_count * sizeof(EntityName));
+	for (u32 i = old_names_count, c = m_names.size(); i < c; ++i) {
+		EntityName& name = m_names[i];
+		name.entity = entity_map.get(name.entity);
+		m_entities[name.entity.index].name = i;
+	}
+
+	const u32 hierarchy_count = serializer.read<u32>();
+	alignStream(serializer);
+	const u32 old_hierarchy_count = m_hierarchy.size();
+	m_hierarchy.resize(old_hierarchy_count + hierarchy_count);
+	memcpy(m_hierarchy.begin() + old_hierarchy_count, serializer.skip(hierarchy_count * sizeof(Hierarchy)), hierarchy_count * sizeof(Hierarchy));
+	for (u32 i = old_hierarchy_count, c = m_hierarchy.size(); i < c; ++i) {
+		Hierarchy& h = m_hierarchy[i];
+		h.entity = entity_map.get(h.entity);
+		h.first_child = entity_map.get(h.first_child);
+		h.next_sibling = entity_map.get(h.next_sibling);
+		h.parent = entity_map.get(h.parent);
+		m_entities[h.entity.index].hierarchy = i;
+	}
+
+	for (EntityRef e : new_entities) m_entity_created.invoke(e);
+	m_entities_created.invoke(new_entities);
+}
+
+bool World::deserializeModules(InputMemoryStream& serializer, i32 module_count, const EntityMap& entity_map, bool blittable) {
+	PROFILE_FUNCTION();
+	struct ModuleBlob {
+		IModule* module;
+		i32 version;
+		const void* data;
+		u32 size;
+		// written by `IModule::serializeBlittable`
+		bool raw = false;
+	};
+
+	auto deserializeModule = [&](const ModuleBlob& blob){
+		PROFILE_BLOCK("deserialize module");
+		profiler::Scope module_scope(blob.module->getName());
+		InputMemoryStream module_serializer(blob.data, blob.size);
+		if (blob.raw) blob.module->deserializeBlittable(module_serializer, entity_map, blob.version);
+		else blob.module->deserialize(module_serializer, entity_map, blob.version);
+	};
+
+	// modules which can be deserialized in parallel depend only on entities and their own data, see `IModule::canDeserializeInParallel`
+	// so they are deserialized together before the rest, wherever they are in module order, the rest keeps module order
+	Array<ModuleBlob> parallel(m_allocator);
+	Array<ModuleBlob> serial(m_allocator);
+	for (i32 i = 0; i < module_count; ++i) {
+		ModuleBlob blob;
+		const char* module_name = serializer.readString();
+		blob.module = getModule(module_name);
+		serializer.read(blob.version);
+		serializer.read(blob.size);
+		if (blittable) {
+			serializer.read(blob.raw);
+			alignStream(serializer);
+		}
+		blob.data = serializer.skip(blob.size);
+		if (serializer.hasOverflow()) {
+			logError("End of file encountered while trying to read data");
+			return false;
+		}
+		// e.g. renderer on dedicated server, see `Engine::InitArgs::excluded_systems`
+		if (!blob.module) {
+			logInfo("Module ", module_name, " is not loaded, skipping its data");
+			continue;
+		}
+
+		if (blob.module->canDeserializeInParallel()) parallel.push(blob);
+		else serial.push(blob);
 	}
 
-	const u64 offset = serializer.size();
-	serializer.write((u32)0);
-	serializer.write((u32)0);
-	m_engine.compress(blob, serializer);
-	u32* sizes = (u32*)(serializer.getMutableData() + offset);
-	sizes[0] = (u32)blob.size(); // uncompressed size
-	sizes[1] = u32(serializer.size() - offset - sizeof(u32) * 2); // compressed size
+	m_parallel_deserialization = true;
+	jobs::forEach(parallel.size(), 1, [&](i32 idx, i32){
+		deserializeModule(parallel[idx]);
+	});
+	m_parallel_deserialization = false;
+
+	for (const ModuleBlob& blob : serial) deserializeModule(blob);
+	return true;
 }
 
 bool World::deserialize(InputMemoryStream& input, EntityMap& entity_map, WorldVersion& version)
@@ -929,95 +1582,157 @@ bool World::deserialize(InputMemoryStream& input, EntityMap& entity_map, WorldVe
 	if (!hasSerializedModules(*this, input)) return false;
 
 	bool deserialize_partitions = false;
+	bool blittable = false;
 	if (legacy_version > WorldHeaderLegacy::Version::FLAGS) {
 		WorldSerializeFlags flags;
 		input.read(flags);
 		deserialize_partitions = (u32)flags & (u32)WorldSerializeFlags::HAS_PARTITIONS;
+		blittable = (u32)flags & (u32)WorldSerializeFlags::BLITTABLE;
 	}
 
 	InputMemoryStream serializer(input.skip(0), input.remaining());
 	OutputMemoryStream uncompressed(m_allocator);
-	if (header.version > WorldVersion::COMPRESSED) { 
+	if (blittable) {
+		// not compressed, so it's used directly from `input`, which can be e.g. memory mapped file
+		const u32 size = input.read<u32>();
+		input.read<u32>();
+		alignStream(input);
+		serializer = InputMemoryStream(input.skip(0), size);
+		input.skip(size);
+	}
+	else if (header.version > WorldVersion::COMPRESSED) { 
 		u32 uncompressed_size;
 		u32 compressed_size;
 		input.read(uncompressed_size);
 		input.read(compressed_size);
-		uncompressed.resize(uncompressed_size);
-		m_engine.decompress(Span((const u8*)input.skip(0), compressed_size), Span(uncompressed.getMutableData(), uncompressed.size()));
-		serializer = InputMemoryStream(uncompressed);
-		input.skip(compressed_size);
-	}
-
-	u32 to_reserve;
-	serializer.read(to_reserve);
-	entity_map.reserve(to_reserve);
-
-	for (EntityPtr e = serializer.read<EntityPtr>(); e.isValid(); e = serializer.read<EntityPtr>()) {
-		EntityRef orig = (EntityRef)e;
-		const EntityRef new_e = createEntity({0, 0, 0}, {0, 0, 0, 1});
-		entity_map.set(orig, new_e);
-		Transform& tr = m_transforms[new_e.index];
-		serializer.read(tr.pos);
-		serializer.read(tr.rot);
-		if (legacy_version > WorldHeaderLegacy::Version::VEC3_SCALE) {
-			serializer.read(tr.scale);
+		if (compressed_size == 0 && header.version > WorldVersion::COMPRESSED_BLOCKS) {
+			// compression failed when saving, data is stored as is
+			serializer = InputMemoryStream(input.skip(0), uncompressed_size);
+			input.skip(uncompressed_size);
+			if (input.hasOverflow()) {
+				logError("Failed to read world");
+				return false;
+			}
 		}
 		else {
-			serializer.read(tr.scale.x);
-			float padding;
-			serializer.read(padding);
-			tr.scale.y = tr.scale.z = tr.scale.x;
+			uncompressed.resize(uncompressed_size);
+			const Span<const u8> compressed((const u8*)input.skip(0), compressed_size);
+			const Span<u8> output(uncompressed.getMutableData(), uncompressed.size());
+			const bool decompressed = header.version > WorldVersion::COMPRESSED_BLOCKS
+				? m_engine.decompressBlocks(compressed, output)
+				: m_engine.decompress(compressed, output);
+			if (!decompressed) {
+				logError("Failed to decompress world");
+				return false;
+			}
+			serializer = InputMemoryStream(uncompressed);
+			input.skip(compressed_size);
 		}
-		if (deserialize_partitions) serializer.read(m_entities[new_e.index].partition);
 	}
 
-	u32 count;
-	serializer.read(count);
-	for (u32 i = 0; i < count; ++i) {
-		EntityName& name = m_names.emplace();
-		serializer.read(name.entity);
-		name.entity = entity_map.get(name.entity);
-		copyString(name.name, serializer.readString());
-		m_entities[name.entity.index].name = m_names.size() - 1;
+	if (blittable) {
+		deserializeBlittable(serializer, entity_map, deserialize_partitions);
 	}
+	else {
+		u32 to_reserve;
+		serializer.read(to_reserve);
+		entity_map.reserve(to_reserve);
 
-	serializer.read(count);
-	const u32 old_count = m_hierarchy.size();
-	m_hierarchy.resize(count + old_count);
-	if (count > 0) {
-		for (u32 i = 0; i < count; ++i) {
-			Hierarchy& h = m_hierarchy[old_count + i];
-			serializer.read(h.entity);
-			serializer.read(h.parent);
-			serializer.read(h.first_child);
-			serializer.read(h.next_sibling);
-			serializer.read(h.local_transform.pos);
-			serializer.read(h.local_transform.rot);
+		// count entities first, so they can be created in one batch
+		const u32 entity_record_size = sizeof(EntityRef) + sizeof(DVec3) + sizeof(Quat)
+			+ (legacy_version > WorldHeaderLegacy::Version::VEC3_SCALE ? sizeof(Vec3) : sizeof(float) * 2)
+			+ (deserialize_partitions ? sizeof(PartitionHandle) : 0);
+		const u64 entities_pos = serializer.getPosition();
+		u32 entities_count = 0;
+		while (serializer.read<EntityPtr>().isValid()) {
+			serializer.skip(entity_record_size - sizeof(EntityRef));
+			++entities_count;
+		}
+		serializer.setPosition(entities_pos);
+		Array<EntityRef> new_entities(m_allocator);
+		new_entities.resize(entities_count);
+		allocateEntities(new_entities);
+
+		u32 entity_idx = 0;
+		for (EntityPtr e = serializer.read<EntityPtr>(); e.isValid(); e = serializer.read<EntityPtr>()) {
+			EntityRef orig = (EntityRef)e;
+			const EntityRef new_e = new_entities[entity_idx];
+			++entity_idx;
+			entity_map.set(orig, new_e);
+			Transform& tr = m_transforms[new_e.index];
+			serializer.read(tr.pos);
+			serializer.read(tr.rot);
 			if (legacy_version > WorldHeaderLegacy::Version::VEC3_SCALE) {
-				serializer.read(h.local_transform.scale);
+				serializer.read(tr.scale);
 			}
 			else {
-				serializer.read(h.local_transform.scale.x);
+				serializer.read(tr.scale.x);
 				float padding;
 				serializer.read(padding);
-				h.local_transform.scale.z = h.local_transform.scale.y = h.local_transform.scale.x;
+				tr.scale.y = tr.scale.z = tr.scale.x;
 			}
+			if (deserialize_partitions) serializer.read(m_entities[new_e.index].partition);
+		}
+		for (EntityRef e : new_entities) m_entity_created.invoke(e);
+		m_entities_created.invoke(new_entities);
 
-			h.entity = entity_map.get(h.entity);
-			h.first_child = entity_map.get(h.first_child);
-			h.next_sibling = entity_map.get(h.next_sibling);
-			h.parent = entity_map.get(h.parent);
-			m_entities[h.entity.index].hierarchy = i + old_count;
+		u32 count;
+		serializer.read(count);
+		for (u32 i = 0; i < count; ++i) {
+			EntityName& name = m_names.emplace();
+			serializer.read(name.entity);
+			name.entity = entity_map.get(name.entity);
+			copyString(name.name, serializer.readString());
+			m_entities[name.entity.index].name = m_names.size() - 1;
+		}
+
+		serializer.read(count);
+		const u32 old_count = m_hierarchy.size();
+		m_hierarchy.resize(count + old_count);
+		if (count > 0) {
+			for (u32 i = 0; i < count; ++i) {
+				Hierarchy& h = m_hierarchy[old_count + i];
+				serializer.read(h.entity);
+				serializer.read(h.parent);
+				serializer.read(h.first_child);
+				serializer.read(h.next_sibling);
+				serializer.read(h.local_transform.pos);
+				serializer.read(h.local_transform.rot);
+				if (legacy_version > WorldHeaderLegacy::Version::VEC3_SCALE) {
+					serializer.read(h.local_transform.scale);
+				}
+				else {
+					serializer.read(h.local_transform.scale.x);
+					float padding;
+					serializer.read(padding);
+					h.local_transform.scale.z = h.local_transform.scale.y = h.local_transform.scale.x;
+				}
+
+				h.entity = entity_map.get(h.entity);
+				h.first_child = entity_map.get(h.first_child);
+				h.next_sibling = entity_map.get(h.next_sibling);
+				h.parent = entity_map.get(h.parent);
+				m_entities[h.entity.index].hierarchy = i + old_count;
+			}
 		}
 	}
 
 	i32 module_count;
 	serializer.read(module_count);
-	for (int i = 0; i < module_count; ++i) {
-		const char* tmp = serializer.readString();
-		IModule* module = getModule(tmp);
-		const i32 version = serializer.read<i32>();
-		module->deserialize(serializer, entity_map, version);
+	if (header.version > WorldVersion::MODULE_BLOBS) {
+		if (!deserializeModules(serializer, module_count, entity_map, blittable)) return false;
+	}
+	else {
+		for (int i = 0; i < module_count; ++i) {
+			const char* tmp = serializer.readString();
+			IModule* module = getModule(tmp);
+			if (!module) {
+				logError("Module ", tmp, " is not loaded");
+				return false;
+			}
+			const i32 version = serializer.read<i32>();
+			module->deserialize(serializer, entity_map, version);
+		}
 	}
 
 	if (deserialize_partitions) {
@@ -1040,6 +1755,7 @@ bool World::deserialize(InputMemoryStream& input, EntityMap& entity_map, WorldVe
 
 void World::setScale(EntityRef entity, const Vec3& scale)
 {
+	resolveTransform(entity);
 	m_transforms[entity.index].scale = scale;
 	transformEntity(entity, true);
 }
@@ -1069,20 +1785,12 @@ bool World::hasComponent(EntityRef entity, ComponentType component_type) const
 
 
 void World::onComponentDestroyed(EntityRef entity, ComponentType component_type, IModule* module) {
-	ComponentType tmp[64];
+	if (m_parallel_deserialization) jobs::enter(&m_components_mutex);
 	const ArchetypeHandle archetype = m_entities[entity.index].archetype;
-	const ArchetypeManager::Archetype& a = m_archetype_manager->get(archetype);
-	ASSERT(a.types.size() <= (i32)lengthOf(tmp));
-	u32 count = 0;
-	for (ComponentType t : a.types) {
-		if (t == component_type) continue;
-		tmp[count] = t;
-		++count;
-	}
-
-	m_entities[entity.index].archetype = m_archetype_manager->get(Span(tmp, count));
+	setArchetype(entity, m_archetype_manager->removeComponent(archetype, component_type));
 
 	m_component_destroyed.invoke(ComponentUID(entity, component_type, module));
+	if (m_parallel_deserialization) jobs::exit(&m_components_mutex);
 }
 
 
@@ -1104,23 +1812,14 @@ void World::destroyComponent(EntityRef entity, ComponentType type)
 
 void World::onComponentCreated(EntityRef entity, ComponentType component_type, IModule* module)
 {
-	ComponentType tmp[64];
+	// modules can be deserialized in parallel, see `deserializeModules`
+	if (m_parallel_deserialization) jobs::enter(&m_components_mutex);
 	const ArchetypeHandle archetype = m_entities[entity.index].archetype;
-	const ArchetypeManager::Archetype& a = m_archetype_manager->get(archetype);
-	ASSERT(a.types.size() + 1 <= (i32)lengthOf(tmp));
-	u32 count = 0;
-	for (ComponentType t : a.types) {
-		if (t == component_type) continue;
-		tmp[count] = t;
-		++count;
-	}
-	tmp[count] = component_type;
-	++count;
-
-	m_entities[entity.index].archetype = m_archetype_manager->get(Span(tmp, count));
+	setArchetype(entity, m_archetype_manager->addComponent(archetype, component_type));
 
 	ComponentUID cmp(entity, component_type, module);
 	m_component_added.invoke(cmp);
+	if (m_parallel_deserialization) jobs::exit(&m_components_mutex);
 }
 
 ChildrenRange World::childrenOf(EntityRef entity) const {
@@ -4,6 +4,7 @@
 
 #include "core/array.h"
 #include "core/delegate_list.h"
+#include "core/job_system.h"
 #include "core/math.h"
 #include "core/tag_allocator.h"
 
@@ -21,12 +22,18 @@ enum class WorldVersion : u32 {
 	NEW_ENTITY_FOLDERS,
 	MERGED_HEADERS,
 	COMPRESSED,
+	MODULE_BLOBS, // size of each module's data is stored, so modules can be deserialized in parallel
+	COMPRESSED_BLOCKS, // `Engine::compressBlocks` instead of `Engine::compress`
 
 	LATEST
 };
 
 enum class WorldSerializeFlags : u32 { 
 	HAS_PARTITIONS = 1 << 0,
+	// uncompressed, entity table stored as raw aligned arrays and module data aligned, for fast loading
+	// raw arrays depend on memory layout, so such worlds must be loaded by the same build configuration, e.g. editor's game mode save
+	// modules can store raw arrays too, see `IModule::serializeBlittable`
+	BLITTABLE = 1 << 1,
 
 	NONE = 0
 };
@@ -67,12 +74,26 @@ struct LUMIX_ENGINE_API World {
 	EntityRef createEntity(const DVec3& position, const Quat& rotation);
 	void destroyEntity(EntityRef entity);
 	void createComponent(ComponentType type, EntityRef entity);
+	// batched versions, events are invoked once all entities/components in batch are created/destroyed
+	// created entities are at origin with identity rotation, free slots are reused first and the rest have contiguous indices
+	void createEntities(Span<EntityRef> entities);
+	void destroyEntities(Span<const EntityRef> entities);
+	// uses `IModule::createComponents` if module supports it for `type`, otherwise creates components one by one
+	void createComponents(ComponentType type, Span<const EntityRef> entities);
 	void destroyComponent(EntityRef entity, ComponentType type);
 	void onComponentCreated(EntityRef entity, ComponentType component_type, IModule* module);
 	void onComponentDestroyed(EntityRef entity, ComponentType component_type, IModule* module);
 	bool hasComponent(EntityRef entity, ComponentType component_type) const;
 	Span<const ComponentType> getComponents(EntityRef entity) const;
 
+	// archetype is a unique set of component types, every entity belongs to exactly one archetype
+	// archetypes are never destroyed, so handles are in range [0, getArchetypesCount())
+	// see `EntityQuery` for more convenient way to iterate entities with certain components
+	u32 getArchetypesCount() const;
+	// bit `ComponentType::index` is set for every component type in archetype
+	u64 getArchetypeMask(ArchetypeHandle archetype) const;
+	Span<const EntityRef> getArchetypeEntities(ArchetypeHandle archetype) const;
+
 	PartitionHandle createPartition(const char* name);
 	void destroyPartition(PartitionHandle partition);
 	void setActivePartition(PartitionHandle partition);
@@ -118,10 +139,37 @@ struct LUMIX_ENGINE_API World {
 
 	DelegateList<void(EntityRef)>& entityCreated() { return m_entity_created; }
 	DelegateList<void(EntityRef)>& entityDestroyed() { return m_entity_destroyed; }
+	// invoked once per batch, after the per-entity/per-component events
+	DelegateList<void(Span<const EntityRef>)>& entitiesCreated() { return m_entities_created; }
+	DelegateList<void(Span<const EntityRef>)>& entitiesDestroyed() { return m_entities_destroyed; }
+	DelegateList<void(ComponentType, Span<const EntityRef>)>& componentsAdded() { return m_components_added; }
 	DelegateList<void(const ComponentUID&)>& componentDestroyed() { return m_component_destroyed; }
 	DelegateList<void(const ComponentUID&)>& componentAdded() { return m_component_added; }
 	DelegateList<void(EntityRef)>& componentTransformed(ComponentType type);
 
+	// per-frame change tracking, alternative to the callbacks above
+	// once enabled, every entity with component `type` is recorded (once) when it's transformed
+	// module then processes all of them in one pass, e.g. in `update`, and calls `clearTransformedEntities`
+	// recorded entity can be destroyed or lose the component before it's processed
+	void enableTransformTracking(ComponentType type, bool enable);
+	Span<const EntityRef> getTransformedEntities(ComponentType type) const;
+	void clearTransformedEntities(ComponentType type);
+
+	// in deferred mode, transform setters change only the entity itself (and its local transform) and mark it dirty,
+	// children and transform listeners are updated in `updateTransforms`, which engine calls once per frame
+	// global transforms of descendants of moved entities are stale until then, setters resolve them before they write
+	void setDeferredTransforms(bool enable);
+	bool areTransformsDeferred() const { return m_deferred_transforms; }
+	// propagates transforms of dirty entities to their descendants and notifies listeners, independent subtrees in parallel
+	void updateTransforms();
+
+	// fast raw copy of entity tables and state of modules implementing `IModule::takeSnapshot`, for rollback and replays
+	// reuse the same `snapshot` stream, so memory is allocated only the first time
+	void takeSnapshot(struct OutputMemoryStream& snapshot);
+	// entities are not recreated, those created since the snapshot are destroyed and destroyed ones come back to life
+	// components of modules without snapshot support are not restored, revived entities do not have them
+	[[nodiscard]] bool restoreSnapshot(Span<const u8> snapshot);
+
 	void serialize(struct OutputMemoryStream& serializer, WorldSerializeFlags flags);
 	[[nodiscard]] bool deserialize(struct InputMemoryStream& serializer, EntityMap& entity_map, WorldVersion& version);
 
@@ -129,16 +177,37 @@ struct LUMIX_ENGINE_API World {
 	IModule* getModule(const char* name) const;
 	Array<UniquePtr<IModule>>& getModules();
 	void addModule(UniquePtr<IModule>&& moudle);
+	struct UpdateValidation {
+		const IModule* module = nullptr;
+		const struct ModuleUpdateAccess* access = nullptr;
+		bool reported = false;
+	};
+	// debug builds check that module updated by current job accesses only what it declared in `IModule::getUpdateAccess`
+	// `validation` must live until it's unset, nullptr stops the checks
+	static void setUpdateValidation(UpdateValidation* validation);
 
 private:
 	void transformEntity(EntityRef entity, bool update_local);
 	void updateGlobalTransform(EntityRef entity);
+	void setArchetype(EntityRef entity, ArchetypeHandle archetype);
+	void allocateEntities(Span<EntityRef> entities);
+	void releaseEntity(EntityRef entity);
+	void notifyTransformed(EntityRef entity);
+	bool deserializeModules(struct InputMemoryStream& serializer, i32 module_count, const EntityMap& entity_map, bool blittable);
+	void serializeEntities(struct OutputMemoryStream& blob, bool serialize_partitions);
+	void serializeBlittable(struct OutputMemoryStream& blob);
+	void deserializeBlittable(struct InputMemoryStream& serializer, EntityMap& entity_map, bool deserialize_partitions);
+	void propagateTransform(EntityRef entity, Array<EntityRef>& transformed);
+	bool hasDirtyAncestor(EntityRef entity) const;
+	bool resolveTransform(EntityRef entity);
+	void markTransformDirty(EntityRef entity);
 
 	struct EntityData {
 		EntityData() {}
 
 		i32 hierarchy; // index into m_hierarchy, < 0 if no hierarchy (== no parent & no children) 
 		i32 name; // index into m_names, < 0 if no name
+		u32 archetype_slot; // index of entity in its archetype's list of entities
 
 		union {
 			struct {
@@ -152,6 +221,8 @@ private:
 			};
 		};
 		bool valid = false;
+		bool transform_dirty = false; // in m_dirty_transforms
+		u64 tracked_transforms = 0; // bit `ComponentType::index` is set if entity is in that type's `tracked_transforms`
 	};
 
 	struct Hierarchy {
@@ -169,11 +240,16 @@ private:
 	};
 
 	struct ComponentTypeEntry {
-		ComponentTypeEntry(IAllocator& allocator) : transformed(allocator) {}
+		ComponentTypeEntry(IAllocator& allocator)
+			: transformed(allocator)
+			, tracked_transforms(allocator)
+		{}
 		IModule* module = nullptr;
 		void (*create)(IModule*, EntityRef);
 		void (*destroy)(IModule*, EntityRef);
 		DelegateList<void(EntityRef)> transformed;
+		bool track_transforms = false;
+		Array<EntityRef> tracked_transforms;
 	};
 
 
@@ -203,11 +279,66 @@ private:
 	DelegateList<void(EntityRef)> m_entity_destroyed;
 	DelegateList<void(const ComponentUID&)> m_component_destroyed;
 	DelegateList<void(const ComponentUID&)> m_component_added;
+	DelegateList<void(Span<const EntityRef>)> m_entities_created;
+	DelegateList<void(Span<const EntityRef>)> m_entities_destroyed;
+	DelegateList<void(ComponentType, Span<const EntityRef>)> m_components_added;
 	
 	// freelist for m_entities/m_transforms
 	int m_first_free_slot;
+	bool m_deferred_transforms = false;
+	// set while modules are deserialized in parallel, component events are then guarded by m_components_mutex
+	bool m_parallel_deserialization = false;
+	jobs::Mutex m_components_mutex;
+	Array<EntityRef> m_dirty_transforms;
 };
 
+// iterates entities which have all `with` components and none of `without` components
+// matching archetypes are cached, archetypes created since the last iteration are matched at the start of the next one
+// components must not be added to or removed from iterated entities during iteration
+// example: EntityQuery query(world, {types::model_instance, types::rigid_actor}); query.forEach([](EntityRef e){ ... });
+struct LUMIX_ENGINE_API EntityQuery {
+	EntityQuery(World& world, Span<const ComponentType> with, Span<const ComponentType> without = {});
+
+	// `f(Span<const EntityRef>)` is called for every matching archetype with at least one entity
+	template <typename F> void forEachChunk(const F& f);
+	// `f(EntityRef)` is called for every matching entity
+	template <typename F> void forEach(const F& f);
+	// `f(Span<const EntityRef>)` is called in parallel on chunks of at most `step` entities
+	template <typename F> void forEachParallel(u32 step, const F& f);
+	u32 count();
+
+private:
+	void update();
+
+	World& m_world;
+	u64 m_with = 0;
+	u64 m_without = 0;
+	u32 m_checked_archetypes = 0;
+	Array<World::ArchetypeHandle> m_archetypes;
+};
+
+template <typename F> void EntityQuery::forEachChunk(const F& f) {
+	update();
+	for (World::ArchetypeHandle archetype : m_archetypes) {
+		Span<const EntityRef> entities = m_world.getArchetypeEntities(archetype);
+		if (entities.length() > 0) f(entities);
+	}
+}
+
+template <typename F> void EntityQuery::forEach(const F& f) {
+	forEachChunk([&](Span<const EntityRef> entities){
+		for (EntityRef e : entities) f(e);
+	});
+}
+
+template <typename F> void EntityQuery::forEachParallel(u32 step, const F& f) {
+	forEachChunk([&](Span<const EntityRef> entities){
+		jobs::forEach(entities.length(), step, [&](u32 from, u32 to){
+			f(Span(entities.begin() + from, entities.begin() + to));
+		});
+	});
+}
+
 // to iterate children with range-based for loop: for (EntityRef child : world->childrenOf(parent))
 struct LUMIX_ENGINE_API ChildrenRange {
 	struct LUMIX_ENGINE_API Iterator {
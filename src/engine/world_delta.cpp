@@ -0,0 +1,448 @@
+#include "world_delta.h"
+#include "core/crt.h"
+#include "core/log.h"
+#include "core/path.h"
+#include "core/profiler.h"
+#include "engine/plugin.h"
+#include "engine/reflection.h"
+#include "engine/world.h"
+
+
+namespace Lumix
+{
+
+static constexpr u32 DELTA_MAGIC = '_LWD';
+// positions are quantized to 1/1024 units
+static constexpr double POSITION_PRECISION = 1024;
+
+enum RecordFlags : u8 {
+	CREATED = 1 << 0,
+	DESTROYED = 1 << 1,
+	POSITION = 1 << 2,
+	ROTATION = 1 << 3,
+	SCALE = 1 << 4,
+	COMPONENTS = 1 << 5,
+	PROPERTIES = 1 << 6
+};
+
+static void writeVarint(OutputMemoryStream& stream, u64 value) {
+	u8 tmp[10];
+	u32 size = 0;
+	while (value >= 0x80) {
+		tmp[size++] = u8(value | 0x80);
+		value >>= 7;
+	}
+	tmp[size++] = u8(value);
+	stream.write(tmp, size);
+}
+
+static u64 readVarint(InputMemoryStream& stream) {
+	u64 value = 0;
+	for (u32 shift = 0; shift < 64; shift += 7) {
+		u8 byte = 0;
+		if (!stream.read(byte)) return value;
+		value |= u64(byte & 0x7f) << shift;
+		if ((byte & 0x80) == 0) break;
+	}
+	return value;
+}
+
+static u64 zigzag(i64 value) { return (u64(value) << 1) ^ u64(value >> 63); }
+static i64 unzigzag(u64 value) { return i64(value >> 1) ^ -i64(value & 1); }
+
+static i64 quantizePosition(double value) { return (i64)floor(value * POSITION_PRECISION + 0.5); }
+static double dequantizePosition(i64 value) { return value / POSITION_PRECISION; }
+
+// smallest three - the largest component is dropped and reconstructed from the others, which are in [-1/sqrt(2), 1/sqrt(2)]
+static void quantizeRotation(const Quat& rot, u16* out, u8& largest) {
+	const float c[] = { rot.x, rot.y, rot.z, rot.w };
+	largest = 0;
+	for (u8 i = 1; i < 4; ++i) {
+		if (fabsf(c[i]) > fabsf(c[largest])) largest = i;
+	}
+	const float sign = c[largest] < 0 ? -1.f : 1.f;
+	u32 j = 0;
+	for (u32 i = 0; i < 4; ++i) {
+		if (i == largest) continue;
+		const float v = clamp(c[i] * sign * SQRT2 * 0.5f + 0.5f, 0.f, 1.f);
+		out[j++] = u16(v * 0xffff + 0.5f);
+	}
+}
+
+static Quat dequantizeRotation(const u16* rot, u8 largest) {
+	float c[4];
+	float sum = 0;
+	u32 j = 0;
+	for (u32 i = 0; i < 4; ++i) {
+		if (i == largest) continue;
+		c[i] = (rot[j++] / float(0xffff) * 2 - 1) / SQRT2;
+		sum += c[i] * c[i];
+	}
+	c[largest] = sqrtf(maximum(0.f, 1 - sum));
+	return Quat(c[0], c[1], c[2], c[3]);
+}
+
+namespace {
+
+struct PropertyWriter : reflection::IPropertyVisitor {
+	PropertyWriter(OutputMemoryStream& stream, ComponentUID cmp) : stream(stream), cmp(cmp) {}
+
+	template <typename T>
+	void write(const reflection::Property<T>& prop) {
+		if (prop.isReadonly()) return;
+		stream.write(prop.get(cmp, idx));
+	}
+
+	void visit(const reflection::Property<float>& prop) override { write(prop); }
+	void visit(const reflection::Property<int>& prop) override { write(prop); }
+	void visit(const reflection::Property<u32>& prop) override { write(prop); }
+	void visit(const reflection::Property<EntityPtr>& prop) override { write(prop); }
+	void visit(const reflection::Property<Vec2>& prop) override { write(prop); }
+	void visit(const reflection::Property<Vec3>& prop) override { write(prop); }
+	void visit(const reflection::Property<IVec3>& prop) override { write(prop); }
+	void visit(const reflection::Property<Vec4>& prop) override { write(prop); }
+	void visit(const reflection::Property<bool>& prop) override { write(prop); }
+
+	void visit(const reflection::Property<Path>& prop) override {
+		if (prop.isReadonly()) return;
+		stream.writeString(prop.get(cmp, idx));
+	}
+
+	void visit(const reflection::Property<const char*>& prop) override {
+		if (prop.isReadonly()) return;
+		stream.writeString(prop.get(cmp, idx));
+	}
+
+	void visit(const reflection::BlobProperty& prop) override {
+		if (!prop.setter) return;
+		prop.getValue(cmp, idx, stream);
+	}
+
+	void visit(const reflection::ArrayProperty& prop) override {
+		const u32 count = prop.getCount(cmp);
+		stream.write(count);
+		const i32 idx_backup = idx;
+		for (u32 i = 0; i < count; ++i) {
+			idx = i;
+			prop.visitChildren(*this);
+		}
+		idx = idx_backup;
+	}
+
+	OutputMemoryStream& stream;
+	ComponentUID cmp;
+	i32 idx = -1;
+};
+
+struct PropertyReader : reflection::IPropertyVisitor {
+	PropertyReader(InputMemoryStream& stream, ComponentUID cmp) : stream(stream), cmp(cmp) {}
+
+	template <typename T>
+	void read(const reflection::Property<T>& prop) {
+		if (prop.isReadonly()) return;
+		prop.set(cmp, idx, stream.read<T>());
+	}
+
+	void visit(const reflection::Property<float>& prop) override { read(prop); }
+	void visit(const reflection::Property<int>& prop) override { read(prop); }
+	void visit(const reflection::Property<u32>& prop) override { read(prop); }
+	void visit(const reflection::Property<EntityPtr>& prop) override { read(prop); }
+	void visit(const reflection::Property<Vec2>& prop) override { read(prop); }
+	void visit(const reflection::Property<Vec3>& prop) override { read(prop); }
+	void visit(const reflection::Property<IVec3>& prop) override { read(prop); }
+	void visit(const reflection::Property<Vec4>& prop) override { read(prop); }
+	void visit(const reflection::Property<bool>& prop) override { read(prop); }
+
+	void visit(const reflection::Property<Path>& prop) override {
+		if (prop.isReadonly()) return;
+		prop.set(cmp, idx, Path(stream.readString()));
+	}
+
+	void visit(const reflection::Property<const char*>& prop) override {
+		if (prop.isReadonly()) return;
+		prop.set(cmp, idx, stream.readString());
+	}
+
+	void visit(const reflection::BlobProperty& prop) override {
+		if (!prop.setter) return;
+		prop.setValue(cmp, idx, stream);
+	}
+
+	void visit(const reflection::ArrayProperty& prop) override {
+		const u32 count = stream.read<u32>();
+		while (prop.getCount(cmp) > count) prop.removeItem(cmp, prop.getCount(cmp) - 1);
+		while (prop.getCount(cmp) < count) prop.addItem(cmp, -1);
+		const i32 idx_backup = idx;
+		for (u32 i = 0; i < count; ++i) {
+			idx = i;
+			prop.visitChildren(*this);
+		}
+		idx = idx_backup;
+	}
+
+	InputMemoryStream& stream;
+	ComponentUID cmp;
+	i32 idx = -1;
+};
+
+} // anonymous namespace
+
+// entity's properties are stored as u32 size + data for each of its components, in component type order
+static Span<const u8> getComponentProperties(const OutputMemoryStream& props, u32 offset, u32 size, u64 components, u32 type_index) {
+	if (size == 0) return {};
+	InputMemoryStream blob(props.data() + offset, size);
+	for (u32 i = 0; i < ComponentType::MAX_TYPES_COUNT; ++i) {
+		if ((components & (u64(1) << i)) == 0) continue;
+		const u32 cmp_size = blob.read<u32>();
+		const u8* data = (const u8*)blob.skip(cmp_size);
+		if (i == type_index) return Span(data, cmp_size);
+	}
+	return {};
+}
+
+void writeComponentProperties(const ComponentUID& cmp, OutputMemoryStream& blob) {
+	const reflection::ComponentBase* cmp_base = reflection::getComponent(cmp.type);
+	if (!cmp_base) return;
+	PropertyWriter writer(blob, cmp);
+	cmp_base->visit(writer);
+}
+
+WorldDeltaEncoder::WorldDeltaEncoder(IAllocator& allocator)
+	: m_allocator(allocator)
+	, m_states(allocator)
+	, m_new_states(allocator)
+	, m_props(allocator)
+	, m_new_props(allocator)
+{}
+
+void WorldDeltaEncoder::reset() {
+	m_states.clear();
+	m_props.clear();
+}
+
+void WorldDeltaEncoder::capture(World& world, bool properties) {
+	PROFILE_FUNCTION();
+	m_new_states.clear();
+	m_new_props.clear();
+	for (EntityPtr e = world.getFirstEntity(); e.isValid(); e = world.getNextEntity(*e)) {
+		const EntityRef entity = *e;
+		while (m_new_states.size() <= entity.index) m_new_states.emplace();
+
+		EntityState& state = m_new_states[entity.index];
+		const Transform& tr = world.getTransform(entity);
+		state.valid = true;
+		state.pos[0] = quantizePosition(tr.pos.x);
+		state.pos[1] = quantizePosition(tr.pos.y);
+		state.pos[2] = quantizePosition(tr.pos.z);
+		quantizeRotation(tr.rot, state.rot, state.rot_largest);
+		state.scale = tr.scale;
+		state.components = 0;
+		state.props_offset = (u32)m_new_props.size();
+
+		for (ComponentType type : world.getComponents(entity)) {
+			state.components |= u64(1) << type.index;
+			if (!properties) continue;
+
+			const u64 size_offset = m_new_props.size();
+			m_new_props.write(u32(0));
+			writeComponentProperties(ComponentUID(entity, type, world.getModule(type)), m_new_props);
+			const u32 size = u32(m_new_props.size() - size_offset - sizeof(u32));
+			memcpy(m_new_props.getMutableData() + size_offset, &size, sizeof(size));
+		}
+		state.props_size = u32(m_new_props.size() - state.props_offset);
+	}
+}
+
+void WorldDeltaEncoder::encode(World& world, OutputMemoryStream& delta, bool properties) {
+	PROFILE_FUNCTION();
+	capture(world, properties);
+
+	delta.write(DELTA_MAGIC);
+	const u64 count_offset = delta.size();
+	delta.write(u32(0));
+
+	const EntityState invalid = {};
+	const i32 size = maximum(m_states.size(), m_new_states.size());
+	i32 prev_index = -1;
+	u32 count = 0;
+	for (i32 i = 0; i < size; ++i) {
+		const EntityState& old_state = i < (i32)m_states.size() ? m_states[i] : invalid;
+		const EntityState& new_state = i < (i32)m_new_states.size() ? m_new_states[i] : invalid;
+		if (!old_state.valid && !new_state.valid) continue;
+
+		u8 flags = 0;
+		u64 changed_components = 0;
+		u32 changed_size = 0;
+		if (!new_state.valid) {
+			flags = DESTROYED;
+		}
+		else {
+			if (!old_state.valid) {
+				flags = CREATED | POSITION | ROTATION | SCALE | COMPONENTS;
+			}
+			else {
+				if (memcmp(old_state.pos, new_state.pos, sizeof(new_state.pos)) != 0) flags |= POSITION;
+				if (old_state.rot_largest != new_state.rot_largest || memcmp(old_state.rot, new_state.rot, sizeof(new_state.rot)) != 0) flags |= ROTATION;
+				if (old_state.scale != new_state.scale) flags |= SCALE;
+				if (old_state.components != new_state.components) flags |= COMPONENTS;
+			}
+
+			for (u32 type_idx = 0; type_idx < ComponentType::MAX_TYPES_COUNT && new_state.props_size > 0; ++type_idx) {
+				if ((new_state.components & (u64(1) << type_idx)) == 0) continue;
+				const Span<const u8> new_props = getComponentProperties(m_new_props, new_state.props_offset, new_state.props_size, new_state.components, type_idx);
+				if (new_props.length() == 0) continue;
+				if (old_state.valid && (old_state.components & (u64(1) << type_idx))) {
+					const Span<const u8> old_props = getComponentProperties(m_props, old_state.props_offset, old_state.props_size, old_state.components, type_idx);
+					if (old_props.length() == new_props.length() && memcmp(old_props.begin(), new_props.begin(), new_props.length()) == 0) continue;
+				}
+				changed_components |= u64(1) << type_idx;
+				changed_size += sizeof(u32) + new_props.length();
+			}
+			if (changed_components) flags |= PROPERTIES;
+		}
+		if (flags == 0) continue;
+
+		writeVarint(delta, u64(i - prev_index - 1));
+		delta.write(flags);
+		prev_index = i;
+		++count;
+
+		if (flags & POSITION) {
+			for (i64 v : new_state.pos) writeVarint(delta, zigzag(v));
+		}
+		if (flags & ROTATION) {
+			delta.write(new_state.rot_largest);
+			delta.write(new_state.rot, sizeof(new_state.rot));
+		}
+		if (flags & SCALE) delta.write(new_state.scale);
+		if (flags & COMPONENTS) writeVarint(delta, new_state.components);
+		if (flags & PROPERTIES) {
+			writeVarint(delta, changed_components);
+			writeVarint(delta, changed_size);
+			for (u32 type_idx = 0; type_idx < ComponentType::MAX_TYPES_COUNT; ++type_idx) {
+				if ((changed_components & (u64(1) << type_idx)) == 0) continue;
+				const Span<const u8> props = getComponentProperties(m_new_props, new_state.props_offset, new_state.props_size, new_state.components, type_idx);
+				delta.write(props.length());
+				delta.write(props.begin(), props.length());
+			}
+		}
+	}
+	memcpy(delta.getMutableData() + count_offset, &count, sizeof(count));
+
+	m_states.swap(m_new_states);
+	OutputMemoryStream tmp(static_cast<OutputMemoryStream&&>(m_props));
+	m_props = static_cast<OutputMemoryStream&&>(m_new_props);
+	m_new_props = static_cast<OutputMemoryStream&&>(tmp);
+}
+
+bool applyWorldDelta(World& world, InputMemoryStream& delta) {
+	PROFILE_FUNCTION();
+	if (delta.read<u32>() != DELTA_MAGIC) {
+		logError("Invalid world delta");
+		return false;
+	}
+
+	struct PendingProperties {
+		EntityRef entity;
+		u64 components;
+		u64 offset;
+	};
+	Array<PendingProperties> pending(world.getAllocator());
+
+	// properties are set after all entities are created, since they can reference entities later in the delta
+	const u32 count = delta.read<u32>();
+	i32 index = -1;
+	for (u32 i = 0; i < count; ++i) {
+		index += i32(readVarint(delta)) + 1;
+		const EntityRef entity = { index };
+		const u8 flags = delta.read<u8>();
+
+		if (flags & DESTROYED) {
+			if (world.hasEntity(entity)) world.destroyEntity(entity);
+			continue;
+		}
+
+		if (flags & CREATED) {
+			if (world.hasEntity(entity)) {
+				logError("World delta creates entity ", index, " which already exists");
+				return false;
+			}
+			world.emplaceEntity(entity);
+		}
+		else if (!world.hasEntity(entity)) {
+			logError("World delta modifies entity ", index, " which does not exist");
+			return false;
+		}
+
+		if (flags & (POSITION | ROTATION | SCALE)) {
+			Transform tr = world.getTransform(entity);
+			if (flags & POSITION) {
+				tr.pos.x = dequantizePosition(unzigzag(readVarint(delta)));
+				tr.pos.y = dequantizePosition(unzigzag(readVarint(delta)));
+				tr.pos.z = dequantizePosition(unzigzag(readVarint(delta)));
+			}
+			if (flags & ROTATION) {
+				const u8 largest = delta.read<u8>();
+				u16 rot[3];
+				delta.read(rot, sizeof(rot));
+				tr.rot = dequantizeRotation(rot, largest);
+			}
+			if (flags & SCALE) delta.read(tr.scale);
+			world.setTransform(entity, tr);
+		}
+
+		if (flags & COMPONENTS) {
+			const u64 components = readVarint(delta);
+			u64 current = 0;
+			for (ComponentType type : world.getComponents(entity)) current |= u64(1) << type.index;
+			for (i32 type_idx = 0; type_idx < ComponentType::MAX_TYPES_COUNT; ++type_idx) {
+				const u64 bit = u64(1) << type_idx;
+				if ((current & bit) && !(components & bit)) world.destroyComponent(entity, {type_idx});
+			}
+			for (i32 type_idx = 0; type_idx < ComponentType::MAX_TYPES_COUNT; ++type_idx) {
+				const u64 bit = u64(1) << type_idx;
+				if ((current & bit) || !(components & bit)) continue;
+				if (!world.getModule(ComponentType{type_idx})) {
+					logError("World delta contains component type ", type_idx, " which is not in the world");
+					return false;
+				}
+				world.createComponent({type_idx}, entity);
+			}
+		}
+
+		if (flags & PROPERTIES) {
+			PendingProperties& p = pending.emplace();
+			p.entity = entity;
+			p.components = readVarint(delta);
+			const u64 size = readVarint(delta);
+			p.offset = delta.getPosition();
+			delta.skip(size);
+		}
+
+		if (delta.hasOverflow()) {
+			logError("Corrupted world delta");
+			return false;
+		}
+	}
+
+	const u64 end = delta.getPosition();
+	for (const PendingProperties& p : pending) {
+		delta.setPosition(p.offset);
+		for (i32 type_idx = 0; type_idx < ComponentType::MAX_TYPES_COUNT; ++type_idx) {
+			if ((p.components & (u64(1) << type_idx)) == 0) continue;
+			const ComponentType type = {type_idx};
+			const u32 size = delta.read<u32>();
+			const u64 cmp_end = delta.getPosition() + size;
+			const reflection::ComponentBase* cmp_base = reflection::getComponent(type);
+			if (cmp_base && world.hasComponent(p.entity, type)) {
+				PropertyReader reader(delta, ComponentUID(p.entity, type, world.getModule(type)));
+				cmp_base->visit(reader);
+			}
+			delta.setPosition(cmp_end);
+		}
+	}
+	delta.setPosition(end);
+	return !delta.hasOverflow();
+}
+
+} // namespace Lumix
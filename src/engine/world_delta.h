@@ -0,0 +1,52 @@
+#pragma once
+
+#include "engine/lumix.h"
+
+#include "core/array.h"
+#include "core/math.h"
+#include "core/stream.h"
+
+namespace Lumix {
+
+struct World;
+
+// compact binary diff of world state, used for replication
+// contains created/destroyed entities, quantized transforms, added/removed components and reflected properties of changed components
+// entity indices are preserved, so `applyWorldDelta` expects a world which is a replica of the encoded one
+// names, hierarchy and partitions are not encoded
+struct LUMIX_ENGINE_API WorldDeltaEncoder {
+	explicit WorldDeltaEncoder(IAllocator& allocator);
+
+	// writes changes since the previous `encode`, the first call (or after `reset`) encodes whole world
+	// `properties` == false skips reflected properties, i.e. only entities, transforms and component sets are encoded
+	void encode(World& world, OutputMemoryStream& delta, bool properties = true);
+	// next `encode` is diffed against an empty world
+	void reset();
+
+private:
+	struct EntityState {
+		i64 pos[3];
+		u16 rot[3];
+		u8 rot_largest;
+		bool valid = false;
+		Vec3 scale;
+		u64 components;
+		u32 props_offset;
+		u32 props_size;
+	};
+
+	void capture(World& world, bool properties);
+
+	IAllocator& m_allocator;
+	Array<EntityState> m_states;
+	Array<EntityState> m_new_states;
+	OutputMemoryStream m_props;
+	OutputMemoryStream m_new_props;
+};
+
+// applies delta created by `WorldDeltaEncoder::encode`, deltas must be applied in the same order they were encoded
+[[nodiscard]] LUMIX_ENGINE_API bool applyWorldDelta(World& world, InputMemoryStream& delta);
+// writable reflected properties of `cmp` as they are stored in deltas, e.g. to compare a component with its replica
+LUMIX_ENGINE_API void writeComponentProperties(const struct ComponentUID& cmp, OutputMemoryStream& blob);
+
+} // namespace Lumix
@@ -166,6 +166,12 @@ struct GUIModuleImpl final : GUIModule {
 	
 	const char* getName() const override { return "gui"; }
 
+	bool getUpdateAccess(ModuleUpdateAccess& access) const override {
+		// input callbacks (button clicked, ...) are handled by scripts
+		access.modules[0] = "lua_script";
+		return true;
+	}
+
 	void renderTextCursor(GUIRect& rect, Draw2D& draw, const Vec2& pos)
 	{
 		if (!rect.input_field) return;
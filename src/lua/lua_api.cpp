@@ -480,6 +480,34 @@ static bool LUA_hasComponent(World* world, i32 entity, const char* type)
 }
 
 
+// LumixAPI.queryEntities(world, "cmp_a", "cmp_b", ...) -> array of entity indices having all listed components
+static int LUA_queryEntities(lua_State* L)
+{
+	World* world = LuaWrapper::checkArg<World*>(L, 1);
+	const i32 top = lua_gettop(L);
+	ComponentType types[ComponentType::MAX_TYPES_COUNT];
+	u32 types_count = 0;
+	for (i32 i = 2; i <= top; ++i) {
+		const char* type = LuaWrapper::checkArg<const char*>(L, i);
+		const ComponentType cmp_type = reflection::getComponentType(type);
+		if (!world->getModule(cmp_type)) luaL_error(L, "unknown component type %s", type);
+		if (types_count == lengthOf(types)) luaL_error(L, "too many component types");
+		types[types_count] = cmp_type;
+		++types_count;
+	}
+
+	EntityQuery query(*world, Span(types, types_count));
+	lua_createtable(L, query.count(), 0);
+	i32 idx = 1;
+	query.forEach([&](EntityRef e){
+		lua_pushinteger(L, e.index);
+		lua_rawseti(L, -2, idx);
+		++idx;
+	});
+	return 1;
+}
+
+
 static EntityRef LUA_createEntity(World* world)
 {
 	return world->createEntity({0, 0, 0}, Quat::IDENTITY);
@@ -789,6 +817,7 @@ void registerEngineAPI(lua_State* L, Engine* engine)
 	LuaWrapper::createSystemFunction(L, "LumixAPI", "createProfilerCounter", LuaWrapper::wrap<&profiler::createCounter>);
 	LuaWrapper::createSystemFunction(L, "LumixAPI", "pushProfilerCounter", LuaWrapper::wrap<&profiler::pushCounter>);
 	LuaWrapper::createSystemFunction(L, "LumixAPI", "networkRead", &LUA_networkRead);
+	LuaWrapper::createSystemFunction(L, "LumixAPI", "queryEntities", &LUA_queryEntities);
 	LuaWrapper::createSystemFunction(L, "LumixAPI", "packU32", &LUA_packU32);
 	LuaWrapper::createSystemFunction(L, "LumixAPI", "unpackU32", &LUA_unpackU32);
 	LuaWrapper::createSystemFunction(L, "LumixAPI", "networkConnect", &LUA_networkConnect);
@@ -1031,6 +1060,13 @@ void registerEngineAPI(lua_State* L, Engine* engine)
 			if LumixModules[name] == nil then return nil end
 			return LumixModules[name]:new(module)
 		end
+		function Lumix.World:query(...)
+			local entities = LumixAPI.queryEntities(self.value, ...)
+			for i, e in ipairs(entities) do
+				entities[i] = Lumix.Entity:new(self.value, e)
+			end
+			return entities
+		end
 		function Lumix.World:findEntityByName(parent, name)
 			local p = LumixAPI.findByName(self.value, parent._entity or -1, name)
 			if p < 0 then return nil end
@@ -844,6 +844,10 @@ struct LuaScriptModuleImpl final : LuaScriptModule {
 
 	const char* getName() const override { return "lua_script"; }
 
+	// scripts can access anything in the world, so lua stays undeclared and is updated alone
+	// modules calling into scripts (gui, physics, navigation, ...) are undeclared through it too
+	bool getUpdateAccess(ModuleUpdateAccess& access) const override { return false; }
+
 	IFunctionCall* beginFunctionCall(const ScriptEnvironment& env, const char* function) {
 		lua_rawgeti(env.m_state, LUA_REGISTRYINDEX, env.m_environment);
 		ASSERT(lua_type(env.m_state, -1) == LUA_TTABLE);
@@ -1971,6 +1971,7 @@ void serializeLuaTypes(OutputStream& out_formatted) {
 		createEntity : (World) -> Entity,
 		createEntityEx : (World, any) -> Entity,
 		findEntityByName : (World, Entity, string) -> Entity,
+		query : (World, ...string) -> {Entity},
 	)#");
 
 	for (Module& m : parser.modules) {
@@ -1536,6 +1536,14 @@ struct NavigationModuleImpl final : NavigationModule
 
 	const char* getName() const override { return "navigation"; }
 
+	bool getUpdateAccess(ModuleUpdateAccess& access) const override {
+		access.read_transforms = true;
+		access.write_transforms = true;
+		// onPathFinished
+		access.modules[0] = "lua_script";
+		return true;
+	}
+
 	void serialize(OutputMemoryStream& serializer) override
 	{
 		int count = m_zones.size();
@@ -1565,6 +1573,9 @@ struct NavigationModuleImpl final : NavigationModule
 	}
 
 
+	// navmeshes are read asynchronously by file system, which is thread safe
+	bool canDeserializeInParallel() const override { return true; }
+
 	void deserialize(InputMemoryStream& serializer, const EntityMap& entity_map, i32 version) override
 	{
 		u32 count = 0;
@@ -252,6 +252,12 @@ struct PhysicsModuleImpl final : PhysicsModule
 	};
 
 
+	struct TriggerEvent {
+		EntityRef e1;
+		EntityRef e2;
+		bool touch_lost;
+	};
+
 	struct PhysxContactCallback final : PxSimulationEventCallback
 	{
 		explicit PhysxContactCallback(PhysicsModuleImpl& module)
@@ -281,7 +287,7 @@ struct PhysicsModuleImpl final : PhysicsModule
 				contact_data.e1 = {(int)(intptr_t)(pairHeader.actors[0]->userData)};
 				contact_data.e2 = {(int)(intptr_t)(pairHeader.actors[1]->userData)};
 
-				m_module.onContact(contact_data);
+				m_module.m_queued_contacts.push(contact_data);
 			}
 		}
 
@@ -297,7 +303,7 @@ struct PhysicsModuleImpl final : PhysicsModule
 				EntityRef e1 = {(int)(intptr_t)(pairs[i].triggerActor->userData)};
 				EntityRef e2 = {(int)(intptr_t)(pairs[i].otherActor->userData)};
 
-				m_module.onTrigger(e1, e2, pairs[i].status == PxPairFlag::eNOTIFY_TOUCH_LOST);
+				m_module.m_queued_triggers.push({e1, e2, pairs[i].status == PxPairFlag::eNOTIFY_TOUCH_LOST});
 			}
 		}
 
@@ -330,6 +336,7 @@ struct PhysicsModuleImpl final : PhysicsModule
 			, dynamic_type(rhs.dynamic_type)
 			, is_trigger(rhs.is_trigger)
 			, ccd(rhs.ccd)
+			, prev_pose(rhs.prev_pose)
 		{
 			rhs.mesh = nullptr;
 			rhs.material = nullptr;
@@ -361,6 +368,8 @@ struct PhysicsModuleImpl final : PhysicsModule
 		DynamicType dynamic_type = DynamicType::STATIC;
 		bool is_trigger = false;
 		bool ccd = false;
+		// pose before the last fixed step, for interpolation
+		PxTransform prev_pose = PxTransform(PxIdentity);
 	};
 
 
@@ -408,6 +417,21 @@ struct PhysicsModuleImpl final : PhysicsModule
 
 	const char* getName() const override { return "physics"; }
 
+	bool getUpdateAccess(ModuleUpdateAccess& access) const override {
+		access.read_transforms = true;
+		access.write_transforms = true;
+		// debug lines
+		access.modules[0] = "renderer";
+		// root motion
+		access.modules[1] = "animation";
+		// contact and trigger callbacks
+		access.modules[2] = "lua_script";
+		return true;
+	}
+
+	// only steps physx scene, contacts and triggers reported by the scene are dispatched later in update
+	bool isUpdateParallelUnfenced() const override { return true; }
+
 	~PhysicsModuleImpl() {
 		for (auto& controller : m_controllers) {
 			controller.controller->release();
@@ -462,6 +486,22 @@ struct PhysicsModuleImpl final : PhysicsModule
 		m_scene->release();
 	}
 
+	// fetchResults can run before frame fence, in updateParallel, so events are queued and dispatched on "main thread"
+	void dispatchQueuedEvents() {
+		PROFILE_FUNCTION();
+		// callbacks can destroy entities
+		for (const TriggerEvent& e : m_queued_triggers) {
+			if (!m_world.hasEntity(e.e1) || !m_world.hasEntity(e.e2)) continue;
+			onTrigger(e.e1, e.e2, e.touch_lost);
+		}
+		for (const ContactData& contact : m_queued_contacts) {
+			if (!m_world.hasEntity(contact.e1) || !m_world.hasEntity(contact.e2)) continue;
+			onContact(contact);
+		}
+		m_queued_triggers.clear();
+		m_queued_contacts.clear();
+	}
+
 	// TODO move to lua plugin
 	void onTrigger(EntityRef e1, EntityRef e2, bool touch_lost)
 	{
@@ -1724,14 +1764,20 @@ struct PhysicsModuleImpl final : PhysicsModule
 	}
 
 
-	void updateDynamicActors(bool vehicles)
+	// `alpha` < 1 interpolates between pose before and after the last fixed step
+	void updateDynamicActors(bool vehicles, float alpha = 1)
 	{
 		PROFILE_FUNCTION();
 		for (EntityRef e : m_dynamic_actors) {
 			RigidActor& actor = m_actors[e];
 			m_update_in_progress = &actor;
-			PxTransform trans = actor.physx_actor->getGlobalPose();
-			m_world.setTransform(actor.entity, fromPhysx(trans));
+			RigidTransform trans = fromPhysx(actor.physx_actor->getGlobalPose());
+			if (alpha < 1) {
+				const RigidTransform prev = fromPhysx(actor.prev_pose);
+				trans.pos = lerp(prev.pos, trans.pos, alpha);
+				trans.rot = nlerp(prev.rot, trans.rot, alpha);
+			}
+			m_world.setTransform(actor.entity, trans);
 		}
 		m_update_in_progress = nullptr;
 
@@ -1864,11 +1910,14 @@ struct PhysicsModuleImpl final : PhysicsModule
 	void forceUpdateDynamicActors(float time_delta) override {
 		simulateScene(time_delta);
 		fetchResults();
+		dispatchQueuedEvents();
 		updateDynamicActors(false);
 	}
 
+	// with fixed steps the simulation runs in fixedUpdate
 	void updateParallel(float time_delta) override {
 		if (!m_is_game_running) return;
+		if (m_engine.getFixedTimeStep() > 0) return;
 
 		time_delta = minimum(1 / 20.0f, time_delta);
 		updateVehicles(time_delta);
@@ -1876,10 +1925,23 @@ struct PhysicsModuleImpl final : PhysicsModule
 		fetchResults();
 	}
 
+	void fixedUpdate(float time_step) override {
+		if (!m_is_game_running) return;
+
+		for (EntityRef e : m_dynamic_actors) {
+			RigidActor& actor = m_actors[e];
+			actor.prev_pose = actor.physx_actor->getGlobalPose();
+		}
+		updateVehicles(time_step);
+		simulateScene(time_step);
+		fetchResults();
+	}
+
 	void update(float time_delta) override {
 		if (!m_is_game_running) return;
 
-		updateDynamicActors(true);
+		dispatchQueuedEvents();
+		updateDynamicActors(true, m_engine.getFixedTimeStep() > 0 ? m_engine.getFixedStepAlpha() : 1);
 		updateControllers(time_delta);
 
 		render();
@@ -2276,7 +2338,11 @@ struct PhysicsModuleImpl final : PhysicsModule
 	}
 
 
-	void stopGame() override { m_is_game_running = false; }
+	void stopGame() override {
+		m_is_game_running = false;
+		m_queued_triggers.clear();
+		m_queued_contacts.clear();
+	}
 
 
 	float getControllerRadius(EntityRef entity) override { return m_controllers[entity].radius; }
@@ -2518,6 +2584,7 @@ struct PhysicsModuleImpl final : PhysicsModule
 			}
 			else {
 				actor.physx_actor->setGlobalPose(toPhysx(trans.getRigidPart()), false);
+				actor.prev_pose = actor.physx_actor->getGlobalPose();
 			}
 			if (actor.mesh && (actor.scale != trans.scale)) {
 				actor.rescale();
@@ -3841,6 +3908,8 @@ struct PhysicsModuleImpl final : PhysicsModule
 	RigidActor* m_update_in_progress;
 	EntityPtr m_moving_controller = INVALID_ENTITY;
 	DelegateList<void(const ContactData&)> m_contact_callbacks;
+	Array<ContactData> m_queued_contacts;
+	Array<TriggerEvent> m_queued_triggers;
 	bool m_is_game_running;
 	u32 m_debug_visualization_flags;
 	CPUDispatcher m_cpu_dispatcher;
@@ -3862,6 +3931,8 @@ PhysicsModuleImpl::PhysicsModuleImpl(Engine& engine, World& world, PhysicsSystem
 	, m_is_game_running(false)
 	, m_contact_callback(*this)
 	, m_contact_callbacks(m_allocator)
+	, m_queued_contacts(m_allocator)
+	, m_queued_triggers(m_allocator)
 	, m_joints(m_allocator)
 	, m_script_module(nullptr)
 	, m_debug_visualization_flags(0)
@@ -3987,6 +4058,7 @@ void PhysicsModuleImpl::RigidActor::setPhysxActor(PxRigidActor* actor)
 	{
 		module.m_scene->addActor(*actor);
 		actor->userData = (void*)(intptr_t)entity.index;
+		prev_pose = actor->getGlobalPose();
 		module.updateFilterData(actor, layer);
 		setIsTrigger(is_trigger);
 		PxRigidBody* rigid_body = actor->is<PxRigidBody>();
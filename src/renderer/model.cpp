@@ -305,6 +305,24 @@ static bool parseVertexDecl(IInputStream& file, gpu::VertexDecl* vertex_decl, At
 }
 
 
+u64 Model::getCPUMemorySize() const
+{
+	u64 size = 0;
+	for (const Mesh& mesh : m_meshes) {
+		size += mesh.vertices.byte_size() + mesh.indices.size() + mesh.skin.byte_size();
+	}
+	return size;
+}
+
+u64 Model::getGPUMemorySize() const
+{
+	u64 size = 0;
+	for (const Mesh& mesh : m_meshes) {
+		size += u64(mesh.vertices.size()) * mesh.vb_stride + mesh.indices.size();
+	}
+	return size;
+}
+
 void Model::onBeforeReady()
 {
 	for (u32 i = 0, n = m_meshes.size(); i < n; ++i) {
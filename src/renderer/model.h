@@ -168,6 +168,8 @@ struct LUMIX_RENDERER_API Model final : Resource {
 	Model(const Path& path, ResourceManager& resource_manager, Renderer& renderer, IAllocator& allocator);
 
 	ResourceType getType() const override { return TYPE; }
+	u64 getCPUMemorySize() const override;
+	u64 getGPUMemorySize() const override;
 
 	u32 getLODMeshIndices(float squared_distance) const {
 		if (squared_distance < m_lod_distances[0]) return 0;
@@ -593,7 +593,9 @@ struct PipelineImpl final : Pipeline {
 		, m_2D_decl(gpu::PrimitiveType::TRIANGLES)
 		, m_instance_data(m_allocator)
 		, m_material_override_refresh_queue(m_allocator)
+		, m_frame_hook(*this)
 	{
+		m_renderer.addPlugin(m_frame_hook);
 		m_viewport.w = m_viewport.h = 800;
 		ResourceManagerHub& rm = renderer.getEngine().getResourceManager();
 		m_tonemap_shader = rm.load<Shader>(Path("engine/shaders/tonemap.hlsl"));
@@ -672,6 +674,8 @@ struct PipelineImpl final : Pipeline {
 
 	~PipelineImpl()
 	{
+		if (m_setup_pending) finishSetup();
+		m_renderer.removePlugin(m_frame_hook);
 		for (void* ptr : m_instance_data) m_allocator.deallocate(ptr);
 		for (RenderPlugin* plugin : m_renderer.getPlugins()) {
 			plugin->pipelineDestroyed(*this);
@@ -1715,8 +1719,17 @@ struct PipelineImpl final : Pipeline {
 		stream.endProfileBlock();
 	}
 
+	// waits for culling and command setup jobs pushed by the last `render`
+	void finishSetup() {
+		m_renderer.waitForCommandSetup();
+		m_views.clear();
+		refreshMaterialOverrides();
+		m_setup_pending = false;
+	}
+
 	bool render(bool only_2d) override {
 		PROFILE_FUNCTION();
+		if (m_setup_pending) finishSetup();
 
 		if (m_viewport.w <= 0 || m_viewport.h <= 0) {
 			if (m_module) {
@@ -1728,6 +1741,7 @@ struct PipelineImpl final : Pipeline {
 		}
 
 		m_renderer.waitCanSetup();
+		if (m_module) m_module->updateMovedInstances();
 
 		m_viewport.pixel_offset = Vec2(0);
 
@@ -1822,10 +1836,9 @@ struct PipelineImpl final : Pipeline {
 
 		endBlock();
 
-		m_renderer.waitForCommandSetup();
-
-		m_views.clear();
-		refreshMaterialOverrides();
+		m_setup_pending = true;
+		// pipelined jobs run while the next frame is simulated, `m_frame_hook` finishes them
+		if (!m_renderer.arePipelinedFramesEnabled()) finishSetup();
 
 		return true;
 	}
@@ -1983,6 +1996,7 @@ struct PipelineImpl final : Pipeline {
 	void setWorld(World* world) override {
 		RenderModule* module = world ? (RenderModule*)world->getModule("renderer") : nullptr;
 		if (m_module == module) return;
+		if (m_setup_pending) finishSetup();
 		m_module = module;
 		m_shadow_atlas.clear();
 	}
@@ -4187,6 +4201,7 @@ struct PipelineImpl final : Pipeline {
 	Shader* m_downscale_depth_shader = nullptr;
 	gpu::ProgramHandle m_blit_screen_program = gpu::INVALID_PROGRAM;
 	Array<UniquePtr<View>> m_views;
+	bool m_setup_pending = false;
 	jobs::Signal m_buckets_ready;
 	Viewport m_viewport;
 	bool m_is_pixel_jitter_enabled = false;
@@ -4235,6 +4250,16 @@ struct PipelineImpl final : Pipeline {
 	GlobalState m_global_state;
 	Array<EntityRef> m_material_override_refresh_queue;
 	jobs::Mutex m_material_override_refresh_mutex;
+
+	// renderer finished the frame, so pipelined jobs are done too
+	struct FrameHook : RenderPlugin {
+		FrameHook(PipelineImpl& pipeline) : pipeline(pipeline) {}
+		void frame(Renderer& renderer) override {
+			if (pipeline.m_setup_pending) pipeline.finishSetup();
+		}
+		PipelineImpl& pipeline;
+	};
+	FrameHook m_frame_hook;
 };
 
 
@@ -11,7 +11,6 @@
 #include "core/math.h"
 #include "core/page_allocator.h"
 #include "core/profiler.h"
-#include "core/stack_array.h"
 #include "core/stream.h"
 #include "engine/component_types.h"
 #include "engine/engine.h"
@@ -156,7 +155,7 @@ struct RenderModuleImpl final : RenderModule {
 
 
 	~RenderModuleImpl() {
-		m_world.componentTransformed(types::model_instance).unbind<&RenderModuleImpl::onModelInstanceMoved>(this);
+		m_world.enableTransformTracking(types::model_instance, false);
 		m_world.componentTransformed(types::decal).unbind<&RenderModuleImpl::onDecalMoved>(this);
 		m_world.componentTransformed(types::curve_decal).unbind<&RenderModuleImpl::onCurveDecalMoved>(this);
 		m_world.componentTransformed(types::particle_emitter).unbind<&RenderModuleImpl::onParticleEmitterMoved>(this);
@@ -517,6 +516,11 @@ struct RenderModuleImpl final : RenderModule {
 	void stopGame() override { m_is_game_running = false; }
 
 	void endFrame() override {
+		for (EntityRef e : m_dead_emitters) {
+			if (m_world.hasEntity(e)) m_world.destroyEntity(e);
+		}
+		m_dead_emitters.clear();
+
 		for (EntityRef e : m_moved_instances) {
 			if (!m_world.hasEntity(e)) continue;
 
@@ -529,9 +533,9 @@ struct RenderModuleImpl final : RenderModule {
 	void update(float dt) override {
 		PROFILE_FUNCTION();
 
+		updateMovedInstances();
 		if (!m_is_game_running) return;
 
-		StackArray<EntityRef, 16> to_delete(m_allocator);
 		jobs::Mutex mutex;
 		ParticleSystem::Stats stats = {};
 		// TODO move to parallel update?
@@ -541,7 +545,7 @@ struct RenderModuleImpl final : RenderModule {
 
 			if (ps->update(dt, m_engine.getPageAllocator())) {
 				jobs::enter(&mutex);
-				to_delete.push(*ps->m_entity);
+				m_dead_emitters.push(*ps->m_entity);
 				jobs::exit(&mutex);
 			}
 
@@ -557,16 +561,22 @@ struct RenderModuleImpl final : RenderModule {
 		profiler::pushCounter(emitted_particles_stat, (float)stats.emitted);
 		profiler::pushCounter(killed_particles_stat, (float)stats.killed);
 		profiler::pushCounter(processed_particles_stat, (float)stats.processed);
-
-		for (EntityRef e : to_delete) {
-			m_world.destroyEntity(e);
-		}
 	}
 
 	int getVersion() const override { return (int)RenderModuleVersion::LATEST; }
 
 	const char* getName() const override { return "renderer"; }
 
+	bool getUpdateAccess(ModuleUpdateAccess& access) const override {
+		access.read_transforms = true;
+		// bone attachments
+		access.write_transforms = true;
+		// particle emitters following splines
+		access.read_components = u64(1) << types::spline.index;
+		// dead emitters are destroyed in `endFrame`, since destroying entities touches components of all modules
+		return true;
+	}
+
 	void serializeBoneAttachments(OutputMemoryStream& serializer) {
 		serializer.write((i32)m_bone_attachments.size());
 		for (auto& attachment : m_bone_attachments) {
@@ -635,9 +645,9 @@ struct RenderModuleImpl final : RenderModule {
 		serializer.write(m_active_global_light_entity);
 	}
 
-	void serializeModelInstances(OutputMemoryStream& serializer) {
+	// paths of all used models, instances reference them by offset
+	void serializeModelPaths(OutputMemoryStream& serializer, HashMap<Model*, u32>& offsets) {
 		u32 len = 0;
-		HashMap<Model*, u32> offsets(m_allocator);
 		for (auto iter : m_model_entity_map.iterated()) {
 			offsets.insert(iter.key(), len);
 			len += iter.key()->getPath().length() + 1;
@@ -647,6 +657,11 @@ struct RenderModuleImpl final : RenderModule {
 		for (auto iter : m_model_entity_map.iterated()) {
 			serializer.writeString(iter.key()->getPath());
 		}
+	}
+
+	void serializeModelInstances(OutputMemoryStream& serializer) {
+		HashMap<Model*, u32> offsets(m_allocator);
+		serializeModelPaths(serializer, offsets);
 
 		serializer.write((i32)m_model_instances.size());
 		for (const ModelInstance& r : m_model_instances) {
@@ -666,6 +681,37 @@ struct RenderModuleImpl final : RenderModule {
 		}
 	}
 
+	// model instances are indexed by entity, so flags and models are stored as raw arrays, see `serializeBlittable`
+	// material overrides are rare, they follow as a sparse list sorted by entity
+	void serializeModelInstancesBlittable(OutputMemoryStream& serializer) {
+		HashMap<Model*, u32> offsets(m_allocator);
+		serializeModelPaths(serializer, offsets);
+
+		serializer.write((u32)m_model_instances.size());
+		serializer.align(16);
+		for (const ModelInstance& r : m_model_instances) serializer.write(r.flags);
+		serializer.align(16);
+		for (const ModelInstance& r : m_model_instances) {
+			const bool has_model = (r.flags & ModelInstance::VALID) && r.model;
+			serializer.write(u32(has_model ? offsets[r.model] : 0xffFFffFF));
+		}
+
+		u32 overrides_count = 0;
+		for (const ModelInstance& r : m_model_instances) {
+			if ((r.flags & ModelInstance::VALID) && hasMaterialOverride(r)) ++overrides_count;
+		}
+		serializer.write(overrides_count);
+		for (i32 i = 0, c = m_model_instances.size(); i < c; ++i) {
+			const ModelInstance& r = m_model_instances[i];
+			if (!(r.flags & ModelInstance::VALID) || !hasMaterialOverride(r)) continue;
+			serializer.write(i);
+			serializer.write((u32)r.mesh_materials.size());
+			for (const MeshMaterial& m : r.mesh_materials) {
+				serializer.writeString(m.material ? m.material->getPath().c_str() : "");
+			}
+		}
+	}
+
 	void serializeTerrains(OutputMemoryStream& serializer)
 	{
 		serializer.write((i32)m_terrains.size());
@@ -947,10 +993,119 @@ struct RenderModuleImpl final : RenderModule {
 		}
 	}
 
-	void serialize(OutputMemoryStream& serializer) override
-	{
+	template <typename T>
+	static void snapshotComponents(OutputMemoryStream& blob, HashMap<EntityRef, T>& components) {
+		blob.write((u32)components.size());
+		for (auto iter : components.iterated()) {
+			blob.write(iter.key());
+			blob.write(iter.value());
+		}
+	}
+
+	// components which are not in the snapshot are destroyed, missing ones are created and `restore(entity, value)` is called for each
+	template <typename T, typename F>
+	void restoreComponents(InputMemoryStream& blob, HashMap<EntityRef, T>& components, ComponentType type, F restore) {
+		HashMap<EntityRef, u32> restored(m_allocator);
+		const u32 count = blob.read<u32>();
+		restored.reserve(count);
+		for (u32 i = 0; i < count; ++i) {
+			const EntityRef e = blob.read<EntityRef>();
+			const T value = blob.read<T>();
+			if (!components.find(e).isValid()) m_world.createComponent(type, e);
+			restore(e, value);
+			restored.insert(e, i);
+		}
+		Array<EntityRef> to_destroy(m_allocator);
+		for (auto iter : components.iterated()) {
+			if (!restored.find(iter.key()).isValid()) to_destroy.push(iter.key());
+		}
+		for (EntityRef e : to_destroy) m_world.destroyComponent(e, type);
+	}
+
+	// only cameras, lights, environments and model instances (without material overrides) are in the snapshot
+	// other components are kept as they are when the snapshot is restored
+	bool takeSnapshot(OutputMemoryStream& blob) override {
+		snapshotComponents(blob, m_cameras);
+		snapshotComponents(blob, m_point_lights);
+		// resources are stored as paths, since they can be unloaded before the snapshot is restored
+		snapshotComponents(blob, m_environments);
+		for (auto iter : m_environments.iterated()) {
+			blob.write(iter.key());
+			blob.writeString(getEnvironmentSkyTexture(iter.key()));
+		}
+		blob.write(m_active_camera);
+		blob.write(m_active_global_light_entity);
+
+		u32 count = 0;
+		for (const ModelInstance& mi : m_model_instances) {
+			if (mi.flags & ModelInstance::VALID) ++count;
+		}
+		blob.write(count);
+		for (i32 i = 0, c = m_model_instances.size(); i < c; ++i) {
+			const ModelInstance& mi = m_model_instances[i];
+			if (!(mi.flags & ModelInstance::VALID)) continue;
+			blob.write(EntityRef{i});
+			blob.write(bool(mi.flags & ModelInstance::ENABLED));
+			blob.writeString(mi.model ? mi.model->getPath() : Path());
+		}
+		return true;
+	}
+
+	void restoreSnapshot(InputMemoryStream& blob) override {
+		restoreComponents(blob, m_cameras, types::camera, [&](EntityRef e, const Camera& value){
+			m_cameras[e] = value;
+		});
+		restoreComponents(blob, m_point_lights, types::point_light, [&](EntityRef e, const PointLight& value){
+			PointLight& light = m_point_lights[e];
+			if (light.range != value.range) m_culling_system->setRadius(e, value.range);
+			light = value;
+		});
+		restoreComponents(blob, m_environments, types::environment, [&](EntityRef e, const Environment& value){
+			Environment& env = m_environments[e];
+			Texture* cubemap_sky = env.cubemap_sky;
+			env = value;
+			env.cubemap_sky = cubemap_sky;
+		});
+		for (u32 i = 0, c = m_environments.size(); i < c; ++i) {
+			const EntityRef e = blob.read<EntityRef>();
+			const Path cubemap_sky(blob.readString());
+			if (getEnvironmentSkyTexture(e) != cubemap_sky) setEnvironmentSkyTexture(e, cubemap_sky);
+		}
+		m_active_camera = blob.read<EntityPtr>();
+		m_active_global_light_entity = blob.read<EntityPtr>();
+
+		HashMap<EntityRef, u32> restored(m_allocator);
+		const u32 count = blob.read<u32>();
+		restored.reserve(count);
+		for (u32 i = 0; i < count; ++i) {
+			const EntityRef e = blob.read<EntityRef>();
+			const bool enabled = blob.read<bool>();
+			const Path path(blob.readString());
+			if (e.index >= m_model_instances.size() || !(m_model_instances[e.index].flags & ModelInstance::VALID)) {
+				createModelInstance(e);
+			}
+			if (getModelInstancePath(e) != path) setModelInstancePath(e, path);
+			if (isModelInstanceEnabled(e) != enabled) enableModelInstance(e, enabled);
+			restored.insert(e, i);
+		}
+		for (i32 i = 0, c = m_model_instances.size(); i < c; ++i) {
+			if (!(m_model_instances[i].flags & ModelInstance::VALID)) continue;
+			if (!restored.find(EntityRef{i}).isValid()) destroyModelInstance(EntityRef{i});
+		}
+	}
+
+	void serialize(OutputMemoryStream& serializer) override { serializeModule(serializer, false); }
+
+	bool serializeBlittable(OutputMemoryStream& serializer) override {
+		serializeModule(serializer, true);
+		return true;
+	}
+
+	// blittable data differs only in model instances
+	void serializeModule(OutputMemoryStream& serializer, bool blittable) {
 		serializeCameras(serializer);
-		serializeModelInstances(serializer);
+		if (blittable) serializeModelInstancesBlittable(serializer);
+		else serializeModelInstances(serializer);
 		serializeLights(serializer);
 		serializeTerrains(serializer);
 		serializeParticleSystems(serializer);
@@ -1036,13 +1191,80 @@ struct RenderModuleImpl final : RenderModule {
 			}
 		}
 	}
-	void deserializeModelInstances(InputMemoryStream& serializer, const EntityMap& entity_map, RenderModuleVersion version)
-	{
-		PROFILE_FUNCTION();
+	// written by `serializeModelPaths`, `model_indices` maps offsets to `models`, which must be released by caller
+	void loadModels(InputMemoryStream& serializer, Array<Resource*>& models, HashMap<u32, u32>& model_indices) {
 		u32 size = 0;
 		serializer.read(size);
 		const char* paths = (const char*)serializer.skip(size);
 
+		// paths are unique, so we can load all models at once
+		Array<Path> model_paths(m_allocator);
+		for (u32 offset = 0; offset < size; offset += stringLength(paths + offset) + 1) {
+			model_indices.insert(offset, model_paths.size());
+			model_paths.emplace(paths + offset);
+		}
+		models.resize(model_paths.size());
+		m_engine.getResourceManager().loadMany(Model::TYPE, model_paths, models);
+	}
+
+	void deserializeModelInstancesBlittable(InputMemoryStream& serializer, const EntityMap& entity_map) {
+		PROFILE_FUNCTION();
+		Array<Resource*> models(m_allocator);
+		HashMap<u32, u32> model_indices(m_allocator);
+		loadModels(serializer, models, model_indices);
+
+		const u32 size = serializer.read<u32>();
+		serializer.align(16);
+		const ModelInstance::Flags* flags = (const ModelInstance::Flags*)serializer.skip(size * sizeof(ModelInstance::Flags));
+		serializer.align(16);
+		const u32* model_offsets = (const u32*)serializer.skip(size * sizeof(u32));
+		u32 overrides_count = serializer.read<u32>();
+		i32 next_override = overrides_count > 0 ? serializer.read<i32>() : -1;
+
+		m_model_instances.reserve(nextPow2(size + m_model_instances.size()));
+		for (u32 i = 0; i < size; ++i) {
+			if (!(flags[i] & ModelInstance::VALID)) continue;
+
+			const EntityRef e = entity_map.get(EntityRef{(i32)i});
+			while (e.index >= m_model_instances.size()) {
+				m_model_instances.emplace();
+			}
+
+			ModelInstance& r = m_model_instances[e.index];
+			r.flags = flags[i];
+			auto model_iter = model_indices.find(model_offsets[i]);
+			if (model_offsets[i] != 0xffFFffFF && model_iter.isValid()) {
+				Model* model = static_cast<Model*>(models[model_iter.value()]);
+				model->incRefCount();
+				setModel(e, model);
+			}
+
+			if (next_override == (i32)i) {
+				const u32 num_elems = serializer.read<u32>();
+				for (u32 mesh_idx = 0; mesh_idx < num_elems; ++mesh_idx) {
+					const char* path = serializer.readString();
+					setModelInstanceMaterialOverride(e, mesh_idx, Path(path));
+				}
+				--overrides_count;
+				next_override = overrides_count > 0 ? serializer.read<i32>() : -1;
+			}
+
+			m_world.onComponentCreated(e, types::model_instance, this);
+		}
+
+		for (Resource* model : models) {
+			if (model) model->decRefCount();
+		}
+	}
+
+	void deserializeModelInstances(InputMemoryStream& serializer, const EntityMap& entity_map, RenderModuleVersion version)
+	{
+		PROFILE_FUNCTION();
+		Array<Resource*> models(m_allocator);
+		HashMap<u32, u32> model_indices(m_allocator);
+		loadModels(serializer, models, model_indices);
+
+		u32 size = 0;
 		serializer.read(size);
 		m_model_instances.reserve(nextPow2(size + m_model_instances.size()));
 		for (u32 i = 0; i < size; ++i) {
@@ -1060,8 +1282,10 @@ struct RenderModuleImpl final : RenderModule {
 				r.flags = flags;
 
 				const u32 path_offset = serializer.read<u32>();
-				if (path_offset != 0xffFFffFF) {
-					Model* model = m_engine.getResourceManager().load<Model>(Path(paths + path_offset));
+				auto model_iter = model_indices.find(path_offset);
+				if (path_offset != 0xffFFffFF && model_iter.isValid()) {
+					Model* model = static_cast<Model*>(models[model_iter.value()]);
+					model->incRefCount();
 					setModel(e, model);
 				}
 
@@ -1082,6 +1306,10 @@ struct RenderModuleImpl final : RenderModule {
 				m_world.onComponentCreated(e, types::model_instance, this);
 			}
 		}
+
+		for (Resource* model : models) {
+			if (model) model->decRefCount();
+		}
 	}
 
 	void deserializeLights(InputMemoryStream& serializer, const EntityMap& entity_map, i32 version) {
@@ -1210,10 +1438,20 @@ struct RenderModuleImpl final : RenderModule {
 	}
 
 
-	void deserialize(InputMemoryStream& serializer, const EntityMap& entity_map, i32 version) override
-	{
+	void deserialize(InputMemoryStream& serializer, const EntityMap& entity_map, i32 version) override {
+		deserializeModule(serializer, entity_map, version, false);
+	}
+
+	void deserializeBlittable(InputMemoryStream& serializer, const EntityMap& entity_map, i32 version) override {
+		deserializeModule(serializer, entity_map, version, true);
+	}
+
+	void deserializeModule(InputMemoryStream& serializer, const EntityMap& entity_map, i32 version, bool blittable) {
 		deserializeCameras(serializer, entity_map, version);
-		if (version > (i32)RenderModuleVersion::SMALLER_MODEL_INSTANCES) {
+		if (blittable) {
+			deserializeModelInstancesBlittable(serializer, entity_map);
+		}
+		else if (version > (i32)RenderModuleVersion::SMALLER_MODEL_INSTANCES) {
 			deserializeModelInstances(serializer, entity_map, (RenderModuleVersion)version);
 		}
 		else {
@@ -1529,6 +1767,17 @@ struct RenderModuleImpl final : RenderModule {
 #endif
 	}
 
+	// model instances are tracked by world instead of using `componentTransformed` callback, so we can update them in one pass
+	void updateMovedInstances() override {
+		// moving model instance can move its bone attachments, which are appended to transformed entities, so no range-based for
+		for (u32 i = 0; i < m_world.getTransformedEntities(types::model_instance).length(); ++i) {
+			const EntityRef e = m_world.getTransformedEntities(types::model_instance)[i];
+			if (!m_world.hasEntity(e) || !m_world.hasComponent(e, types::model_instance)) continue;
+			onModelInstanceMoved(e);
+		}
+		m_world.clearTransformedEntities(types::model_instance);
+	}
+
 	void onModelInstanceMoved(EntityRef entity) {
 		if (!m_culling_system->isAdded(entity)) return;
 		
@@ -3277,6 +3526,24 @@ struct RenderModuleImpl final : RenderModule {
 		m_world.onComponentCreated(entity, types::model_instance, this);
 	}
 
+	bool createComponents(ComponentType type, Span<const EntityRef> entities) override {
+		if (type != types::model_instance) return false;
+
+		i32 max_index = -1;
+		for (EntityRef e : entities) max_index = maximum(max_index, e.index);
+		if (max_index >= m_model_instances.size()) {
+			m_model_instances.reserve(nextPow2(max_index + 1));
+			while (max_index >= m_model_instances.size()) m_model_instances.emplace();
+		}
+		for (EntityRef e : entities) {
+			ModelInstance& r = m_model_instances[e.index];
+			ASSERT(!r.model);
+			r.flags = ModelInstance::VALID | ModelInstance::ENABLED;
+			m_world.onComponentCreated(e, types::model_instance, this);
+		}
+		return true;
+	}
+
 	void updateParticleEmitter(EntityRef entity, float dt) override { m_particle_emitters[entity].update(dt, m_engine.getPageAllocator()); }
 
 	void setParticleEmitterAutodestroy(EntityRef entity, bool enable) override {
@@ -3398,6 +3665,8 @@ struct RenderModuleImpl final : RenderModule {
 	HashMap<EntityRef, CurveDecal> m_curve_decals;
 	Array<ModelInstance> m_model_instances;
 	Array<EntityRef> m_moved_instances;
+	// entities of finished particle emitters, destroyed in `endFrame`
+	Array<EntityRef> m_dead_emitters;
 	HashMap<EntityRef, InstancedModel> m_instanced_models;
 	HashMap<EntityRef, Environment> m_environments;
 	HashMap<EntityRef, Camera> m_cameras;
@@ -3524,6 +3793,7 @@ RenderModuleImpl::RenderModuleImpl(Renderer& renderer,
 	, m_model_entity_map(m_allocator)
 	, m_model_instances(m_allocator)
 	, m_moved_instances(m_allocator)
+	, m_dead_emitters(m_allocator)
 	, m_instanced_models(m_allocator)
 	, m_cameras(m_allocator) 
 	, m_terrains(m_allocator)
@@ -3544,7 +3814,7 @@ RenderModuleImpl::RenderModuleImpl(Renderer& renderer,
 	, m_material_decal_map(m_allocator)
 	, m_material_curve_decal_map(m_allocator)
 {
-	m_world.componentTransformed(types::model_instance).bind<&RenderModuleImpl::onModelInstanceMoved>(this);
+	m_world.enableTransformTracking(types::model_instance, true);
 	m_world.componentTransformed(types::decal).bind<&RenderModuleImpl::onDecalMoved>(this);
 	m_world.componentTransformed(types::curve_decal).bind<&RenderModuleImpl::onCurveDecalMoved>(this);
 	m_world.componentTransformed(types::particle_emitter).bind<&RenderModuleImpl::onParticleEmitterMoved>(this);
@@ -412,6 +412,8 @@ struct LUMIX_RENDERER_API RenderModule : IModule
 	virtual void clearDebugTriangles() = 0;
 	virtual const Array<DebugTriangle>& getDebugTriangles() const = 0;
 	virtual const Array<DebugLine>& getDebugLines() const = 0;
+	// pushes transforms of moved model instances to culling, called by pipeline before rendering
+	virtual void updateMovedInstances() = 0;
 
 	virtual Camera& getCamera(EntityRef entity) = 0;
 	virtual Matrix getCameraProjection(EntityRef entity) = 0;
@@ -459,6 +459,16 @@ struct RendererImpl final : Renderer {
 		addPlugin(m_taa);
 	}
 
+	void setPipelinedFrames(bool enable) override {
+		if (enable == m_pipelined_frames) return;
+		waitForCommandSetup();
+		m_pipelined_frames = enable;
+		if (enable) m_engine.setFrameFence("renderer", makeDelegate<&RendererImpl::waitForCommandSetup>(this));
+		else m_engine.setFrameFence(nullptr, {});
+	}
+
+	bool arePipelinedFramesEnabled() const override { return m_pipelined_frames; }
+
 	float getLODMultiplier() const override { return m_lod_multiplier; }
 	void setLODMultiplier(float value) override { m_lod_multiplier = maximum(0.f, value); }
 
@@ -564,6 +574,8 @@ struct RendererImpl final : Renderer {
 	}
 
 	void shutdownStarted() override {
+		// engine must not call fence of destroyed renderer
+		setPipelinedFrames(false);
 		m_bloom.shutdown();
 		m_atmo.shutdown();
 		m_cubemap_sky.shutdown();
@@ -1328,6 +1340,7 @@ struct RendererImpl final : Renderer {
 	RenderResourceManager<Material> m_material_manager;
 	u32 m_frame_number = 0;
 	float m_lod_multiplier = 1;
+	bool m_pipelined_frames = false;
 	jobs::Counter m_init_signal;
 	HashMap<RuntimeHash, String> m_semantic_defines;
 
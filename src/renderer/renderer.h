@@ -71,6 +71,10 @@ struct LUMIX_RENDERER_API Renderer : ISystem {
 	virtual void waitForRender() = 0;
 	virtual void waitForCommandSetup() = 0;
 	virtual void waitCanSetup() = 0;
+	// pipelined frames - `Pipeline::render` does not wait for culling and command setup jobs, they run while the next frame is simulated
+	// call `frame` after `Engine::update`, which waits for the jobs before updating modules touching render data, and before next `Pipeline::render`
+	virtual void setPipelinedFrames(bool enable) = 0;
+	virtual bool arePipelinedFramesEnabled() const = 0;
 	virtual struct Engine& getEngine() = 0;
 	virtual float getLODMultiplier() const = 0;
 	virtual void setLODMultiplier(float value) = 0;
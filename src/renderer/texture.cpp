@@ -505,6 +505,17 @@ static bool loadLBC(Texture& texture, const u8* data, u32 size)
 	return texture.handle;
 }
 
+u64 Texture::getGPUMemorySize() const
+{
+	if (!handle) return 0;
+
+	u64 size = 0;
+	for (u32 i = 0; i < maximum(mips, 1u); ++i) {
+		size += gpu::getSize(format, maximum(width >> i, 1u), maximum(height >> i, 1u));
+	}
+	return size * maximum(depth, 1u) * (is_cubemap ? 6 : 1);
+}
+
 gpu::TextureFlags Texture::getGPUFlags() const
 {
 	gpu::TextureFlags gpu_flags = gpu::TextureFlags::NONE;
@@ -79,6 +79,8 @@ struct LUMIX_RENDERER_API Texture final : Resource {
 	Texture(const Path& path, ResourceManager& resource_manager, Renderer& renderer, IAllocator& allocator);
 
 	ResourceType getType() const override { return TYPE; }
+	u64 getCPUMemorySize() const override { return data.size(); }
+	u64 getGPUMemorySize() const override;
 
 	bool create(u32 w, u32 h, gpu::TextureFormat format, const void* data, u32 size);
 	void destroy();
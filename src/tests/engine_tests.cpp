@@ -0,0 +1,116 @@
+#include "core/allocator.h"
+#include "core/log.h"
+#include "core/math.h"
+#include "core/os.h"
+#include "core/string.h"
+#include "engine/engine.h"
+#include "engine/file_system.h"
+#include "engine/plugin.h"
+#include "engine/world.h"
+#include "tests/common.h"
+
+using namespace Lumix;
+
+namespace {
+
+struct WaveTestSystem final : ISystem {
+	const char* getName() const override { return "wave_test"; }
+	void serialize(OutputMemoryStream& serializer) const override {}
+	bool deserialize(i32 version, InputMemoryStream& serializer) override { return true; }
+};
+
+// module without components, which does what it declares in `update`
+struct WaveTestModule final : IModule {
+	WaveTestModule(const char* name, ISystem& system, World& world)
+		: m_name(name)
+		, m_system(system)
+		, m_world(world)
+	{}
+
+	bool getUpdateAccess(ModuleUpdateAccess& access) const override {
+		access = m_access;
+		return m_declared;
+	}
+
+	void update(float time_delta) override {
+		if (m_access.write_transforms) m_world.setPosition(m_entity, m_world.getPosition(m_entity) + DVec3(1, 0, 0));
+		else if (m_access.read_transforms) m_world.getPosition(m_entity);
+		++m_update_count;
+	}
+
+	void serialize(OutputMemoryStream& serializer) override {}
+	void deserialize(InputMemoryStream& serializer, const EntityMap& entity_map, i32 version) override {}
+	const char* getName() const override { return m_name; }
+	ISystem& getSystem() const override { return m_system; }
+	World& getWorld() override { return m_world; }
+
+	const char* m_name;
+	ISystem& m_system;
+	World& m_world;
+	ModuleUpdateAccess m_access;
+	bool m_declared = true;
+	EntityRef m_entity = {0};
+	u32 m_update_count = 0;
+};
+
+WaveTestModule& addWaveTestModule(const char* name, ISystem& system, World& world) {
+	UniquePtr<WaveTestModule> module = UniquePtr<WaveTestModule>::create(world.getAllocator(), name, system, world);
+	WaveTestModule& res = *module;
+	world.addModule(module.move());
+	return res;
+}
+
+bool testUpdateWaves() {
+	Engine::InitArgs init_args;
+	init_args.file_system = FileSystem::create(".", getGlobalAllocator());
+	char current_dir[MAX_PATH];
+	os::getCurrentDirectory(Span(current_dir));
+	init_args.file_system->mount(current_dir, "");
+	init_args.log_path = "engine_tests.log";
+	UniquePtr<Engine> engine = Engine::create(static_cast<Engine::InitArgs&&>(init_args), getGlobalAllocator());
+	engine->init();
+	World& world = engine->createWorld();
+	WaveTestSystem system;
+
+	WaveTestModule& reader_a = addWaveTestModule("reader_a", system, world);
+	reader_a.m_access.read_transforms = true;
+	WaveTestModule& reader_b = addWaveTestModule("reader_b", system, world);
+	reader_b.m_access.read_transforms = true;
+	WaveTestModule& writer = addWaveTestModule("writer", system, world);
+	writer.m_access.write_transforms = true;
+	WaveTestModule& caller = addWaveTestModule("caller", system, world);
+	caller.m_access.modules[0] = "reader_a";
+	WaveTestModule& undeclared = addWaveTestModule("undeclared", system, world);
+	undeclared.m_declared = false;
+	WaveTestModule& dependent = addWaveTestModule("dependent", system, world);
+	dependent.m_access.modules[0] = "undeclared";
+
+	WaveTestModule* modules[] = { &reader_a, &reader_b, &writer, &caller, &undeclared, &dependent };
+	const EntityRef e = world.createEntity(DVec3(0), Quat::IDENTITY);
+	for (WaveTestModule* module : modules) module->m_entity = e;
+
+	ASSERT_EQ(0, engine->getUpdateWave(world, reader_a), "first module should be in the first wave");
+	ASSERT_EQ(0, engine->getUpdateWave(world, reader_b), "readers should share a wave");
+	ASSERT_EQ(1, engine->getUpdateWave(world, writer), "writer should wait for readers");
+	ASSERT_EQ(1, engine->getUpdateWave(world, caller), "caller should wait for the module it calls, but not for writer");
+	ASSERT_EQ(2, engine->getUpdateWave(world, undeclared), "undeclared module should be alone");
+	ASSERT_EQ(3, engine->getUpdateWave(world, dependent), "module calling undeclared module should be undeclared");
+
+	engine->update(world);
+	for (WaveTestModule* module : modules) {
+		ASSERT_EQ(1, module->m_update_count, "every module should be updated once");
+	}
+	ASSERT_TRUE(world.getPosition(e).x == 1, "writer should move the entity");
+
+	engine->destroyWorld(world);
+	engine.reset();
+	os::deleteFile("engine_tests.log");
+	return true;
+}
+
+} // anonymous namespace
+
+void runEngineTests() {
+	logInfo("=== Running Engine Tests ===");
+	RUN_TEST(testUpdateWaves);
+}
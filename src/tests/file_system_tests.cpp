@@ -0,0 +1,204 @@
+#include "core/allocator.h"
+#include "core/array.h"
+#include "core/atomic.h"
+#include "core/crt.h"
+#include "core/job_system.h"
+#include "core/log.h"
+#include "core/os.h"
+#include "core/path.h"
+#include "core/span.h"
+#include "core/stream.h"
+#include "core/string.h"
+#include "engine/file_system.h"
+#include "engine/pack_builder.h"
+#include "engine/resource.h"
+#include "engine/resource_manager.h"
+#include "tests/common.h"
+
+using namespace Lumix;
+
+namespace {
+
+constexpr u32 FILES_COUNT = 16;
+
+// each file contains its index, files are in engine data dir, i.e. the working directory
+struct TestFiles {
+	explicit TestFiles(FileSystem& fs) : fs(fs) {
+		for (u32 i = 0; i < FILES_COUNT; ++i) {
+			if (!fs.saveContentSync(getPath(i), Span((const u8*)&i, sizeof(i)))) created = false;
+		}
+	}
+
+	~TestFiles() {
+		for (u32 i = 0; i < FILES_COUNT; ++i) fs.deleteFile(getPath(i));
+	}
+
+	static Path getPath(u32 i) { return Path("engine/fs_test_", i, ".bin"); }
+
+	FileSystem& fs;
+	bool created = true;
+};
+
+struct Receiver {
+	void onLoaded(Span<const u8> content, bool success) {
+		if (!success || content.length() != sizeof(u32)) {
+			failed = 1;
+			return;
+		}
+		u32 idx;
+		memcpy(&idx, content.begin(), sizeof(idx));
+		if (idx >= FILES_COUNT) failed = 1;
+		else loaded[idx] = true;
+	}
+
+	// each request writes only its own flag
+	bool loaded[FILES_COUNT] = {};
+	AtomicI32 failed = 0;
+};
+
+bool testWaitAllAndCounter() {
+	UniquePtr<FileSystem> fs = FileSystem::create(".", getGlobalAllocator());
+	TestFiles files(*fs);
+	ASSERT_TRUE(files.created, "test files should be created");
+
+	Receiver receiver;
+	jobs::Counter counter;
+	FileSystem::ContentRequest requests[FILES_COUNT];
+	Array<FileSystem::AsyncHandle> handles(getGlobalAllocator());
+	for (u32 i = 0; i < FILES_COUNT; ++i) handles.push(FileSystem::AsyncHandle::invalid());
+	for (u32 i = 0; i < FILES_COUNT; ++i) {
+		requests[i].path = TestFiles::getPath(i);
+		requests[i].callback = makeDelegate<&Receiver::onLoaded>(&receiver);
+		requests[i].callback_on_worker = true;
+		requests[i].counter = &counter;
+	}
+	fs->getContent(Span(requests), Span(handles.begin(), handles.size()));
+
+	// first half with waitAll, the rest with the counter
+	fs->waitAll(Span(handles.begin(), FILES_COUNT / 2));
+	for (u32 i = 0; i < FILES_COUNT / 2; ++i) {
+		ASSERT_TRUE(receiver.loaded[i], "waitAll should return after callbacks of all requests");
+	}
+	jobs::wait(&counter);
+	for (u32 i = 0; i < FILES_COUNT; ++i) {
+		ASSERT_TRUE(receiver.loaded[i], "counter should be green after callbacks of all requests");
+	}
+	ASSERT_TRUE(receiver.failed == 0, "all files should be read");
+	ASSERT_TRUE(fs->getReadTimes(handles[0]).queued == 0, "handle of finished request should be stale");
+	return true;
+}
+
+bool testWaitAnyAndCancel() {
+	UniquePtr<FileSystem> fs = FileSystem::create(".", getGlobalAllocator());
+	TestFiles files(*fs);
+	ASSERT_TRUE(files.created, "test files should be created");
+
+	Receiver receiver;
+	jobs::Counter counter;
+	FileSystem::ContentRequest requests[2];
+	FileSystem::AsyncHandle handles[2] = { FileSystem::AsyncHandle::invalid(), FileSystem::AsyncHandle::invalid() };
+	for (u32 i = 0; i < 2; ++i) {
+		requests[i].path = TestFiles::getPath(i);
+		requests[i].callback = makeDelegate<&Receiver::onLoaded>(&receiver);
+		requests[i].counter = &counter;
+	}
+	// the first one is finished only in `processCallbacks`, which is not called while waiting
+	requests[1].callback_on_worker = true;
+	fs->getContent(Span(requests), Span(handles));
+
+	ASSERT_EQ(1, fs->waitAny(Span(handles)), "request with callback on worker should finish first");
+	ASSERT_TRUE(receiver.loaded[1], "waitAny should return after the callback");
+
+	fs->cancel(handles[0]);
+	for (u32 i = 0; i < 1000 && fs->hasWork(); ++i) {
+		fs->processCallbacks();
+		os::sleep(1);
+	}
+	ASSERT_TRUE(!fs->hasWork(), "canceled request should be freed in processCallbacks");
+	ASSERT_TRUE(!receiver.loaded[0], "callback of canceled request should not be called");
+	// would hang if the canceled request did not decrement the counter
+	jobs::wait(&counter);
+	ASSERT_TRUE(receiver.failed == 0, "file should be read");
+	return true;
+}
+
+bool equalContent(FileSystem& fs, const Path& path, Span<const u8> expected) {
+	OutputMemoryStream content(getGlobalAllocator());
+	if (!fs.getContentSync(path, content)) return false;
+	return content.size() == expected.length() && memcmp(content.data(), expected.begin(), content.size()) == 0;
+}
+
+bool testPackRoundTrip() {
+	IAllocator& allocator = getGlobalAllocator();
+	UniquePtr<FileSystem> fs = FileSystem::create(".", allocator);
+	// working directory is the project too
+	char current_dir[MAX_PATH];
+	os::getCurrentDirectory(Span(current_dir));
+	fs->mount(current_dir, "");
+	ASSERT_TRUE(os::makePath(".lumix/resources"), "resources directory should be created");
+
+	u8 compressible[4096];
+	for (u32 i = 0; i < lengthOf(compressible); ++i) compressible[i] = u8(i % 16);
+	u8 small[] = { 1, 2, 3 };
+	u8 compiled[] = { 4, 5, 6 };
+	// name starting with digits is not a compiled resource
+	const Path compressed_path("pak_test_compressed.bin");
+	const Path duplicate_path("pak_test_duplicate.bin");
+	const Path digits_path("12_pak_test.bin");
+	// compiled resource, the manifest refers to it by its source path
+	const Path resource_path("pak_test.res_src");
+	const Path compiled_path = Resource::getFilePath(resource_path);
+	ASSERT_TRUE(fs->saveContentSync(compressed_path, Span(compressible)), "test file should be created");
+	ASSERT_TRUE(fs->saveContentSync(duplicate_path, Span(compressible)), "test file should be created");
+	ASSERT_TRUE(fs->saveContentSync(digits_path, Span(small)), "test file should be created");
+	ASSERT_TRUE(fs->saveContentSync(compiled_path, Span(compiled)), "test file should be created");
+
+	UniquePtr<PackBuilder> builder = PackBuilder::create(*fs, allocator);
+	builder->setAlignment(16);
+	builder->addFile(compressed_path, PackBuilder::Compression::LZ4);
+	builder->addFile(duplicate_path, PackBuilder::Compression::LZ4);
+	builder->addFile(digits_path, PackBuilder::Compression::NONE);
+	builder->addFile(compiled_path, PackBuilder::Compression::NONE);
+
+	OutputMemoryStream manifest(allocator);
+	manifest.write(ResourceManagerHub::MANIFEST_MAGIC);
+	manifest.write(ResourceManagerHub::MANIFEST_VERSION);
+	manifest.write(u32(1));
+	manifest.write(u64(0));
+	manifest.writeString(resource_path.c_str());
+	ASSERT_TRUE(builder->addLoadTrace(manifest), "manifest should be accepted as load trace");
+
+	const char* pak_path = "pak_test.pak";
+	PackBuilder::Report report;
+	ASSERT_TRUE(builder->write(pak_path, report), "pak should be written");
+	ASSERT_EQ(4, report.files, "all files should be packed");
+	ASSERT_EQ(1, report.duplicates, "same content should be stored once");
+	ASSERT_TRUE(report.saved_by_compression > 0, "compressible file should be compressed");
+	ASSERT_EQ(1, report.traced_reads, "resource from manifest should be traced");
+
+	{
+		UniquePtr<FileSystem> pak = FileSystem::createPacked(pak_path, allocator);
+		ASSERT_TRUE(pak->fileExists(compressed_path.c_str()), "compressed file should be in the pak");
+		ASSERT_TRUE(equalContent(*pak, compressed_path, Span(compressible)), "compressed file should be decompressed");
+		ASSERT_TRUE(equalContent(*pak, duplicate_path, Span(compressible)), "deduplicated file should be readable");
+		ASSERT_TRUE(equalContent(*pak, digits_path, Span(small)), "file named by digits should be found by its path");
+		ASSERT_TRUE(equalContent(*pak, compiled_path, Span(compiled)), "compiled resource should be found");
+		ASSERT_TRUE(!pak->fileExists("pak_test_missing.bin"), "missing file should not be found");
+	}
+
+	os::deleteFile(pak_path);
+	fs->deleteFile(compressed_path);
+	fs->deleteFile(duplicate_path);
+	fs->deleteFile(digits_path);
+	fs->deleteFile(compiled_path);
+	return true;
+}
+
+} // anonymous namespace
+
+void runFileSystemTests() {
+	logInfo("=== Running File System Tests ===");
+	RUN_TEST(testWaitAllAndCounter);
+	RUN_TEST(testWaitAnyAndCancel);
+	RUN_TEST(testPackRoundTrip);
+}
@@ -1,12 +1,22 @@
 #include "tests/common.h"
 #include "core/debug.h"
+#include "core/job_system.h"
 #include "core/log_callback.h"
+#include "core/math.h"
+#include "core/os.h"
+#include "core/profiler.h"
+#include "core/sync.h"
 #include "core/string.h"
 #include <stdio.h>
 
 void runParticleScriptTokenizerTests();
 void runParticleScriptCompilerTests();
 void runParticleScriptCollectorTests();
+void runWorldDeltaTests();
+void runWorldTests();
+void runFileSystemTests();
+void runResourceManagerTests();
+void runEngineTests();
 
 namespace Lumix {
 	int test_count = 0;
@@ -27,12 +37,31 @@ static void consoleLog(Lumix::LogLevel level, const char* message) {
 int main(int argc, char* argv[]) {
 	Lumix::registerLogCallback<&consoleLog>();
 	Lumix::debug::init(Lumix::getGlobalAllocator());
+	Lumix::profiler::init(Lumix::getGlobalAllocator());
 	
-	runParticleScriptTokenizerTests();
-	runParticleScriptCompilerTests();
-	runParticleScriptCollectorTests();
+	// tests of parallel code need more than one worker, even on single core machines
+	if (!Lumix::jobs::init(Lumix::maximum(Lumix::os::getCPUsCount(), 2u), Lumix::getGlobalAllocator())) {
+		Lumix::logError("Failed to initialize job system.");
+		return 1;
+	}
+	// some tests wait for jobs, which is possible only in a job
+	Lumix::Semaphore semaphore(0, 1);
+	Lumix::jobs::run(&semaphore, [](void* ptr) {
+		runParticleScriptTokenizerTests();
+		runParticleScriptCompilerTests();
+		runParticleScriptCollectorTests();
+		runWorldDeltaTests();
+		runWorldTests();
+		runFileSystemTests();
+		runResourceManagerTests();
+		runEngineTests();
+		((Lumix::Semaphore*)ptr)->signal();
+	}, nullptr, 0);
+	semaphore.wait();
+	Lumix::jobs::shutdown();
 	Lumix::logInfo("=== Test Results: ", Lumix::passed_count, "/", Lumix::test_count, " passed ===");
 
+	Lumix::profiler::shutdown();
 	Lumix::unregisterLogCallback<&consoleLog>();
 	return (Lumix::passed_count == Lumix::test_count) ? 0 : 1;
 }
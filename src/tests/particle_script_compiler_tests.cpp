@@ -40,7 +40,15 @@ struct MemoryFileSystem : FileSystem {
 	Path getFullPath(StringView path) const override { return Path(path); }
 	void processCallbacks() override {}
 	bool hasWork() override { return false; }
-	AsyncHandle getContent(const Path&, const ContentCallback&) override { return AsyncHandle::invalid(); }
+	AsyncHandle getContent(const Path&, const ContentCallback&, const ProcessCallback&, Priority) override { return AsyncHandle::invalid(); }
+	void getContent(Span<const ContentRequest>, Span<AsyncHandle> handles) override {
+		for (AsyncHandle& h : handles) h = AsyncHandle::invalid();
+	}
+	u32 waitAny(Span<const AsyncHandle>) override { return 0; }
+	void waitAll(Span<const AsyncHandle>) override {}
+	void setPriority(AsyncHandle, Priority) override {}
+	ReadTimes getReadTimes(AsyncHandle) override { return {}; }
+	u64 getReadOrder(const Path&) override { return 0; }
 	void cancel(AsyncHandle) override {}
 };
 
@@ -0,0 +1,192 @@
+#include "core/allocator.h"
+#include "core/job_system.h"
+#include "core/log.h"
+#include "core/os.h"
+#include "core/path.h"
+#include "core/span.h"
+#include "engine/file_system.h"
+#include "engine/resource.h"
+#include "engine/resource_manager.h"
+#include "tests/common.h"
+#include "tests/test_engine.h"
+
+using namespace Lumix;
+
+namespace {
+
+constexpr u32 RESOURCES_COUNT = 3;
+constexpr u64 RESOURCE_SIZE = 100;
+
+struct TestResource final : Resource {
+	static inline const ResourceType TYPE = ResourceType("test_resource");
+
+	TestResource(const Path& path, ResourceManager& manager, IAllocator& allocator)
+		: Resource(path, manager, allocator)
+	{}
+
+	ResourceType getType() const override { return TYPE; }
+	void unload() override {}
+	bool load(Span<const u8> blob) override { return true; }
+	u64 getCPUMemorySize() const override { return RESOURCE_SIZE; }
+};
+
+struct TestResourceManager final : ResourceManager {
+	TestResourceManager(IAllocator& allocator)
+		: ResourceManager(allocator)
+		, m_allocator(allocator)
+	{}
+
+	Resource* createResource(const Path& path) override {
+		return LUMIX_NEW(m_allocator, TestResource)(path, *this, m_allocator);
+	}
+
+	void destroyResource(Resource& resource) override {
+		LUMIX_DELETE(m_allocator, static_cast<TestResource*>(&resource));
+	}
+
+	IAllocator& m_allocator;
+};
+
+// asset tiles are read as they are, without compiled resource header
+Path getResourcePath(u32 i) { return Path(".lumix/asset_tiles/rm_test_", i, ".bin"); }
+
+void waitForLoads(FileSystem& fs) {
+	for (u32 i = 0; i < 1000 && fs.hasWork(); ++i) {
+		fs.processCallbacks();
+		// files are decoded in jobs, we are a job too, so let them run
+		jobs::yield();
+		os::sleep(1);
+	}
+}
+
+bool testCacheEvictAndStats() {
+	TestEngine engine;
+	IAllocator& allocator = engine.getAllocator();
+	UniquePtr<FileSystem> fs = FileSystem::create(".", allocator);
+	// working directory is the project too
+	char current_dir[MAX_PATH];
+	os::getCurrentDirectory(Span(current_dir));
+	fs->mount(current_dir, "");
+	ASSERT_TRUE(os::makePath(".lumix/asset_tiles"), "asset tiles directory should be created");
+	for (u32 i = 0; i < RESOURCES_COUNT; ++i) {
+		ASSERT_TRUE(fs->saveContentSync(getResourcePath(i), Span((const u8*)&i, sizeof(i))), "test file should be created");
+	}
+
+	ResourceManagerHub hub(engine, allocator);
+	hub.init(*fs);
+	TestResourceManager manager(allocator);
+	manager.create(TestResource::TYPE, hub);
+	// two resources fit in the budget
+	hub.setBudget(TestResource::TYPE, RESOURCE_SIZE * 5 / 2);
+
+	Resource* res[RESOURCES_COUNT];
+	res[0] = hub.load(TestResource::TYPE, getResourcePath(0));
+	res[1] = hub.load(TestResource::TYPE, getResourcePath(1));
+	waitForLoads(*fs);
+	ASSERT_TRUE(res[0]->isReady() && res[1]->isReady(), "resources should be loaded");
+	ASSERT_EQ(2, manager.getStats().misses, "first loads should be misses");
+	ASSERT_EQ(2 * RESOURCE_SIZE, manager.getStats().resident_size, "ready resources should be resident");
+
+	// unreferenced resource within budget stays loaded and reloading it is a hit
+	res[0]->decRefCount();
+	ASSERT_TRUE(res[0]->isReady() && res[0]->isCached(), "unreferenced resource should be cached");
+	ASSERT_EQ(RESOURCE_SIZE, manager.getStats().cached_size, "cached size should include the cached resource");
+	ASSERT_TRUE(hub.load(TestResource::TYPE, getResourcePath(0)) == res[0], "cached resource should be reused");
+	ASSERT_TRUE(!res[0]->isCached(), "loaded resource should not be cached");
+	ASSERT_EQ(1, manager.getStats().hits, "load of cached resource should be a hit");
+
+	// `res[0]` is the least recently used
+	res[0]->decRefCount();
+	res[1]->decRefCount();
+	ASSERT_EQ(2, manager.getStats().cached_count, "both resources should be cached");
+	res[2] = hub.load(TestResource::TYPE, getResourcePath(2));
+	waitForLoads(*fs);
+	ASSERT_TRUE(res[2]->isReady(), "resource should be loaded");
+	ASSERT_EQ(3, manager.getStats().misses, "new resource should be a miss");
+
+	// over budget now, evicted in update
+	hub.update();
+	ASSERT_TRUE(res[0]->isEmpty(), "least recently used resource should be evicted");
+	ASSERT_TRUE(res[1]->isReady() && res[1]->isCached(), "recently used resource should stay cached");
+	ASSERT_EQ(1, manager.getStats().evictions, "one resource should be evicted");
+	ASSERT_EQ(2 * RESOURCE_SIZE, manager.getStats().resident_size, "evicted resource should not be resident");
+
+	// evicted resource is loaded again
+	ASSERT_TRUE(hub.load(TestResource::TYPE, getResourcePath(0)) == res[0], "evicted resource should be reused");
+	ASSERT_EQ(4, manager.getStats().misses, "load of evicted resource should be a miss");
+	waitForLoads(*fs);
+	res[0]->decRefCount();
+	res[2]->decRefCount();
+
+	// `Engine::destroyWorld` removes unreferenced resources, cached ones within budget survive it
+	hub.removeUnreferenced();
+	ASSERT_TRUE(res[0]->isReady() && res[0]->isCached(), "cached resource should survive removeUnreferenced");
+	ASSERT_TRUE(res[2]->isReady() && res[2]->isCached(), "cached resource should survive removeUnreferenced");
+	ASSERT_EQ(2 * RESOURCE_SIZE, manager.getStats().resident_size, "cached resources should stay resident");
+
+	hub.disableCache();
+	ASSERT_EQ(0, manager.getStats().cached_count, "disabled cache should unload everything");
+	ASSERT_EQ(0, manager.getStats().resident_size, "nothing should be resident");
+
+	manager.destroy();
+	for (u32 i = 0; i < RESOURCES_COUNT; ++i) fs->deleteFile(getResourcePath(i));
+	return true;
+}
+
+struct GroupCompleteCounter {
+	void onComplete(ResourceGroup& group) { ++count; }
+	u32 count = 0;
+};
+
+bool testGroupComplete() {
+	TestEngine engine;
+	IAllocator& allocator = engine.getAllocator();
+	UniquePtr<FileSystem> fs = FileSystem::create(".", allocator);
+	char current_dir[MAX_PATH];
+	os::getCurrentDirectory(Span(current_dir));
+	fs->mount(current_dir, "");
+	ASSERT_TRUE(os::makePath(".lumix/asset_tiles"), "asset tiles directory should be created");
+	for (u32 i = 0; i < RESOURCES_COUNT; ++i) {
+		ASSERT_TRUE(fs->saveContentSync(getResourcePath(i), Span((const u8*)&i, sizeof(i))), "test file should be created");
+	}
+
+	ResourceManagerHub hub(engine, allocator);
+	hub.init(*fs);
+	TestResourceManager manager(allocator);
+	manager.create(TestResource::TYPE, hub);
+
+	const Path paths[] = { getResourcePath(0), getResourcePath(1) };
+	Resource* res[lengthOf(paths)];
+	GroupCompleteCounter counter;
+	ResourceGroup group(allocator);
+	group.on_complete.bind<&GroupCompleteCounter::onComplete>(&counter);
+	hub.loadMany(TestResource::TYPE, Span(paths), Span(res), &group);
+	ASSERT_EQ(2, group.getPendingCount(), "both resources should be pending");
+	ASSERT_EQ(0, counter.count, "group should not be complete yet");
+	waitForLoads(*fs);
+	ASSERT_TRUE(group.isComplete(), "group should be complete");
+	ASSERT_EQ(1, counter.count, "completion should be reported once");
+
+	// everything is already loaded, the group completes right away
+	Resource* loaded[lengthOf(paths)];
+	ResourceGroup loaded_group(allocator);
+	loaded_group.on_complete.bind<&GroupCompleteCounter::onComplete>(&counter);
+	hub.loadMany(TestResource::TYPE, Span(paths), Span(loaded), &loaded_group);
+	ASSERT_EQ(2, counter.count, "group of ready resources should complete in add");
+
+	group.clear();
+	loaded_group.clear();
+	for (Resource* r : res) r->decRefCount();
+	for (Resource* r : loaded) r->decRefCount();
+	manager.destroy();
+	for (u32 i = 0; i < RESOURCES_COUNT; ++i) fs->deleteFile(getResourcePath(i));
+	return true;
+}
+
+} // anonymous namespace
+
+void runResourceManagerTests() {
+	logInfo("=== Running Resource Manager Tests ===");
+	RUN_TEST(testCacheEvictAndStats);
+	RUN_TEST(testGroupComplete);
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "core/allocator.h"
+#include "engine/engine.h"
+#include "engine/plugin.h"
+
+namespace Lumix {
+
+// world without modules needs only an allocator and an empty system manager from engine
+struct TestEngine final : Engine {
+	TestEngine() : m_system_manager(SystemManager::create(*this)) {}
+
+	void init() override {}
+	World& createWorld() override { ASSERT(false); return *(World*)nullptr; }
+	void destroyWorld(World& world) override {}
+	void setMainWindow(os::WindowHandle win) override {}
+	os::WindowHandle getMainWindow() override { return nullptr; }
+	FileSystem& getFileSystem() override { ASSERT(false); return *(FileSystem*)nullptr; }
+	InputSystem& getInputSystem() override { ASSERT(false); return *(InputSystem*)nullptr; }
+	SystemManager& getSystemManager() override { return *m_system_manager; }
+	ResourceManagerHub& getResourceManager() override { ASSERT(false); return *(ResourceManagerHub*)nullptr; }
+	PageAllocator& getPageAllocator() override { ASSERT(false); return *(PageAllocator*)nullptr; }
+	IAllocator& getAllocator() override { return getGlobalAllocator(); }
+	EntityPtr instantiatePrefab(World&, const PrefabResource&, const DVec3&, const Quat&, const Vec3&, EntityMap&) override { return INVALID_ENTITY; }
+	void startGame(World& world) override {}
+	void stopGame(World& world) override {}
+	void update(World& world) override {}
+	DeserializeProjectResult deserializeProject(InputMemoryStream&, Path&) override { return DeserializeProjectResult::CORRUPTED_FILE; }
+	void serializeProject(OutputMemoryStream&, const Path&) const override {}
+	float getLastTimeDelta() const override { return 0; }
+	void setTimeMultiplier(float multiplier) override {}
+	void setFixedTimeDelta(float time_delta) override {}
+	void setFixedTimeStep(float time_step, u32 max_substeps) override {}
+	float getFixedTimeStep() const override { return 0; }
+	float getFixedStepAlpha() const override { return 1; }
+	void setFrameFence(const char* module, Delegate<void()> fence) override {}
+	u32 getUpdateWave(World& world, const IModule& module) override { return 0; }
+	void pause(bool pause) override {}
+	bool isPaused() const override { return false; }
+	void nextFrame() override {}
+	bool decompress(Span<const u8> src, Span<u8> dst) override { return false; }
+	bool compress(Span<const u8> src, OutputMemoryStream& dst) override { return false; }
+	bool decompressBlocks(Span<const u8> src, Span<u8> dst) override { return false; }
+	bool compressBlocks(Span<const u8> src, OutputMemoryStream& dst) override { return false; }
+
+	UniquePtr<SystemManager> m_system_manager;
+};
+
+} // namespace Lumix
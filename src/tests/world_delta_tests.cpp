@@ -0,0 +1,238 @@
+#include "core/allocator.h"
+#include "core/hash_map.h"
+#include "core/log.h"
+#include "core/math.h"
+#include "core/stream.h"
+#include "core/string.h"
+#include "engine/plugin.h"
+#include "engine/reflection.h"
+#include "engine/world.h"
+#include "engine/world_delta.h"
+#include "tests/common.h"
+#include "tests/test_engine.h"
+
+using namespace Lumix;
+
+namespace {
+
+bool equalWorlds(World& a, World& b) {
+	const double max_pos_error = 1 / 1024.0;
+	for (EntityPtr e = a.getFirstEntity(); e.isValid(); e = a.getNextEntity(*e)) {
+		if (!b.hasEntity(*e)) return false;
+		const Transform& ta = a.getTransform(*e);
+		const Transform& tb = b.getTransform(*e);
+		if (fabs(ta.pos.x - tb.pos.x) > max_pos_error) return false;
+		if (fabs(ta.pos.y - tb.pos.y) > max_pos_error) return false;
+		if (fabs(ta.pos.z - tb.pos.z) > max_pos_error) return false;
+		const float dot = ta.rot.x * tb.rot.x + ta.rot.y * tb.rot.y + ta.rot.z * tb.rot.z + ta.rot.w * tb.rot.w;
+		if (fabsf(dot) < 0.9999f) return false;
+		if (ta.scale != tb.scale) return false;
+	}
+	for (EntityPtr e = b.getFirstEntity(); e.isValid(); e = b.getNextEntity(*e)) {
+		if (!a.hasEntity(*e)) return false;
+	}
+	return true;
+}
+
+bool replicate(WorldDeltaEncoder& encoder, World& src, World& dst, u64* delta_size = nullptr) {
+	OutputMemoryStream delta(getGlobalAllocator());
+	encoder.encode(src, delta);
+	if (delta_size) *delta_size = delta.size();
+	InputMemoryStream blob(delta);
+	return applyWorldDelta(dst, blob);
+}
+
+bool testDeltaLoopback() {
+	TestEngine engine;
+	World server(engine);
+	World client(engine);
+	WorldDeltaEncoder encoder(getGlobalAllocator());
+
+	EntityRef entities[200];
+	for (u32 i = 0; i < lengthOf(entities); ++i) {
+		const Quat rot(normalize(Vec3(1, float(i), 2)), i * 0.1f);
+		entities[i] = server.createEntity(DVec3(i * 3.7, -1000.25 + i, 1e5 + i * 0.001), rot);
+		server.setScale(entities[i], Vec3(1 + i * 0.5f));
+	}
+	ASSERT_TRUE(replicate(encoder, server, client), "applying initial delta failed");
+	ASSERT_TRUE(equalWorlds(server, client), "worlds differ after initial delta");
+
+	for (u32 i = 0; i < lengthOf(entities); i += 3) {
+		server.setPosition(entities[i], server.getPosition(entities[i]) + DVec3(0.5, 0, -2));
+		server.setRotation(entities[i], Quat(Vec3(0, 1, 0), i * 0.05f));
+	}
+	for (u32 i = 1; i < lengthOf(entities); i += 7) server.destroyEntity(entities[i]);
+	for (u32 i = 0; i < 10; ++i) server.createEntity(DVec3(i, i, i), Quat::IDENTITY);
+	ASSERT_TRUE(replicate(encoder, server, client), "applying delta failed");
+	ASSERT_TRUE(equalWorlds(server, client), "worlds differ after delta");
+
+	u64 delta_size;
+	ASSERT_TRUE(replicate(encoder, server, client, &delta_size), "applying empty delta failed");
+	ASSERT_EQ(sizeof(u32) * 2, delta_size, "unchanged world should produce empty delta");
+	return true;
+}
+
+struct DeltaTestSystem final : ISystem {
+	const char* getName() const override { return "delta_test"; }
+	void serialize(OutputMemoryStream& serializer) const override {}
+	bool deserialize(i32 version, InputMemoryStream& serializer) override { return true; }
+};
+
+// component with a plain, an entity and an array property, to test replication of reflected properties
+struct DeltaTestModule final : IModule {
+	static constexpr u32 MAX_ITEMS = 8;
+	struct Component {
+		float value = 0;
+		EntityPtr target = INVALID_ENTITY;
+		float items[MAX_ITEMS] = {};
+		u32 items_count = 0;
+	};
+
+	DeltaTestModule(ISystem& system, World& world)
+		: m_system(system)
+		, m_world(world)
+		, m_components(world.getAllocator())
+	{}
+
+	static ComponentType getType() {
+		static ComponentType type = []{
+			reflection::build_module("delta_test")
+				.cmp<&DeltaTestModule::createComponent, &DeltaTestModule::destroyComponent>("delta_test", "Delta test")
+					.prop<&DeltaTestModule::getValue, &DeltaTestModule::setValue>("Value")
+					.prop<&DeltaTestModule::getTarget, &DeltaTestModule::setTarget>("Target")
+					.begin_array<&DeltaTestModule::getItemsCount, &DeltaTestModule::addItem, &DeltaTestModule::removeItem>("Items")
+						.prop<&DeltaTestModule::getItem, &DeltaTestModule::setItem>("Item")
+					.end_array();
+			return reflection::getComponentType("delta_test");
+		}();
+		return type;
+	}
+
+	void createComponent(EntityRef e) {
+		m_components.insert(e, {});
+		m_world.onComponentCreated(e, getType(), this);
+	}
+
+	void destroyComponent(EntityRef e) {
+		m_components.erase(e);
+		m_world.onComponentDestroyed(e, getType(), this);
+	}
+
+	float getValue(EntityRef e) { return m_components[e].value; }
+	void setValue(EntityRef e, float value) { m_components[e].value = value; }
+	EntityPtr getTarget(EntityRef e) { return m_components[e].target; }
+	void setTarget(EntityRef e, EntityPtr value) { m_components[e].target = value; }
+	u32 getItemsCount(EntityRef e) { return m_components[e].items_count; }
+	float getItem(EntityRef e, u32 idx) { return m_components[e].items[idx]; }
+	void setItem(EntityRef e, u32 idx, float value) { m_components[e].items[idx] = value; }
+
+	void addItem(EntityRef e, u32 idx) {
+		Component& c = m_components[e];
+		if (c.items_count == MAX_ITEMS) return;
+		c.items[c.items_count] = 0;
+		++c.items_count;
+	}
+
+	void removeItem(EntityRef e, u32 idx) {
+		Component& c = m_components[e];
+		for (u32 i = idx; i + 1 < c.items_count; ++i) c.items[i] = c.items[i + 1];
+		--c.items_count;
+	}
+
+	void serialize(OutputMemoryStream& serializer) override {}
+	void deserialize(InputMemoryStream& serializer, const EntityMap& entity_map, i32 version) override {}
+	const char* getName() const override { return "delta_test"; }
+	ISystem& getSystem() const override { return m_system; }
+	void update(float time_delta) override {}
+	World& getWorld() override { return m_world; }
+
+	ISystem& m_system;
+	World& m_world;
+	HashMap<EntityRef, Component> m_components;
+};
+
+DeltaTestModule& addDeltaTestModule(ISystem& system, World& world) {
+	// component types are registered before the module is added, so world knows which module creates them
+	DeltaTestModule::getType();
+	UniquePtr<DeltaTestModule> module = UniquePtr<DeltaTestModule>::create(world.getAllocator(), system, world);
+	DeltaTestModule& res = *module;
+	world.addModule(module.move());
+	return res;
+}
+
+bool testDeltaReflectedProperties() {
+	TestEngine engine;
+	DeltaTestSystem system;
+	World server(engine);
+	World client(engine);
+	DeltaTestModule& server_module = addDeltaTestModule(system, server);
+	DeltaTestModule& client_module = addDeltaTestModule(system, client);
+	const ComponentType type = DeltaTestModule::getType();
+	WorldDeltaEncoder encoder(getGlobalAllocator());
+
+	const EntityRef a = server.createEntity(DVec3(0), Quat::IDENTITY);
+	const EntityRef b = server.createEntity(DVec3(1), Quat::IDENTITY);
+	server.createComponent(type, a);
+	server_module.setValue(a, 1.5f);
+	server_module.setTarget(a, b);
+	server_module.addItem(a, -1);
+	server_module.setItem(a, 0, 10);
+	ASSERT_TRUE(replicate(encoder, server, client), "applying initial delta failed");
+	ASSERT_TRUE(client.hasComponent(a, type), "component should be replicated");
+	ASSERT_TRUE(client_module.getValue(a) == 1.5f, "property should be replicated");
+	ASSERT_TRUE(client_module.getTarget(a) == b, "entity property should be replicated");
+	ASSERT_EQ(1, client_module.getItemsCount(a), "array should be replicated");
+	ASSERT_TRUE(client_module.getItem(a, 0) == 10, "array item should be replicated");
+
+	server_module.setValue(a, -3);
+	server_module.setTarget(a, INVALID_ENTITY);
+	server_module.setItem(a, 0, 20);
+	server_module.addItem(a, -1);
+	server_module.setItem(a, 1, 30);
+	ASSERT_TRUE(replicate(encoder, server, client), "applying delta failed");
+	ASSERT_TRUE(client_module.getValue(a) == -3, "changed property should be replicated");
+	ASSERT_TRUE(!client_module.getTarget(a).isValid(), "cleared entity property should be replicated");
+	ASSERT_EQ(2, client_module.getItemsCount(a), "added array item should be replicated");
+	ASSERT_TRUE(client_module.getItem(a, 0) == 20 && client_module.getItem(a, 1) == 30, "array items should be replicated");
+
+	server_module.removeItem(a, 0);
+	server_module.setTarget(a, a);
+	ASSERT_TRUE(replicate(encoder, server, client), "applying delta failed");
+	ASSERT_EQ(1, client_module.getItemsCount(a), "removed array item should be replicated");
+	ASSERT_TRUE(client_module.getItem(a, 0) == 30, "remaining array item should be replicated");
+	ASSERT_TRUE(client_module.getTarget(a) == a, "entity property should be replicated");
+
+	server.destroyComponent(a, type);
+	ASSERT_TRUE(replicate(encoder, server, client), "applying delta failed");
+	ASSERT_TRUE(!client.hasComponent(a, type), "component removal should be replicated");
+	return true;
+}
+
+bool testDeltaRotationQuantization() {
+	TestEngine engine;
+	World server(engine);
+	World client(engine);
+	WorldDeltaEncoder encoder(getGlobalAllocator());
+
+	const Quat rotations[] = {
+		Quat::IDENTITY,
+		Quat(0, 0, 0, -1),
+		Quat(Vec3(1, 0, 0), PI),
+		Quat(Vec3(0, 0, 1), -PI * 0.5f),
+		Quat(normalize(Vec3(1, 1, 1)), 2.f),
+		Quat(normalize(Vec3(-1, 2, 0.5f)), -0.001f),
+	};
+	for (const Quat& rot : rotations) server.createEntity(DVec3(0), rot);
+	ASSERT_TRUE(replicate(encoder, server, client), "applying delta failed");
+	ASSERT_TRUE(equalWorlds(server, client), "rotations differ after delta");
+	return true;
+}
+
+} // anonymous namespace
+
+void runWorldDeltaTests() {
+	logInfo("=== Running World Delta Tests ===");
+	RUN_TEST(testDeltaLoopback);
+	RUN_TEST(testDeltaRotationQuantization);
+	RUN_TEST(testDeltaReflectedProperties);
+}
@@ -0,0 +1,353 @@
+#include "core/allocator.h"
+#include "core/array.h"
+#include "core/atomic.h"
+#include "core/crt.h"
+#include "core/job_system.h"
+#include "core/log.h"
+#include "core/math.h"
+#include "core/os.h"
+#include "core/stream.h"
+#include "core/string.h"
+#include "engine/component_types.h"
+#include "engine/core.h"
+#include "engine/plugin.h"
+#include "engine/world.h"
+#include "tests/common.h"
+#include "tests/test_engine.h"
+
+using namespace Lumix;
+
+namespace {
+
+bool equalPositions(const DVec3& a, const DVec3& b) {
+	return fabs(a.x - b.x) < 1e-6 && fabs(a.y - b.y) < 1e-6 && fabs(a.z - b.z) < 1e-6;
+}
+
+bool testDeferredTransformsWithDirtyAncestor() {
+	TestEngine engine;
+	World world(engine);
+	const EntityRef parent = world.createEntity(DVec3(0), Quat::IDENTITY);
+	const EntityRef child = world.createEntity(DVec3(1, 0, 0), Quat::IDENTITY);
+	const EntityRef grandchild = world.createEntity(DVec3(2, 0, 0), Quat::IDENTITY);
+	const EntityRef leaf = world.createEntity(DVec3(3, 0, 0), Quat::IDENTITY);
+	world.setParent(parent, child);
+	world.setParent(child, grandchild);
+	world.setParent(grandchild, leaf);
+
+	world.setDeferredTransforms(true);
+	// `child` and its descendants are stale now
+	world.setPosition(parent, DVec3(10, 0, 0));
+	// local transforms must be computed from the moved parent
+	world.setPosition(grandchild, DVec3(5, 0, 0));
+	world.setLocalPosition(child, DVec3(2, 0, 0));
+	world.updateTransforms();
+
+	ASSERT_TRUE(equalPositions(world.getPosition(child), DVec3(12, 0, 0)), "child should follow its moved parent");
+	// grandchild was set 6 units before child at 11, then child moved to 12
+	ASSERT_TRUE(equalPositions(world.getPosition(grandchild), DVec3(6, 0, 0)), "grandchild should keep its local offset");
+	ASSERT_TRUE(equalPositions(world.getPosition(leaf), DVec3(7, 0, 0)), "leaf should follow grandchild");
+
+	world.setPosition(parent, DVec3(20, 0, 0));
+	Transform tr = world.getTransform(child);
+	tr.pos = DVec3(30, 0, 0);
+	world.setTransformKeepChildren(child, tr);
+	world.updateTransforms();
+	ASSERT_TRUE(equalPositions(world.getPosition(child), DVec3(30, 0, 0)), "child should be where it was set");
+	ASSERT_TRUE(equalPositions(world.getPosition(grandchild), DVec3(16, 0, 0)), "grandchild should stay in place");
+	ASSERT_TRUE(equalPositions(world.getPosition(leaf), DVec3(17, 0, 0)), "leaf should stay in place");
+
+	// `grandchild`'s subtree leaves the dirty `parent`
+	world.setPosition(parent, DVec3(0, 0, 0));
+	world.setParent(INVALID_ENTITY, grandchild);
+	world.updateTransforms();
+	ASSERT_TRUE(equalPositions(world.getPosition(grandchild), DVec3(-4, 0, 0)), "unparented grandchild should keep its position");
+	ASSERT_TRUE(equalPositions(world.getPosition(leaf), DVec3(-3, 0, 0)), "leaf of unparented grandchild should be propagated");
+	return true;
+}
+
+bool testSerializeWithoutCompression() {
+	TestEngine engine;
+	World world(engine);
+	const EntityRef a = world.createEntity(DVec3(1, 2, 3), Quat::IDENTITY);
+	const EntityRef b = world.createEntity(DVec3(4, 5, 6), Quat::IDENTITY);
+	world.setParent(a, b);
+	world.setEntityName(b, "child");
+
+	// TestEngine can not compress, so the world must be stored uncompressed
+	OutputMemoryStream blob(engine.getAllocator());
+	world.serialize(blob, WorldSerializeFlags::NONE);
+
+	World loaded(engine);
+	EntityMap entity_map(engine.getAllocator());
+	WorldVersion version;
+	InputMemoryStream input(blob);
+	ASSERT_TRUE(loaded.deserialize(input, entity_map, version), "uncompressed world should deserialize");
+	const EntityRef loaded_a = entity_map.get(a);
+	const EntityRef loaded_b = entity_map.get(b);
+	ASSERT_TRUE(equalPositions(loaded.getPosition(loaded_b), DVec3(4, 5, 6)), "position should survive round trip");
+	ASSERT_TRUE(loaded.getParent(loaded_b) == loaded_a, "hierarchy should survive round trip");
+	ASSERT_TRUE(equalStrings(loaded.getEntityName(loaded_b), "child"), "name should survive round trip");
+	return true;
+}
+
+bool testSerializeBlittable() {
+	TestEngine engine;
+	World world(engine);
+	const EntityRef a = world.createEntity(DVec3(1, 2, 3), Quat::IDENTITY);
+	const EntityRef destroyed = world.createEntity(DVec3(0), Quat::IDENTITY);
+	const EntityRef b = world.createEntity(DVec3(4, 5, 6), Quat::IDENTITY);
+	world.destroyEntity(destroyed);
+	world.setParent(a, b);
+	world.setEntityName(b, "child");
+
+	OutputMemoryStream blob(engine.getAllocator());
+	world.serialize(blob, WorldSerializeFlags::BLITTABLE);
+
+	// empty world keeps entity indices
+	World loaded(engine);
+	EntityMap entity_map(engine.getAllocator());
+	WorldVersion version;
+	InputMemoryStream input(blob);
+	ASSERT_TRUE(loaded.deserialize(input, entity_map, version), "blittable world should deserialize");
+	ASSERT_TRUE(entity_map.get(b) == b, "entities should keep their indices");
+	ASSERT_TRUE(!loaded.hasEntity(destroyed), "destroyed entity should not be loaded");
+	ASSERT_TRUE(equalPositions(loaded.getPosition(b), DVec3(4, 5, 6)), "position should survive round trip");
+	ASSERT_TRUE(loaded.getParent(b) == a, "hierarchy should survive round trip");
+	ASSERT_TRUE(equalStrings(loaded.getEntityName(b), "child"), "name should survive round trip");
+	ASSERT_TRUE(loaded.createEntity(DVec3(0), Quat::IDENTITY) == destroyed, "free slot should be reused");
+
+	// entities are remapped when loaded into a world which is not empty
+	World additive(engine);
+	additive.createEntity(DVec3(0), Quat::IDENTITY);
+	EntityMap additive_map(engine.getAllocator());
+	InputMemoryStream additive_input(blob);
+	ASSERT_TRUE(additive.deserialize(additive_input, additive_map, version), "blittable world should deserialize additively");
+	const EntityRef additive_a = additive_map.get(a);
+	const EntityRef additive_b = additive_map.get(b);
+	ASSERT_TRUE(additive_a != a, "entities should be remapped");
+	ASSERT_TRUE(equalPositions(additive.getPosition(additive_b), DVec3(4, 5, 6)), "position should survive additive load");
+	ASSERT_TRUE(additive.getParent(additive_b) == additive_a, "hierarchy should be remapped");
+	ASSERT_TRUE(equalStrings(additive.getEntityName(additive_b), "child"), "name should be remapped");
+	return true;
+}
+
+bool testSnapshotRoundTrip() {
+	TestEngine engine;
+	IAllocator& allocator = engine.getAllocator();
+	// destroyed after the world
+	UniquePtr<ISystem> core_system(createCorePlugin(engine), &allocator);
+	World world(engine);
+	core_system->createModules(world);
+	CoreModule* core = (CoreModule*)world.getModule("core");
+	const EntityRef a = world.createEntity(DVec3(1, 0, 0), Quat::IDENTITY);
+	const EntityRef b = world.createEntity(DVec3(2, 0, 0), Quat::IDENTITY);
+	core->createSpline(a);
+	core->getSpline(a).points.push(Vec3(1, 2, 3));
+	core->createSignal(b);
+
+	OutputMemoryStream snapshot(allocator);
+	world.takeSnapshot(snapshot);
+
+	world.setPosition(a, DVec3(5, 0, 0));
+	core->getSpline(a).points.push(Vec3(4, 5, 6));
+	const EntityRef c = world.createEntity(DVec3(3, 0, 0), Quat::IDENTITY);
+	core->createSpline(c);
+	core->destroySignal(b);
+	world.destroyEntity(b);
+
+	ASSERT_TRUE(world.restoreSnapshot(snapshot), "snapshot should be restored");
+	ASSERT_TRUE(equalPositions(world.getPosition(a), DVec3(1, 0, 0)), "position should be restored");
+	ASSERT_TRUE(!world.hasEntity(c), "entity created after the snapshot should be destroyed");
+	ASSERT_TRUE(world.hasEntity(b), "entity destroyed after the snapshot should be revived");
+	ASSERT_TRUE(equalPositions(world.getPosition(b), DVec3(2, 0, 0)), "revived entity should have its position");
+	ASSERT_TRUE(world.hasComponent(b, types::signal), "revived entity should have its signal");
+	ASSERT_TRUE(!world.hasComponent(b, types::spline), "revived entity should not get other components");
+	ASSERT_TRUE(world.hasComponent(a, types::spline), "spline should be kept");
+	ASSERT_EQ(1, core->getSplines().size(), "only splines from the snapshot should exist");
+	ASSERT_EQ(1, core->getSpline(a).points.size(), "spline points should be restored");
+	ASSERT_TRUE(core->getSpline(a).points[0].y == 2, "spline points should be restored");
+	return true;
+}
+
+// module which stores its values as a raw array in blittable worlds
+struct BlittableTestModule final : IModule {
+	BlittableTestModule(ISystem& system, World& world)
+		: m_system(system)
+		, m_world(world)
+		, m_values(world.getAllocator())
+	{}
+
+	void serialize(OutputMemoryStream& serializer) override {
+		serializer.write((u32)m_values.size());
+		for (u32 value : m_values) serializer.write(value);
+	}
+
+	void deserialize(InputMemoryStream& serializer, const EntityMap& entity_map, i32 version) override {
+		m_values.resize(serializer.read<u32>());
+		for (u32& value : m_values) serializer.read(value);
+		m_raw = false;
+	}
+
+	bool serializeBlittable(OutputMemoryStream& serializer) override {
+		serializer.write((u32)m_values.size());
+		serializer.align(16);
+		serializer.write(m_values.begin(), m_values.byte_size());
+		return true;
+	}
+
+	void deserializeBlittable(InputMemoryStream& serializer, const EntityMap& entity_map, i32 version) override {
+		m_values.resize(serializer.read<u32>());
+		serializer.align(16);
+		const u32* values = (const u32*)serializer.skip(m_values.byte_size());
+		m_aligned = uintptr(values) % 16 == 0;
+		memcpy(m_values.begin(), values, m_values.byte_size());
+		m_raw = true;
+	}
+
+	const char* getName() const override { return "blittable_test"; }
+	ISystem& getSystem() const override { return m_system; }
+	void update(float time_delta) override {}
+	World& getWorld() override { return m_world; }
+
+	ISystem& m_system;
+	World& m_world;
+	Array<u32> m_values;
+	bool m_raw = false;
+	bool m_aligned = false;
+};
+
+struct LoadTestSystem final : ISystem {
+	const char* getName() const override { return "load_test"; }
+	void serialize(OutputMemoryStream& serializer) const override {}
+	bool deserialize(i32 version, InputMemoryStream& serializer) override { return true; }
+};
+
+struct LoadTestState {
+	AtomicI32 parallel_started = 0;
+	AtomicI32 parallel_finished = 0;
+	i32 parallel_count = 0;
+};
+
+// module without components, which records how it was deserialized
+struct LoadTestModule final : IModule {
+	LoadTestModule(const char* name, bool parallel, LoadTestState& state, ISystem& system, World& world)
+		: m_name(name)
+		, m_parallel(parallel)
+		, m_state(state)
+		, m_system(system)
+		, m_world(world)
+	{}
+
+	void deserialize(InputMemoryStream& serializer, const EntityMap& entity_map, i32 version) override {
+		m_value = serializer.read<u32>();
+		if (!m_parallel) {
+			m_saw_parallel_modules = m_state.parallel_finished == m_state.parallel_count;
+			return;
+		}
+		// wait until all parallel modules are being deserialized, it can happen only if they run concurrently
+		m_state.parallel_started.inc();
+		for (u32 i = 0; i < 1000 && m_state.parallel_started != m_state.parallel_count; ++i) {
+			jobs::yield();
+			os::sleep(1);
+		}
+		m_saw_parallel_modules = m_state.parallel_started == m_state.parallel_count;
+		m_state.parallel_finished.inc();
+	}
+
+	void serialize(OutputMemoryStream& serializer) override { serializer.write(m_value); }
+	bool canDeserializeInParallel() const override { return m_parallel; }
+	const char* getName() const override { return m_name; }
+	ISystem& getSystem() const override { return m_system; }
+	void update(float time_delta) override {}
+	World& getWorld() override { return m_world; }
+
+	const char* m_name;
+	bool m_parallel;
+	LoadTestState& m_state;
+	ISystem& m_system;
+	World& m_world;
+	u32 m_value = 0;
+	bool m_saw_parallel_modules = false;
+};
+
+LoadTestModule& addLoadTestModule(const char* name, bool parallel, LoadTestState& state, ISystem& system, World& world) {
+	UniquePtr<LoadTestModule> module = UniquePtr<LoadTestModule>::create(world.getAllocator(), name, parallel, state, system, world);
+	LoadTestModule& res = *module;
+	world.addModule(module.move());
+	return res;
+}
+
+bool testParallelDeserialization() {
+	TestEngine engine;
+	LoadTestSystem system;
+	LoadTestState state;
+	const char* names[] = { "parallel_a", "serial", "parallel_b" };
+	const bool parallel[] = { true, false, true };
+	state.parallel_count = 2;
+
+	World world(engine);
+	for (u32 i = 0; i < lengthOf(names); ++i) {
+		addLoadTestModule(names[i], parallel[i], state, system, world).m_value = i + 1;
+	}
+	OutputMemoryStream blob(engine.getAllocator());
+	world.serialize(blob, WorldSerializeFlags::NONE);
+
+	World loaded(engine);
+	LoadTestModule* modules[lengthOf(names)];
+	for (u32 i = 0; i < lengthOf(names); ++i) {
+		modules[i] = &addLoadTestModule(names[i], parallel[i], state, system, loaded);
+	}
+	EntityMap entity_map(engine.getAllocator());
+	WorldVersion version;
+	InputMemoryStream input(blob);
+	ASSERT_TRUE(loaded.deserialize(input, entity_map, version), "world should deserialize");
+	for (u32 i = 0; i < lengthOf(names); ++i) {
+		ASSERT_EQ(i + 1, modules[i]->m_value, "module data should survive round trip");
+	}
+	// parallel modules are not adjacent in module order, but are still deserialized together
+	ASSERT_TRUE(modules[0]->m_saw_parallel_modules && modules[2]->m_saw_parallel_modules, "parallel modules should be deserialized concurrently");
+	ASSERT_TRUE(modules[1]->m_saw_parallel_modules, "serial module should be deserialized after parallel modules");
+	return true;
+}
+
+bool testBlittableModule() {
+	TestEngine engine;
+	LoadTestSystem system;
+	World world(engine);
+	UniquePtr<BlittableTestModule> module = UniquePtr<BlittableTestModule>::create(engine.getAllocator(), system, world);
+	for (u32 i = 0; i < 5; ++i) module->m_values.push(i * 10);
+	world.addModule(module.move());
+
+	const WorldSerializeFlags all_flags[] = { WorldSerializeFlags::BLITTABLE, WorldSerializeFlags::NONE };
+	for (WorldSerializeFlags flags : all_flags) {
+		OutputMemoryStream blob(engine.getAllocator());
+		world.serialize(blob, flags);
+
+		World loaded(engine);
+		UniquePtr<BlittableTestModule> loaded_module_ptr = UniquePtr<BlittableTestModule>::create(engine.getAllocator(), system, loaded);
+		BlittableTestModule& loaded_module = *loaded_module_ptr;
+		loaded.addModule(loaded_module_ptr.move());
+		EntityMap entity_map(engine.getAllocator());
+		WorldVersion version;
+		InputMemoryStream input(blob);
+		ASSERT_TRUE(loaded.deserialize(input, entity_map, version), "world should deserialize");
+		const bool blittable = flags == WorldSerializeFlags::BLITTABLE;
+		ASSERT_TRUE(loaded_module.m_raw == blittable, "raw data should be used only in blittable worlds");
+		if (blittable) ASSERT_TRUE(loaded_module.m_aligned, "raw array should be aligned");
+		ASSERT_EQ(5, loaded_module.m_values.size(), "values should survive round trip");
+		ASSERT_EQ(40, loaded_module.m_values[4], "values should survive round trip");
+	}
+	return true;
+}
+
+} // anonymous namespace
+
+void runWorldTests() {
+	logInfo("=== Running World Tests ===");
+	RUN_TEST(testDeferredTransformsWithDirtyAncestor);
+	RUN_TEST(testSerializeWithoutCompression);
+	RUN_TEST(testSerializeBlittable);
+	RUN_TEST(testSnapshotRoundTrip);
+	RUN_TEST(testParallelDeserialization);
+	RUN_TEST(testBlittableModule);
+}